@@ -4,8 +4,11 @@
 map<int, int> Client::timeSpentPerQuestion;
 map<int, int> Client::shuffledQuestionMap;
 vector<vector<int>> Client::shuffledOptionMap;
-vector<string> Client::shuffledQuestions;
-vector<vector<string>> Client::shuffledOptions;
+CompiledExam Client::paper;
+char* Client::paperMap = nullptr;
+size_t Client::paperLength = 0;
+char Client::paperKey = 0;
+vector<bool> Client::paperDecoded;
 vector<ExamInfo> availableExams;
 namespace fs = filesystem;
 
@@ -56,6 +59,65 @@ int Client::userInput(const string& prompt, int minVal, int maxVal) {
     }
 }
 
+// Receives a (possibly long) text from the server, printing each piece as it arrives
+bool Client::recvAndPrint(int sock, string& text) {
+    bool ok = recvText(sock, text, [](const string& piece) { cout << piece << flush; });
+    cout << endl;
+    return ok;
+}
+
+// Maps a key typed at the leaderboard prompt to the server's paging command
+bool Client::leaderboardCommand(const string& input, string& command) {
+    stringstream ss(input);
+    string key;
+    int value;
+    ss >> key;
+    if (key == "n") command = "NEXT";
+    else if (key == "p") command = "PREV";
+    else if (key == "t") command = "TOP";
+    else if (key == "m") command = "AROUND";
+    else if ((key == "g" || key == "s") && ss >> value && value > 0)
+        command = (key == "g" ? "PAGE " : "SIZE ") + to_string(value);
+    else return false;
+    return true;
+}
+
+/**
+ * Lets the user page through the leaderboard just shown until they go back.
+ * Instructors can also enter a sr no. to see that student's attempt.
+ *
+ * @return False if the connection was lost.
+ */
+bool Client::pageLeaderboard(int sock, bool instructor) {
+    string options = "\n[n] Next page  [p] Previous page  [t] Top  [g N] Go to page N  [s N] N rows per page\n";
+    options += instructor ? "[sr no.] View a student's attempt  [0] Back to main menu\n"
+                          : "[m] Around my rank  [0] Back\n";
+
+    while (true) {
+        cout << options << "Select from above option: ";
+        string input, command;
+        getline(cin, input);
+        input.erase(0, input.find_first_not_of(" \t"));
+        input.erase(input.find_last_not_of(" \t\r") + 1);
+
+        if (input == "0") {
+            sendFrame(sock, input);
+            return true;
+        }
+        bool srNo = instructor && !input.empty() && all_of(input.begin(), input.end(), ::isdigit);
+        if (srNo) command = input;
+        else if (!leaderboardCommand(input, command) || (instructor && command == "AROUND")) {
+            cout << "[✖] Invalid option.\n";
+            continue;
+        }
+
+        sendFrame(sock, command);
+        string reply;
+        system("clear");
+        if (!recvAndPrint(sock, reply)) return false;
+    }
+}
+
 void Client::xorEncryptDecrypt(const string& filePath, char key) {
     fstream file(filePath, ios::in | ios::out | ios::binary);
     if (!file) {
@@ -76,69 +138,59 @@ void Client::xorEncryptDecrypt(const string& filePath, char key) {
     file.close();
 }
 
-void Client::decryptAndPrepareExam(const string& filePath, char key) {
-    // Open the encrypted exam file in binary mode
-    ifstream infile(filePath, ios::binary);
-    if (!infile) {
-        cerr << "[-] Error: Could not open file " << filePath << endl;
-        return;
-    }
+static void xorBytes(char* data, size_t length, char key) {
+    for (size_t i = 0; i < length; ++i) data[i] ^= key;
+}
 
-    string encryptedContent((istreambuf_iterator<char>(infile)), istreambuf_iterator<char>());
-    infile.close();
+bool Client::decryptAndPrepareExam(const string& filePath, char key) {
+    // Drop the paper of any previous exam
+    if (paperMap) munmap(paperMap, paperLength);
+    paperMap = nullptr;
+    paperLength = 0;
+    paper = CompiledExam();
+    shuffledQuestionMap.clear();
+    shuffledOptionMap.clear();
 
-    // XOR decrypt the content with the given key
-    for (char &ch : encryptedContent) {
-        ch ^= key;
+    // Map a private copy of the encrypted paper: questions are decrypted in place, one at a
+    // time when first shown, and nothing is written back to the file
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd == -1) {
+        cerr << "[-] Error: Could not open file " << filePath << endl;
+        return false;
     }
-
-    vector<string> questions;
-    vector<vector<string>> options;
-
-    istringstream iss(encryptedContent);
-    string line, currentQuestion, optionA, optionB, optionC, optionD;
-    bool readingOptions = false;
-    vector<string> tempOptions;
-
-    // Parse the decrypted content line by line
-    while (getline(iss, line)) {
-        // If line starts with "Q:", it marks the start of a new question
-        if (line.rfind("Q:", 0) == 0) {
-            // If there is an existing question with exactly 4 options, save them
-            if (!currentQuestion.empty() && tempOptions.size() == 4) {
-                questions.push_back(currentQuestion);
-                options.push_back(tempOptions);
-            }
-            currentQuestion = line.substr(2);
-            tempOptions.clear();
-            readingOptions = false;
-        } 
-        // Lines starting with "A)", "B)", "C)", or "D)" are answer options
-        else if (line.rfind("A)", 0) == 0 || line.rfind("B)", 0) == 0 ||
-                 line.rfind("C)", 0) == 0 || line.rfind("D)", 0) == 0) {
-            tempOptions.push_back(line.substr(2));
-            readingOptions = true;
-        } 
-        // For lines that are part of a multiline question text (not options)
-        else if (!readingOptions) {
-            if (!currentQuestion.empty()) currentQuestion += "\n";
-            currentQuestion += line;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            paperMap = static_cast<char*>(mapped);
+            paperLength = st.st_size;
         }
     }
-
-    // After parsing all lines, add the last question and options if valid
-    if (!currentQuestion.empty() && tempOptions.size() == 4) {
-        questions.push_back(currentQuestion);
-        options.push_back(tempOptions);
+    close(fd);
+    paperKey = key;
+
+    // Only the header and the offset table are decrypted up front
+    bool valid = false;
+    if (paperLength >= CompiledExam::HEADER_SIZE) {
+        xorBytes(paperMap, CompiledExam::HEADER_SIZE, key);
+        uint32_t count;
+        memcpy(&count, paperMap + 4, sizeof(count));
+        size_t tableBytes = ((size_t)ntohl(count) + 1) * 4;
+        if (tableBytes <= paperLength - CompiledExam::HEADER_SIZE) {
+            xorBytes(paperMap + CompiledExam::HEADER_SIZE, tableBytes, key);
+            valid = paper.open(paperMap, paperLength);
+        }
     }
-
-    if (questions.empty()) {
-        cerr << "[-] Error: No valid questions found in decrypted content.\n";
-        return;
+    if (!valid || paper.size() == 0) {
+        // Most likely a paper saved by an older client; it is downloaded again next time
+        cerr << "[-] Error: No valid questions found in the stored exam paper.\n";
+        remove(filePath.c_str());
+        return false;
     }
+    paperDecoded.assign(paper.size(), false);
 
     // Shuffle the question indices to randomize question order
-    int n = questions.size();
+    int n = paper.size();
     vector<int> qIndices(n);
     iota(qIndices.begin(), qIndices.end(), 0);
 
@@ -146,31 +198,16 @@ void Client::decryptAndPrepareExam(const string& filePath, char key) {
     mt19937 g(rd());
     shuffle(qIndices.begin(), qIndices.end(), g);
 
-    shuffledQuestionMap.clear();
-    shuffledQuestions.clear();
-    shuffledOptions.clear();
-    shuffledOptionMap.clear();
-
-    // Rebuild the shuffled questions and options using the shuffled indices
+    // Only the order is prepared here; the text is read from the paper when shown
     for (int i = 0; i < n; ++i) {
-        int origIdx = qIndices[i];
-        shuffledQuestionMap[i] = origIdx;
-        shuffledQuestions.push_back(questions[origIdx]);
+        shuffledQuestionMap[i] = qIndices[i];
 
+        // Shuffle the order of the options for this question
         vector<int> optIdx = {0, 1, 2, 3};
         shuffle(optIdx.begin(), optIdx.end(), g);
-
-        // Shuffle the order of the options for this question
-        vector<string> shuffledOpts(4);
-        vector<int> optMapping(4);
-        for (int j = 0; j < 4; ++j) {
-            shuffledOpts[j] = options[origIdx][optIdx[j]];
-            optMapping[j] = optIdx[j];
-        }
-
-        shuffledOptions.push_back(shuffledOpts);
-        shuffledOptionMap.push_back(optMapping);
+        shuffledOptionMap.push_back(optIdx);
     }
+    return true;
 }
 
 void* examTimer(void* arg) {
@@ -217,15 +254,27 @@ void* examTimer(void* arg) {
 
 void Client::displayPreparedQuestion(int index) {
     cout << "\n\n--------------------------------QUESTION "<<index+1<<"-------------------------------\n";
-    if (index < 0 || index >= shuffledQuestions.size()) {
+    if (index < 0 || index >= shuffledOptionMap.size()) {
         cout << "Invalid question index.\n";
         return;
     }
 
-    cout << "Q" << (index + 1) << ": " << shuffledQuestions[index] << "\n";
+    int origIdx = shuffledQuestionMap[index];
+    size_t begin, length;
+    if (!paperDecoded[origIdx] && paper.record(origIdx, begin, length)) {
+        xorBytes(paperMap + begin, length, paperKey);
+        paperDecoded[origIdx] = true;
+    }
+    string_view text, options[4];
+    if (!paper.question(origIdx, text, options)) {
+        cout << "Invalid question index.\n";
+        return;
+    }
+
+    cout << "Q" << (index + 1) << ": " << text << "\n";
     for (int i = 0; i < 4; ++i) {
         char label = 'A' + i;
-        cout << label << ") " << shuffledOptions[index][i] << "\n";
+        cout << label << ") " << options[shuffledOptionMap[index][i]] << "\n";
     }
     cout << "-----------------------------QUESTION END--------------------------------\n";
 }
@@ -260,8 +309,8 @@ void Client::backupExamData(string &examName, const string &finalData) {
 
 void Client::manageExam(int durationMinutes, Client* client, string examName) {
     int durationSeconds = durationMinutes * 60;
-    vector<int> studentAnswers(shuffledQuestions.size(), -1);
-    vector<int> timeSpent(shuffledQuestions.size(), 0);
+    vector<int> studentAnswers(shuffledOptionMap.size(), -1);
+    vector<int> timeSpent(shuffledOptionMap.size(), 0);
 
     Client::timeSpentPerQuestion.clear();
 
@@ -320,7 +369,7 @@ void Client::manageExam(int durationMinutes, Client* client, string examName) {
         switch (opt) {
             case 0: // to handle auto submission
             case 1: // Next question
-                if (currentIndex < shuffledQuestions.size() - 1) currentIndex++;
+                if (currentIndex < shuffledOptionMap.size() - 1) currentIndex++;
                 else message = "\n[!] You are on the last question.\n";
                 break;
 
@@ -341,7 +390,7 @@ void Client::manageExam(int durationMinutes, Client* client, string examName) {
                     int originalOptionIndex = shuffledOptionMap[currentIndex][shuffledIndex];
                     studentAnswers[currentIndex] = originalOptionIndex;
 
-                    if (currentIndex < shuffledQuestions.size() - 1) currentIndex++;
+                    if (currentIndex < shuffledOptionMap.size() - 1) currentIndex++;
                     else message = "\n[!] You are on the last question.\n";
                 } else {
                     message = "[✖] Invalid choice. Please enter A/B/C/D.\n";
@@ -356,9 +405,9 @@ void Client::manageExam(int durationMinutes, Client* client, string examName) {
 
             case 5: { // Jump to question
                 int qno;
-                cout << "\n🔢 Enter question number (1 to " << shuffledQuestions.size() << "): ";
-                qno = userInput("",1,shuffledQuestions.size());
-                if (qno >= 1 && qno <= shuffledQuestions.size()) {
+                cout << "\n🔢 Enter question number (1 to " << shuffledOptionMap.size() << "): ";
+                qno = userInput("",1,shuffledOptionMap.size());
+                if (qno >= 1 && qno <= shuffledOptionMap.size()) {
                     currentIndex = qno - 1;
                 } else {
                     message = "[✖] Invalid question number.\n";
@@ -418,11 +467,10 @@ void Client::manageExam(int durationMinutes, Client* client, string examName) {
     }
     
     string finalData =  dataToSend.str();
-    send(client->sock, finalData.c_str(), finalData.size(), 0);
+    sendFrame(client->sock, finalData);
 
-    char mesg[32]={0};
-    int bytesReceived = recv(client->sock, mesg, sizeof(mesg), 0);
-    if (bytesReceived <= 0) {
+    string mesg;
+    if (!recvFrame(client->sock, mesg)) {
         cerr << "[!] Failed to send data to server. Error or connection closed.\n";
         finalData = examName + "\n" + finalData;
         backupExamData(examName,finalData);
@@ -431,11 +479,10 @@ void Client::manageExam(int durationMinutes, Client* client, string examName) {
 
 void Client::dashboard(Client * client) {
     int sockfd = client->sock;
-    char buffer[1028];
+    string buffer;
 
     while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        recv(sockfd, buffer, sizeof(buffer), 0);
+        if (!recvFrame(sockfd, buffer)) return;
 
         system("clear");
         usleep(200000);
@@ -447,13 +494,12 @@ void Client::dashboard(Client * client) {
         // User selects an exam (or 0 to go back)
         int input = userInput("",0,100);
         string examSelection = to_string(input);
-        send(sockfd, examSelection.c_str(), examSelection.size(), 0);
+        sendFrame(sockfd, examSelection);
 
         if (input == 0) break;
     
-        memset(buffer, 0, sizeof(buffer));
         // Receive exam attempt info or error message
-        recv(sockfd, buffer, sizeof(buffer), 0);
+        if (!recvFrame(sockfd, buffer)) return;
         cout << buffer;
         string mesg(buffer);
         if(mesg=="[!] Invalid option! please select a valid exam."){
@@ -464,28 +510,27 @@ void Client::dashboard(Client * client) {
         // User selects an attempt number (or 0 to go back)
         input = userInput("", 0, 100);
         examSelection = to_string(input);
-        send(sockfd, examSelection.c_str(), examSelection.size(), 0);
+        sendFrame(sockfd, examSelection);
 
         if (input == 0) continue;
 
-        memset(buffer, 0, sizeof(buffer));
-        recv(sockfd, buffer, sizeof(buffer), 0);
+        if (!recvFrame(sockfd, buffer)) return;
         system("clear");
         cout << buffer << endl;
 
         string mesg1(buffer);
-        if(mesg1=="[!] Invalid option! please select a valid attempt."){
+        if(mesg1=="[!] Invalid option! please select a valid attempt." ||
+           mesg1.rfind("Error: Performance file not found.", 0) == 0){
             cout << endl;
             continue;
         }
         if(mesg1 == "Exam is still going on."){
             return;
         }
-        sleep(2);
 
         // Receive exam questions
-        char questionBuffer[5120];
-        recv(sockfd, questionBuffer, sizeof(questionBuffer), 0);
+        string questionBuffer;
+        if (!recvFrame(sockfd, questionBuffer)) return;
 
         string receivedData(questionBuffer);
 
@@ -503,7 +548,6 @@ void Client::dashboard(Client * client) {
             chmod(filename.c_str(), S_IRUSR | S_IRGRP | S_IROTH);
         }
         cout << "\n[+] Exam questions saved to : " << filename << endl;
-        memset(questionBuffer, 0, sizeof(questionBuffer));
 
         string options = "\n--------------------------------------------\n";
         options += "[1] View Exam Analysis\n";
@@ -514,26 +558,40 @@ void Client::dashboard(Client * client) {
 
         input = userInput("",0,1);
         examSelection = to_string(input);
-        send(sockfd, examSelection.c_str(), examSelection.size(), 0);
+        sendFrame(sockfd, examSelection);
 
         if (input == 0) continue;
 
-        // Receive and display exam analysis parts
-        memset(questionBuffer, 0, sizeof(questionBuffer));
-        recv(sockfd, questionBuffer, sizeof(questionBuffer), 0);
-        cout << questionBuffer <<endl;
+        // Receive and display exam analysis parts as they arrive
+        if (!recvAndPrint(sockfd, questionBuffer)) return;
+        if (!recvAndPrint(sockfd, questionBuffer)) return;
 
-        memset(questionBuffer, 0, sizeof(questionBuffer));
-        recv(sockfd, questionBuffer, sizeof(questionBuffer), 0);
-        cout << questionBuffer << endl;
-        
-        cout <<"\npress any key...\n";
-        cin.get();
-        cin.ignore();
+        if (questionBuffer == "The possible cause may be that no student has attempted this exam.") {
+            cout <<"\npress any key...\n";
+            cin.get();
+            cin.ignore();
+            break;
+        }
+
+        // Page through the leaderboard until the student goes back to the menu
+        if (!pageLeaderboard(sockfd, false)) return;
         break;
     }
 }
 
+// A marking scheme as shown before an exam: "+4/-1" -> "+4 for correct, -1 for incorrect"
+static string describeScheme(const string& scheme) {
+    vector<string> marks;
+    istringstream iss(scheme);
+    string mark;
+    while (getline(iss, mark, '/')) marks.push_back(mark);
+    if (marks.size() < 2) return scheme;
+
+    string text = marks[0] + " for correct, " + marks[1] + " for incorrect";
+    if (marks.size() > 2) text += ", " + marks[2] + " if unanswered";
+    return text;
+}
+
 void Client::parseAvailableExams(const string& examData) {
     availableExams.clear();
     istringstream iss(examData);
@@ -548,6 +606,7 @@ void Client::parseAvailableExams(const string& examData) {
         size_t pos4 = line.find("| Duration (minutes):");
         size_t pos5 = line.find("| Total Questions:");
         size_t pos6 = line.find("| Instructor:");
+        size_t pos7 = line.find("| Marking Scheme:");
 
         if (pos1 != string::npos && pos2 != string::npos && pos3 != string::npos && pos4 != string::npos && pos5 != string::npos && pos6 != string::npos) {
             string name       = line.substr(pos1 + 10, pos2 - (pos1 + 10));
@@ -555,17 +614,21 @@ void Client::parseAvailableExams(const string& examData) {
             string startTime  = line.substr(pos3 + 13, pos4 - (pos3 + 13));
             int duration      = stoi(line.substr(pos4 + 22, pos5 - (pos4 + 22)));
             int totalQ        = stoi(line.substr(pos5 + 19, pos6 - (pos5 + 19)));
-            string instructor = line.substr(pos6 + 13);
-            availableExams.emplace_back(name, type, startTime, duration, totalQ, instructor);        }
+            string instructor = line.substr(pos6 + 13, pos7 == string::npos ? string::npos : pos7 - (pos6 + 13));
+            // Servers without marking schemes mark every exam +4/-1
+            string scheme = "+4/-1";
+            if (pos7 != string::npos) {
+                scheme = line.substr(pos7 + 18);
+                scheme = scheme.substr(0, scheme.find(" |"));
+            }
+            availableExams.emplace_back(name, type, startTime, duration, totalQ, instructor, scheme);        }
     }
 }
 
 void Client::handleExamSelection(Client* client, int& choice) {
-    char buffer[4096];
-    memset(buffer, 0, sizeof(buffer));
+    string buffer;
     // Receive list of available exams from server
-    int bytes_read = recv(client->sock, buffer, sizeof(buffer), 0);
-    if (bytes_read <= 0) {
+    if (!recvFrame(client->sock, buffer)) {
         cerr << "[✖] Error: Failed to read data from server\n";
         close(client->sock);
         return;
@@ -600,7 +663,7 @@ void Client::handleExamSelection(Client* client, int& choice) {
     if (choice == 0) {
         // Send cancellation to server and return to menu
         string examSelection = to_string(choice);
-        send(client->sock, examSelection.c_str(), examSelection.size(), 0);
+        sendFrame(client->sock, examSelection);
         return;
     }
 
@@ -621,10 +684,15 @@ void Client::handleExamSelection(Client* client, int& choice) {
     } else {
         // Notify server that local exam copy will be used (negative exam number)
         int examnumber = -choice;
-        send(client->sock, to_string(examnumber).c_str(), to_string(examnumber).size(), 0);
+        sendFrame(client->sock, to_string(examnumber));
     }
 
-    decryptAndPrepareExam(filePath, 'X');
+    if (!decryptAndPrepareExam(filePath, 'X')) {
+        // Nothing to sit; the server goes back to the student menu
+        sendFrame(client->sock, "n");
+        cout << "[!] Select the exam again to download a fresh copy of the paper.\n";
+        return;
+    }
 
     string examType;
     if(selectedExam.type=="g ") examType = "Scheduled Test";
@@ -635,7 +703,7 @@ void Client::handleExamSelection(Client* client, int& choice) {
     cout << "- Start Date & Time :" << selectedExam.start_time << "\n";
     cout << "- Total Questions   : " << selectedExam.totalQuestions << "\n";
     cout << "- Duration          : " << selectedExam.duration << " minutes\n";
-    cout << "- Marking Scheme    : +4 for correct, -1 for incorrect\n";
+    cout << "- Marking Scheme    : " << describeScheme(selectedExam.scheme) << "\n";
     cout << "---------------------------------------------------------\n";
     cout << "Start the exam now? (y for yes, n for no): ";
 
@@ -681,22 +749,18 @@ void Client::handleExamSelection(Client* client, int& choice) {
                 }
                
                 // Notify server that exam will not be started
-                char ch = 'n';
-                send(client->sock, &ch, 1, 0);
+                sendFrame(client->sock, "n");
             }
             else{
                 // Proceed to start the exam
-                send(client->sock, &confirm, 1, 0);
-                sleep(2);
+                sendFrame(client->sock, string(1, confirm));
 
                 // Indicate scheduled exam type to server
-                char type = 's';
-                send(client->sock, &type, 1, 0);
+                sendFrame(client->sock, "s");
 
                 // Check if exam already attempted
-                char retMeg[32]={0};
-                recv(client->sock, retMeg, sizeof(retMeg), 0);
-                string attempted(retMeg);
+                string attempted;
+                recvFrame(client->sock, attempted);
                 if(attempted=="y"){
                     cout << "[✖] You have already attempted this exam. Reattempt is not allowed.\n";
                 }
@@ -707,15 +771,13 @@ void Client::handleExamSelection(Client* client, int& choice) {
         }
         else{
             // For practice tests without specific schedule
-            send(client->sock, &confirm, 1, 0);
-            sleep(2);
-            char type = 'm';
-            send(client->sock, &type, 1, 0);
+            sendFrame(client->sock, string(1, confirm));
+            sendFrame(client->sock, "m");
             manageExam(selectedExam.duration, client, selectedExam.name.c_str());
         }
     } else {
         // User declined to start exam; notify server and return to menu
-        send(client->sock, &confirm, 1, 0);
+        sendFrame(client->sock, string(1, confirm));
         cout << "Returning to student menu.\n";
     }
 }
@@ -736,16 +798,14 @@ void Client::sendPendingAnswerSheet(int clientSocket){
 
     // If no pending answer sheet is found, notify server and return
     if (foundFile.empty()) {
-        char message = 'n';
-        send(clientSocket, &message, 1, 0);
+        sendFrame(clientSocket, "n");
         return;
     }
 
     ifstream inFile(foundFile);
     if (!inFile.is_open()) {
         cerr << "[!] Failed to open: " << foundFile << endl;
-        char message = 'n';
-        send(clientSocket, &message, 1, 0);
+        sendFrame(clientSocket, "n");
         return;
     }
 
@@ -759,14 +819,11 @@ void Client::sendPendingAnswerSheet(int clientSocket){
     inFile.close();
 
     // Send exam name and answers to the server
-    send(clientSocket, examName.c_str(), examName.size(), 0);
-    sleep(1);
-    send(clientSocket, answers.c_str(), answers.size(), 0);
-    sleep(1);
+    sendFrame(clientSocket, examName);
+    sendFrame(clientSocket, answers);
   
-    char mesg[32]={0};
-    int byte_recv = recv(clientSocket, mesg, sizeof(mesg), 0);
-    if(byte_recv<=0){
+    string mesg;
+    if(!recvFrame(clientSocket, mesg)){
         cout << "[!] Failed to send the answer sheet\n";
         return;
     }
@@ -792,7 +849,7 @@ void* Client::studentHandler(void* arg) {
         choice = userInput("",1,3);
 
         sprintf(buffer, "%d", choice);
-        send(client->sock, buffer, strlen(buffer), 0);
+        sendFrame(client->sock, buffer);
 
         if (choice == 3) {
             cout << "Logging out...\n";
@@ -812,15 +869,13 @@ void* Client::studentHandler(void* arg) {
 }
 
 void Client::receiveAndStoreExamQuestions(int sock, int examNumber) {
-    char buffer[4096] = {0};
+    string buffer;
 
     string examSelection = to_string(examNumber);
-    send(sock, examSelection.c_str(), examSelection.size(), 0);
+    sendFrame(sock, examSelection);
 
-    sleep(1);
     // Receive exam questions from the server
-    int bytesReceived = recv(sock, buffer, sizeof(buffer) - 1, 0);
-    if (bytesReceived <= 0) {
+    if (!recvFrame(sock, buffer)) {
         cerr << "Error: Failed to receive exam questions from server.\n";
         return;
     }
@@ -832,14 +887,12 @@ void Client::receiveAndStoreExamQuestions(int sock, int examNumber) {
         return;
     }
 
-    buffer[bytesReceived] = '\0';
-
     // Prepare hidden directory path to store exam questions
     const char* home = getenv("HOME");
     string hiddenDir = string(home) + "/.config/.exam";
     string fileName = hiddenDir + "/" + to_string(examNumber) + ".txt";
 
-    ofstream outFile(fileName);
+    ofstream outFile(fileName, ios::binary);
     if (!outFile) {
         cerr << "Error: Unable to create file " << fileName << "\n";
         return;
@@ -847,7 +900,6 @@ void Client::receiveAndStoreExamQuestions(int sock, int examNumber) {
     outFile << buffer;
     outFile.close();
 
-    memset(buffer,0,sizeof(buffer));
     xorEncryptDecrypt(fileName, 'X');
 
     cout << "[+] Question paper received successfully\n";
@@ -860,16 +912,16 @@ void* Client::instructorHandler(void* arg) {
 
     while (true) {
         UI_elements::displayInstructorMenu();
-        choice = userInput("",1,5);  // Get valid user choice (1-5)
+        choice = userInput("",1,8);  // Get valid user choice (1-8)
         sprintf(buffer, "%d", choice);
-        send(client->sock, buffer, strlen(buffer), 0);  // Send choice to server
+        sendFrame(client->sock, buffer);  // Send choice to server
 
-        if (choice == 5) {
+        if (choice == 8) {
             cout << "Logging out...\n";
             close(client->sock);
             return nullptr;
         } else if (choice == 1) { // Upload new exam
-            string examName, duration, fileName, type, start_time;
+            string examName, duration, fileName, type, start_time, scheme;
             cout << "\n=============Enter exam details=============\n\n";
             cout << "Enter Exam Name: ";
             getline(cin, examName);
@@ -879,6 +931,8 @@ void* Client::instructorHandler(void* arg) {
             getline(cin,duration);
             cout << "Enter Exam File Name: ";
             getline(cin,fileName);
+            cout << "Enter marking scheme as correct/wrong[/unanswered] marks (blank for +4/-1): ";
+            getline(cin,scheme);
 
             // If scheduled exam, get start time
             if(type=="g" || type=="G"){
@@ -892,20 +946,19 @@ void* Client::instructorHandler(void* arg) {
             if(type=="g" || type=="G"){
                 examName += start_time;
             }
-            send(client->sock, examName.c_str(), examName.size(), 0);
+            if (!scheme.empty()) examName += "|" + scheme;
+            sendFrame(client->sock, examName);
 
-            memset(buffer, 0, sizeof(buffer));
-            recv(client->sock, buffer, sizeof(buffer), 0);
-            cout <<buffer << endl;
+            string reply;
+            if (!recvFrame(client->sock, reply)) break;
+            cout << reply << endl;
         } else if (choice==2){
             cout << "\nCurrently this service is not avaliable.\n";
         }
         else if(choice == 3){  // View exam analysis
-            char examBuffer[1024];
-            int bytes_recv = recv(client->sock, examBuffer, sizeof(examBuffer), 0);
-            if(bytes_recv <= 0) break;
+            string exams;
+            if (!recvFrame(client->sock, exams)) break;
 
-            string exams(examBuffer);
             cout << "\n===============================================Available exams for Analysis=============================================\n";
             cout << exams << endl;
             cout << "-----------------------------------------------------------------------------------------------------------------------------\n";
@@ -914,15 +967,11 @@ void* Client::instructorHandler(void* arg) {
             option = userInput("Enter exam number to view analysis: ",1,100);
 
             // Send selected exam number to server
-            char choiceBuffer[10]={0};
-            sprintf(choiceBuffer, "%d", option);
-            send(client->sock, choiceBuffer, strlen(choiceBuffer), 0);
+            sendFrame(client->sock, to_string(option));
 
-            char analysisBuffer[4096];
-            bytes_recv = recv(client->sock, analysisBuffer, sizeof(analysisBuffer), 0);
-            if(bytes_recv <= 0) break;
+            string firstAnalysis;
+            if (!recvText(client->sock, firstAnalysis)) break;
 
-            string firstAnalysis(analysisBuffer);
             if(firstAnalysis=="[!] Invalid exam selection."){
                 cout << firstAnalysis << endl;
                 continue;
@@ -932,38 +981,83 @@ void* Client::instructorHandler(void* arg) {
             cout << firstAnalysis << endl;
             firstAnalysis = "";
 
-            memset(analysisBuffer, 0, sizeof(analysisBuffer));
-            bytes_recv = recv(client->sock, analysisBuffer, sizeof(analysisBuffer), 0);
-            if(bytes_recv <= 0) break;
+            string output;
+            if (!recvAndPrint(client->sock, output)) break;
 
-            cout << analysisBuffer << endl;
-            string output(analysisBuffer);
             if(output=="The possible cause may be that no student has attempted this exam."){
                 continue;
             }
-            memset(analysisBuffer, 0, sizeof(analysisBuffer));
 
-            // Loop to view analysis of individual students
-            while(true){
-                choice = userInput("Select student sr no. to view analysis (press 0 to go back to main menu): ",0,100);
+            // Page through the leaderboard and view individual students' attempts
+            if (!pageLeaderboard(client->sock, true)) return nullptr;
+        }
+        else if (choice == 5) {  // Check answer sheets for collusion
+            string exams;
+            if (!recvFrame(client->sock, exams)) break;
 
-                sprintf(buffer, "%d", choice);
-                send(client->sock, buffer, strlen(buffer), 0);
+            cout << "\n===============================Exams to check for similar answer sheets===============================\n";
+            cout << exams << endl;
+            cout << "-------------------------------------------------------------------------------------------------------\n";
+            if(exams=="[!] You have not uploaded any exam.") continue;
+            int option = userInput("Enter exam number to check: ",1,100);
+            sendFrame(client->sock, to_string(option));
 
-                if(choice==0) break;
-                memset(analysisBuffer, 0, sizeof(analysisBuffer));
-                bytes_recv = recv(client->sock, analysisBuffer, sizeof(analysisBuffer), 0);
-                if(bytes_recv <= 0) return nullptr;
+            cout << "[!] Comparing answer sheets...\n";
+            string report;
+            if (!recvAndPrint(client->sock, report)) break;
+        }
+        else if (choice == 6) {  // Correct an answer key and re-grade the exam
+            string exams;
+            if (!recvFrame(client->sock, exams)) break;
 
-                cout << analysisBuffer << endl;
-                memset(analysisBuffer, 0, sizeof(analysisBuffer));
+            cout << "\n===============================Exams to re-grade===============================\n";
+            cout << exams << endl;
+            cout << "-------------------------------------------------------------------------------\n";
+            if(exams=="[!] You have not uploaded any exam.") continue;
+            int option = userInput("Enter exam number to re-grade: ",1,100);
+            sendFrame(client->sock, to_string(option));
+
+            string key;
+            if (!recvFrame(client->sock, key)) break;
+            cout << key << endl;
+            if (key.rfind("[!]", 0) == 0) continue;
+
+            string corrected;
+            cout << "Enter the corrected key (e.g. ABCD..., 0 to cancel): ";
+            getline(cin, corrected);
+            if (corrected.empty()) corrected = "0";
+            sendFrame(client->sock, corrected);
+
+            if (corrected != "0") cout << "[!] Re-grading stored attempts...\n";
+            string result;
+            if (!recvFrame(client->sock, result)) break;
+            cout << result << endl;
+        }
+        else if (choice == 7) {  // Import many exams at once
+            string path, duration, scheme;
+            cout << "\n=============Import exams=============\n\n";
+            cout << "A folder imports each of its .txt exam files as a practice test named after the file.\n";
+            cout << "A manifest file lists one exam per line as name|type|duration|file|start time[|scheme].\n\n";
+            cout << "Enter folder or manifest file (0 to cancel): ";
+            getline(cin, path);
+            if (path != "0") {
+                cout << "Enter duration in minutes for exams in a folder: ";
+                getline(cin, duration);
+                cout << "Enter marking scheme as correct/wrong[/unanswered] marks for exams in a folder (blank for +4/-1): ";
+                getline(cin, scheme);
+                path += "|" + duration + "|" + scheme;
+                cout << "[!] Importing exams...\n";
             }
+            sendFrame(client->sock, path);
+
+            string report;
+            if (!recvAndPrint(client->sock, report)) break;
         }
         else if (choice <= 4) { // Show list of uploaded exams
-            memset(buffer, 0, sizeof(buffer));
-            recv(client->sock, buffer, sizeof(buffer), 0);
+            string uploaded;
+            if (!recvFrame(client->sock, uploaded)) break;
             cout << "\n\n=====================================Your uploaded exams=====================================\n";
-            cout << buffer << endl;
+            cout << uploaded << endl;
             cout << "-----------------------------------------------------------------------------------------------\n";
         } else {
             cout << "Invalid choice! Please select a valid option.\n";
@@ -985,7 +1079,7 @@ void Client::authenticate() {
         if (choice == 3) {
             cout << "Exiting...\n";
             string request = "exit";
-            send(sock, request.c_str(), request.length(), 0);
+            sendFrame(sock, request);
             close(sock);
             exit(0);
         }
@@ -1009,21 +1103,27 @@ void Client::authenticate() {
         string user_type = (role == "s") ? "student" : "instructor";
         string request = (choice == 1) ? "LOGIN " : "REGISTER ";
         request += user_type + " " + username + " " + password;
-        send(sock, request.c_str(), request.length(), 0);
+        sendFrame(sock, request);
 
 
         // Receive and handle server response
-        char response[128] = {0};
-        int bytes_read = recv(sock, response, sizeof(response), 0);
-        if (bytes_read <= 0) {
+        string response;
+        if (!recvFrame(sock, response)) {
             cout << "[✖] Error: Failed to read data from server."<<endl;
             close(sock);
             return;
         }
         string server_reply(response);
+        if (server_reply.rfind("SERVER_BUSY", 0) == 0) {
+            // Server turned the connection away because all workers are busy
+            cout << "[✖] Server is busy. Please retry in" << server_reply.substr(11) << " s." << endl;
+            close(sock);
+            exit(EXIT_FAILURE);
+        }
         if (server_reply == "AUTHENTICATION_SUCCESS" || server_reply == "REGISTER_SUCCESS"){
             cout <<"[✔] " <<server_reply <<endl;
-            usleep(1200000);
+            // Cosmetic: lets the message show before start() clears the screen; the server does not need it
+            usleep(300000);
             break;
         }
         else cout << ((choice == 1) ? "[✖] Login failed! Try again." : "[✖] Registration failed! Username may already exist.") << endl;
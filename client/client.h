@@ -17,6 +17,8 @@
 #include <fstream>
 #include <chrono>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <cstring>
 #include <ctime>
 #include <filesystem>
@@ -25,6 +27,9 @@
 #include <thread>
 #include <atomic>
 
+#include "protocol.h"
+#include "compiled_exam.h"
+
 using namespace std;
 using namespace std::chrono;
 
@@ -36,7 +41,8 @@ class ExamInfo {
         int duration;
         int totalQuestions;
         string instructor;
-        ExamInfo(string name, string type, string start_time,int duration, int totalQ, string instructor): name(name),type(type), start_time(start_time), duration(duration), totalQuestions(totalQ), instructor(instructor) {}
+        string scheme;      // marks for correct/wrong[/unanswered], e.g. "+4/-1"
+        ExamInfo(string name, string type, string start_time,int duration, int totalQ, string instructor, string scheme): name(name),type(type), start_time(start_time), duration(duration), totalQuestions(totalQ), instructor(instructor), scheme(scheme) {}
 };
 
 class Client {
@@ -46,15 +52,18 @@ private:
 
     static map<int, int> shuffledQuestionMap; 
     static vector<vector<int>> shuffledOptionMap; 
-    static vector<string> shuffledQuestions;
-    static vector<vector<string>> shuffledOptions;
+    static CompiledExam paper;              // view of paperMap
+    static char* paperMap;                  // the stored paper, mapped privately
+    static size_t paperLength;
+    static char paperKey;
+    static vector<bool> paperDecoded;       // questions already decrypted in paperMap
     static map<int, int> timeSpentPerQuestion;
 
     static void* studentHandler(void* arg);
     static void* instructorHandler(void* arg);
 
     static void manageExam(int duration, Client* client, string examname);
-    static void decryptAndPrepareExam(const string& filePath, char key);
+    static bool decryptAndPrepareExam(const string& filePath, char key);
     static void xorEncryptDecrypt(const string& filePath, char key);
     static void receiveAndStoreExamQuestions(int sock, int examNumber); 
     static void dashboard(Client * client);
@@ -65,6 +74,9 @@ private:
     static void backupExamData(string &examName, const string &finalData);
     static void sendPendingAnswerSheet(int clientSocket);
     static int userInput(const string& prompt, int minVal, int maxVal);
+    static bool recvAndPrint(int sock, string& text);
+    static bool leaderboardCommand(const string& input, string& command);
+    static bool pageLeaderboard(int sock, bool instructor);
     void authenticate();
 
 public:
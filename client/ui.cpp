@@ -35,7 +35,10 @@ void UI_elements::displayInstructorMenu() {
     cout << "2. Upload Seating Pattern\n";
     cout << "3. Show Student Performance\n";
     cout << "4. View Uploaded Exams\n";
-    cout << "5. Logout\n";
+    cout << "5. Check Answer Similarity\n";
+    cout << "6. Re-grade Exam\n";
+    cout << "7. Import Exams\n";
+    cout << "8. Logout\n";
     cout << "------------------------------\n";
     cout << "Choose an option: ";
 }
@@ -0,0 +1,136 @@
+#include "compiled_exam.h"
+
+#include <cstring>
+#include <arpa/inet.h>
+
+static const char MAGIC[4] = {'E', 'X', 'M', '1'};
+
+static void appendU32(string& out, uint32_t value) {
+    uint32_t net = htonl(value);
+    out.append(reinterpret_cast<const char*>(&net), sizeof(net));
+}
+
+static uint32_t readU32(const char* at) {
+    uint32_t net;
+    memcpy(&net, at, sizeof(net));
+    return ntohl(net);
+}
+
+// Bytes taken by one question in the string area
+static size_t recordSize(const CompiledExam::Question& q) {
+    size_t size = 4 + q.text.size();
+    for (const string_view& option : q.options) size += 4 + option.size();
+    return size;
+}
+
+size_t CompiledExam::compiledSize(const vector<Question>& questions) {
+    size_t size = HEADER_SIZE + (questions.size() + 1) * 4;
+    for (const Question& q : questions) size += recordSize(q);
+    return size;
+}
+
+/**
+ * Lays out a paper in the compiled format, in one sequential pass.
+ *
+ * @param questions The questions in paper order, each with its four options.
+ * @param out The compiled paper is appended to it (e.g. after a frame header).
+ */
+void CompiledExam::compile(const vector<Question>& questions, string& out) {
+    size_t size = compiledSize(questions);
+    out.reserve(out.size() + size);
+    out.append(MAGIC, sizeof(MAGIC));
+    appendU32(out, questions.size());
+    appendU32(out, size - HEADER_SIZE - (questions.size() + 1) * 4);
+
+    uint32_t offset = 0;
+    for (const Question& q : questions) {
+        appendU32(out, offset);
+        offset += recordSize(q);
+    }
+    appendU32(out, offset);
+
+    for (const Question& q : questions) {
+        appendU32(out, q.text.size());
+        out.append(q.text);
+        for (const string_view& option : q.options) {
+            appendU32(out, option.size());
+            out.append(option);
+        }
+    }
+}
+
+/**
+ * Views a compiled paper.
+ *
+ * @param paper The compiled bytes; they must outlive this view.
+ * @param length Number of bytes.
+ * @return False if the header or the offset table does not describe a paper of this length.
+ */
+bool CompiledExam::open(const char* paper, size_t length) {
+    data = nullptr;
+    count = 0;
+    if (length < HEADER_SIZE || memcmp(paper, MAGIC, sizeof(MAGIC)) != 0) return false;
+
+    size_t questions = readU32(paper + 4);
+    size_t stringBytes = readU32(paper + 8);
+    if ((length - HEADER_SIZE) / 4 < questions + 1) return false;
+    size_t tableEnd = HEADER_SIZE + (questions + 1) * 4;
+    if (length - tableEnd != stringBytes) return false;
+
+    // Offsets must climb through the string area and end exactly at its end
+    uint32_t previous = 0;
+    for (size_t i = 0; i <= questions; ++i) {
+        uint32_t off = readU32(paper + HEADER_SIZE + i * 4);
+        if (off < previous || off > stringBytes) return false;
+        previous = off;
+    }
+    if (previous != stringBytes) return false;
+
+    data = paper;
+    count = questions;
+    stringsBegin = tableEnd;
+    return true;
+}
+
+uint32_t CompiledExam::offset(size_t index) const {
+    return readU32(data + HEADER_SIZE + index * 4);
+}
+
+/**
+ * Locates the bytes of one question (text and options) within the paper.
+ *
+ * @param index 0-based question number.
+ * @param begin Receives the position of the question's record from the start of the paper.
+ * @param length Receives the size of the record.
+ * @return False if there is no such question.
+ */
+bool CompiledExam::record(size_t index, size_t& begin, size_t& length) const {
+    if (index >= count) return false;
+    begin = stringsBegin + offset(index);
+    length = offset(index + 1) - offset(index);
+    return true;
+}
+
+/**
+ * Reads one question without touching the rest of the paper.
+ *
+ * @param index 0-based question number.
+ * @param text Receives the question text.
+ * @param options Receives options A-D.
+ * @return False if there is no such question or its record is malformed.
+ */
+bool CompiledExam::question(size_t index, string_view& text, string_view (&options)[4]) const {
+    size_t begin, length;
+    if (!record(index, begin, length)) return false;
+    const char* at = data + begin;
+    const char* end = at + length;
+    for (int field = 0; field < 5; ++field) {
+        if (end - at < 4) return false;
+        uint32_t size = readU32(at);
+        at += 4;
+        if ((size_t)(end - at) < size) return false;
+        (field == 0 ? text : options[field - 1]) = string_view(at, size);
+        at += size;
+    }
+    return at == end;
+}
@@ -0,0 +1,53 @@
+#ifndef COMPILED_EXAM_H
+#define COMPILED_EXAM_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Compiled question paper: the form a paper is stored in on the server and sent to
+ * clients, laid out so that question i is found in O(1) without parsing the others.
+ *
+ *   [ magic "EXM1" ][ question count : 4 bytes ][ string area size : 4 bytes ]
+ *   [ offset table : (count + 1) x 4 bytes, start of each question in the string area ]
+ *   [ string area : per question, the text and options A-D, each as a
+ *                   4-byte length followed by the bytes ]
+ *
+ * Integers are in network byte order, as in frame headers. The answer key is not part
+ * of the paper; it stays on the server.
+ *
+ * A CompiledExam only views bytes it does not own (a buffer or a mapped file), so
+ * opening a paper checks the header and the offset table and reads nothing else.
+ */
+class CompiledExam {
+public:
+    // A question to compile; the views must stay valid until compile() returns
+    struct Question {
+        string_view text;
+        string_view options[4];
+    };
+
+    static const size_t HEADER_SIZE = 12;
+
+    static size_t compiledSize(const vector<Question>& questions);
+    static void compile(const vector<Question>& questions, string& out);
+
+    bool open(const char* data, size_t length);
+    size_t size() const { return count; }
+    bool record(size_t index, size_t& begin, size_t& length) const;
+    bool question(size_t index, string_view& text, string_view (&options)[4]) const;
+
+private:
+    const char* data = nullptr;
+    size_t count = 0;
+    size_t stringsBegin = 0;
+
+    uint32_t offset(size_t index) const;
+};
+
+#endif
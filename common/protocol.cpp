@@ -0,0 +1,118 @@
+#include "protocol.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+string encodeFrameHeader(uint32_t length, uint8_t type) {
+    char header[FRAME_HEADER_SIZE];
+    uint32_t netLength = htonl(length);
+    header[0] = static_cast<char>(type);
+    memcpy(header + 1, &netLength, sizeof(netLength));
+    return string(header, FRAME_HEADER_SIZE);
+}
+
+string encodeFrame(const string& payload, uint8_t type) {
+    return encodeFrameHeader(payload.size(), type) + payload;
+}
+
+vector<string> encodeTextParts(const string& text, size_t partSize) {
+    vector<string> frames;
+    size_t start = 0;
+    while (text.size() - start > partSize) {
+        // Cut after the last newline of the piece so every piece prints whole lines
+        size_t cut = text.rfind('\n', start + partSize - 1);
+        size_t end = (cut == string::npos || cut < start) ? start + partSize : cut + 1;
+        frames.push_back(encodeFrame(text.substr(start, end - start), MSG_PART));
+        start = end;
+    }
+    frames.push_back(encodeFrame(text.substr(start), MSG_TEXT));
+    return frames;
+}
+
+bool sendAll(int sock, const char* data, size_t length) {
+    size_t sent = 0;
+    while (sent < length) {
+        ssize_t n = send(sock, data + sent, length - sent, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool recvAll(int sock, char* data, size_t length) {
+    size_t received = 0;
+    while (received < length) {
+        ssize_t n = recv(sock, data + received, length - received, 0);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        received += n;
+    }
+    return true;
+}
+
+bool sendFrame(int sock, const string& payload, uint8_t type) {
+    string frame = encodeFrame(payload, type);
+    return sendAll(sock, frame.data(), frame.size());
+}
+
+bool recvFrame(int sock, string& payload, uint8_t* type) {
+    char header[FRAME_HEADER_SIZE];
+    if (!recvAll(sock, header, FRAME_HEADER_SIZE)) return false;
+
+    uint32_t netLength;
+    memcpy(&netLength, header + 1, sizeof(netLength));
+    uint32_t length = ntohl(netLength);
+    if (length > MAX_FRAME_SIZE) return false;
+
+    if (type) *type = static_cast<uint8_t>(header[0]);
+    payload.resize(length);
+    return length == 0 || recvAll(sock, &payload[0], length);
+}
+
+bool recvText(int sock, string& text, const function<void(const string&)>& onPart) {
+    text.clear();
+    string piece;
+    uint8_t type;
+    do {
+        if (!recvFrame(sock, piece, &type)) return false;
+        if (onPart) onPart(piece);
+        text += piece;
+    } while (type == MSG_PART);
+    return true;
+}
+
+void FrameDecoder::feed(const char* data, size_t length) {
+    // Drop bytes of frames already handed out before growing the buffer
+    if (offset > 0) {
+        buffer.erase(0, offset);
+        offset = 0;
+    }
+    buffer.append(data, length);
+}
+
+bool FrameDecoder::next(string& payload, uint8_t* type) {
+    if (broken || buffer.size() - offset < FRAME_HEADER_SIZE) return false;
+
+    uint32_t netLength;
+    memcpy(&netLength, buffer.data() + offset + 1, sizeof(netLength));
+    uint32_t length = ntohl(netLength);
+    if (length > MAX_FRAME_SIZE) {
+        broken = true;
+        return false;
+    }
+    if (buffer.size() - offset < FRAME_HEADER_SIZE + length) return false;
+
+    if (type) *type = static_cast<uint8_t>(buffer[offset]);
+    payload.assign(buffer, offset + FRAME_HEADER_SIZE, length);
+    offset += FRAME_HEADER_SIZE + length;
+
+    if (offset == buffer.size()) {
+        buffer.clear();
+        offset = 0;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Framed message layer shared by the client and the server.
+ *
+ * Every message on the wire is a 5-byte header followed by the payload:
+ *
+ *   [ type : 1 byte ][ payload length : 4 bytes, network byte order ][ payload ]
+ *
+ * Message boundaries come from the header, so consecutive messages may share a
+ * TCP segment and a large message may arrive across many recv() calls.
+ */
+
+enum MessageType : uint8_t {
+    MSG_TEXT = 1,    // menu choices, prompts, reports and other text
+    MSG_PART = 2,    // leading piece of a long text; more pieces follow, the last one as MSG_TEXT
+};
+
+const size_t FRAME_HEADER_SIZE = 5;
+const uint32_t MAX_FRAME_SIZE = 64 * 1024 * 1024;   // refuse absurd lengths from a broken peer
+const size_t TEXT_PART_SIZE = 16 * 1024;            // long reports are sent in pieces of about this size
+
+// Builds the 5-byte header for a payload of the given length
+string encodeFrameHeader(uint32_t length, uint8_t type = MSG_TEXT);
+
+// Builds a complete frame (header + payload)
+string encodeFrame(const string& payload, uint8_t type = MSG_TEXT);
+
+// Splits a text into MSG_PART frames cut at line ends, closed by a MSG_TEXT frame
+vector<string> encodeTextParts(const string& text, size_t partSize = TEXT_PART_SIZE);
+
+// Writes all bytes, retrying on short writes; false if the connection failed
+bool sendAll(int sock, const char* data, size_t length);
+
+// Reads exactly length bytes, retrying on short reads; false on EOF or error
+bool recvAll(int sock, char* data, size_t length);
+
+// Sends one framed message on a blocking socket
+bool sendFrame(int sock, const string& payload, uint8_t type = MSG_TEXT);
+
+// Receives one framed message on a blocking socket; false on EOF, error or bad header
+bool recvFrame(int sock, string& payload, uint8_t* type = nullptr);
+
+// Receives one text that may arrive in MSG_PART pieces; onPart sees each piece as it arrives
+bool recvText(int sock, string& text, const function<void(const string&)>& onPart = nullptr);
+
+/**
+ * Incremental frame parser for non-blocking sockets: bytes are fed in as they
+ * arrive and complete frames are taken out one at a time.
+ */
+class FrameDecoder {
+public:
+    void feed(const char* data, size_t length);
+    bool next(string& payload, uint8_t* type = nullptr);
+    bool failed() const { return broken; }
+
+private:
+    string buffer;
+    size_t offset = 0;
+    bool broken = false;
+};
+
+#endif
@@ -0,0 +1,183 @@
+// analysis_bench.cpp
+// Times the analysis kernels, leaderboard rendering and the answer-similarity check on a
+// synthetic cohort, first on the serial path and then split across the analysis pool,
+// and checks both agree. The similarity check compares every pair of students, so it
+// runs on a cohort of at most 20000. Grading a submitted sheet is timed with the
+// compiled-in +4/-1 kernel against the generic kernel used for custom marking schemes.
+//
+// Usage: ./analysis_bench [rows] [questions] [threads]
+//        (defaults: 1000000 rows, 20 questions, one thread per CPU core)
+
+#include "analysis_columns.h"
+#include "analysis_pool.h"
+#include "collusion.h"
+#include "leaderboard.h"
+#include "marking_scheme.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+// Fills a snapshot with deterministic pseudo-random attempts
+static ColumnSnapshot makeCohort(size_t rows, int questions) {
+    ColumnSnapshot cohort;
+    for (int q = 0; q < questions; ++q) cohort.correctAnswers.push_back("ABCD"[q % 4]);
+
+    uint32_t seed = 12345;
+    auto next = [&]() {
+        seed = seed * 1103515245u + 12345u;
+        return seed >> 8;
+    };
+    for (size_t first = 0; first < rows; first += AnalysisColumns::ROWS_PER_GROUP) {
+        auto group = make_shared<RowGroup>();
+        group->rows = min(rows - first, AnalysisColumns::ROWS_PER_GROUP);
+        for (size_t r = 0; r < group->rows; ++r) {
+            group->studentIds.push_back("s" + to_string(first + r));
+            group->students.push_back(r);
+        }
+        group->answers.assign(questions, vector<uint8_t>(group->rows));
+        group->times.assign(questions, vector<uint16_t>(group->rows));
+        for (int q = 0; q < questions; ++q) {
+            for (size_t r = 0; r < group->rows; ++r) {
+                uint32_t answer = next() % 5;
+                group->answers[q][r] = answer == 4 ? RowGroup::SKIPPED : answer;
+                group->times[q][r] = next() % 300;
+            }
+        }
+        cohort.groups.push_back(group);
+    }
+    cohort.rows = rows;
+    return cohort;
+}
+
+// Best of a few runs, in milliseconds
+template <typename F>
+static double timeBest(F run, int runs = 5) {
+    double best = 1e300;
+    for (int i = 0; i < runs; ++i) {
+        auto start = chrono::steady_clock::now();
+        run();
+        best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static bool sameTotals(const ColumnTotals& a, const ColumnTotals& b) {
+    if (a.rowCorrect != b.rowCorrect || a.rowSkipped != b.rowSkipped || a.rowTime != b.rowTime) return false;
+    if (a.questions.size() != b.questions.size()) return false;
+    for (size_t q = 0; q < a.questions.size(); ++q) {
+        const ColumnTotals::Question& x = a.questions[q];
+        const ColumnTotals::Question& y = b.questions[q];
+        if (memcmp(x.optionCount, y.optionCount, sizeof(x.optionCount)) != 0 || x.skipped != y.skipped ||
+            x.corrects != y.corrects || x.totalTime != y.totalTime) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void report(const string& name, double serial, double parallel) {
+    cout << "    " << setw(12) << left << name
+         << " serial " << setw(9) << right << fixed << setprecision(1) << serial << " ms"
+         << "   parallel " << setw(9) << parallel << " ms"
+         << "   " << setprecision(2) << serial / parallel << "x" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    int questions = argc > 2 ? atoi(argv[2]) : 20;
+    int threads = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (rows == 0 || questions < 1 || threads < 1) {
+        cerr << "Usage: ./analysis_bench [rows] [questions] [threads]" << endl;
+        return 1;
+    }
+
+    cout << "[+] " << rows << " rows x " << questions << " questions, " << threads << " thread(s)" << endl;
+    ColumnSnapshot cohort = makeCohort(rows, questions);
+
+    // Leaderboard rows, scored once; rendering is what the instructor's connection waits on
+    ColumnTotals scored;
+    cohort.aggregate(0, rows, scored);
+    vector<RankEntry> leaderboard(rows);
+    for (size_t r = 0; r < rows; ++r) {
+        leaderboard[r] = RankEntry{cohort.studentId(r), scored.score(r), (double)scored.rowTime[r],
+                                   scored.attempted(r), scored.wrong(r), (int)r};
+    }
+
+    // One answer sheet per student of a scheduled-exam-sized cohort
+    size_t students = min(rows, (size_t)20000);
+    AnswerSheets sheets;
+    sheets.reset(cohort.correctAnswers);
+    sheets.add(makeCohort(students, questions));
+
+    // Sheets as submissions carry them (option index, -1 when skipped), graded one at a time
+    size_t graded = min(rows, (size_t)200000);
+    vector<int8_t> sheetAnswers(graded * questions), key(questions), marks(questions);
+    for (int q = 0; q < questions; ++q) key[q] = cohort.correctAnswers[q] - 'A';
+    for (size_t r = 0; r < graded; ++r) {
+        for (int q = 0; q < questions; ++q) {
+            char answer = cohort.answer(r, q);
+            sheetAnswers[r * questions + q] = answer == '-' ? -1 : answer - 'A';
+        }
+    }
+    MarkingScheme fixedScheme, customScheme{5, -2, 0};
+    vector<int> fixedTotals(graded);
+    long long customSum = 0;
+    double fixedGrade = timeBest([&]() {
+        SheetGrader grade = fixedScheme.grader();
+        for (size_t r = 0; r < graded; ++r)
+            fixedTotals[r] = grade(fixedScheme, &sheetAnswers[r * questions], key.data(), marks.data(), questions);
+    });
+    double customGrade = timeBest([&]() {
+        SheetGrader grade = customScheme.grader();
+        customSum = 0;
+        for (size_t r = 0; r < graded; ++r)
+            customSum += grade(customScheme, &sheetAnswers[r * questions], key.data(), marks.data(), questions);
+    });
+    bool sameGrades = true;
+    for (size_t r = 0; r < graded; ++r) sameGrades = sameGrades && fixedTotals[r] == scored.score(r);
+
+    // The pool has not been started yet: everything below runs on the serial path
+    ColumnTotals serialTotals;
+    string serialText;
+    vector<SuspiciousPair> serialPairs;
+    double serialAggregate = timeBest([&]() { serialTotals = ColumnTotals(); cohort.aggregate(0, rows, serialTotals); });
+    double serialRender = timeBest([&]() { serialText = Leaderboard::renderRows(leaderboard, 1, questions, MarkingScheme().maxMarks(questions)); });
+    double serialPairsTime = timeBest([&]() { serialPairs = CollusionDetector::findPairs(sheets, 20); }, 1);
+
+    AnalysisPool::start(threads);
+    ColumnTotals parallelTotals;
+    string parallelText;
+    vector<SuspiciousPair> parallelPairs;
+    double parallelAggregate = timeBest([&]() { parallelTotals = ColumnTotals(); cohort.aggregate(0, rows, parallelTotals); });
+    double parallelRender = timeBest([&]() { parallelText = Leaderboard::renderRows(leaderboard, 1, questions, MarkingScheme().maxMarks(questions)); });
+    double parallelPairsTime = timeBest([&]() { parallelPairs = CollusionDetector::findPairs(sheets, 20); }, 1);
+
+    report("aggregate", serialAggregate, parallelAggregate);
+    report("render rows", serialRender, parallelRender);
+    report("sheet pairs", serialPairsTime, parallelPairsTime);
+    cout << "    (" << students << " sheets, " << (uint64_t)students * (students - 1) / 2 << " pairs)" << endl;
+    cout << "    " << setw(12) << left << "grade sheets" << " +4/-1 " << setw(9) << right << setprecision(1) << fixedGrade
+         << " ms   generic  " << setw(9) << customGrade << " ms   (" << graded << " sheets, checksum " << customSum << ")" << endl;
+    if (!sameGrades) {
+        cout << "[✖] Graded sheets disagree with the column scores" << endl;
+        return 1;
+    }
+
+    bool samePairs = serialPairs.size() == parallelPairs.size();
+    for (size_t i = 0; samePairs && i < serialPairs.size(); ++i) {
+        samePairs = serialPairs[i].first == parallelPairs[i].first && serialPairs[i].second == parallelPairs[i].second &&
+                    serialPairs[i].sharedWrong == parallelPairs[i].sharedWrong;
+    }
+    if (!sameTotals(serialTotals, parallelTotals) || serialText != parallelText || !samePairs) {
+        cout << "[✖] Parallel results differ from the serial path" << endl;
+        return 1;
+    }
+    cout << "[✔] Parallel results match the serial path" << endl;
+    return 0;
+}
@@ -0,0 +1,531 @@
+#include "analysis_columns.h"
+#include "analysis_pool.h"
+#include "exam_catalog.h"
+#include "record_io.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+map<string, unique_ptr<AnalysisColumns::ExamColumns>> AnalysisColumns::exams;
+pthread_mutex_t AnalysisColumns::lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char COLUMNS_MAGIC[8] = {'E', 'X', 'A', 'M', 'C', 'O', 'L', '1'};
+static const size_t GROUP_HEADER_SIZE = 8;
+
+string analysisPathOf(const string& examName) {
+    return "../data/results/exam_" + examName + "_analysis.txt";
+}
+
+static string columnsPathOf(const string& examName) {
+    return "../data/results/exam_" + examName + "_analysis.col";
+}
+
+bool readAppendedLines(const string& path, off_t& offset, vector<string>& lines, bool& restarted) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) return false;
+
+    file.seekg(0, ios::end);
+    off_t size = file.tellg();
+    restarted = size < offset;
+    if (restarted) offset = 0;
+    if (size == offset) return true;
+
+    file.seekg(offset);
+    string tail(size - offset, '\0');
+    file.read(&tail[0], tail.size());
+    tail.resize(file.gcount());
+
+    size_t start = 0, end;
+    while ((end = tail.find('\n', start)) != string::npos) {
+        lines.push_back(tail.substr(start, end - start));
+        start = end + 1;
+    }
+    offset += start;
+    return true;
+}
+
+// --- Aggregation kernels ---
+
+#ifdef __SSE2__
+// Sum of the 16 byte lanes of an accumulator
+static uint32_t sumBytes(__m128i acc) {
+    __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+    return _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+}
+
+// Adds the 0/1 bytes of mask (as 0x01 per hit) to 16 uint16 counters
+static void addMask(uint16_t* counters, __m128i hits) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i* out = reinterpret_cast<__m128i*>(counters);
+    _mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), _mm_unpacklo_epi8(hits, zero)));
+    _mm_storeu_si128(out + 1, _mm_add_epi16(_mm_loadu_si128(out + 1), _mm_unpackhi_epi8(hits, zero)));
+}
+#endif
+
+/**
+ * One pass over a question's answer column: option, skip and correct counts for the
+ * question, and per-row correct / skipped counters.
+ */
+static void scanAnswers(const uint8_t* answers, size_t n, uint8_t key, ColumnTotals::Question& totals,
+                        uint16_t* rowCorrect, uint16_t* rowSkipped) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i keys = _mm_set1_epi8((char)key);
+    const __m128i skips = _mm_set1_epi8((char)RowGroup::SKIPPED);
+    __m128i options[5];
+    for (int k = 0; k < 5; ++k) options[k] = _mm_set1_epi8((char)k);
+
+    while (n - i >= 16) {
+        // Byte counters overflow after 255 blocks; fold them into the totals before that
+        size_t blocks = min((n - i) / 16, (size_t)255);
+        __m128i optionAcc[5], skipAcc = _mm_setzero_si128(), correctAcc = _mm_setzero_si128();
+        for (int k = 0; k < 5; ++k) optionAcc[k] = _mm_setzero_si128();
+
+        for (size_t b = 0; b < blocks; ++b, i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(answers + i));
+            for (int k = 0; k < 5; ++k) optionAcc[k] = _mm_sub_epi8(optionAcc[k], _mm_cmpeq_epi8(v, options[k]));
+            __m128i isSkipped = _mm_cmpeq_epi8(v, skips);
+            __m128i isCorrect = _mm_cmpeq_epi8(v, keys);
+            skipAcc = _mm_sub_epi8(skipAcc, isSkipped);
+            correctAcc = _mm_sub_epi8(correctAcc, isCorrect);
+            addMask(rowCorrect + i, _mm_and_si128(isCorrect, one));
+            addMask(rowSkipped + i, _mm_and_si128(isSkipped, one));
+        }
+        for (int k = 0; k < 5; ++k) totals.optionCount[k] += sumBytes(optionAcc[k]);
+        totals.skipped += sumBytes(skipAcc);
+        totals.corrects += sumBytes(correctAcc);
+    }
+#endif
+    for (; i < n; ++i) {
+        uint8_t a = answers[i];
+        if (a < 5) totals.optionCount[a]++;
+        if (a == RowGroup::SKIPPED) {
+            totals.skipped++;
+            rowSkipped[i]++;
+        } else if (a == key) {
+            totals.corrects++;
+            rowCorrect[i]++;
+        }
+    }
+}
+
+// One pass over a question's time column: the question's total and per-row totals
+static void scanTimes(const uint16_t* times, size_t n, uint64_t& total, uint32_t* rowTime) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    while (n - i >= 8) {
+        // Each 32-bit lane takes two times per block; fold before it can overflow
+        size_t blocks = min((n - i) / 8, (size_t)16384);
+        __m128i acc = zero;
+        for (size_t b = 0; b < blocks; ++b, i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(times + i));
+            __m128i lo = _mm_unpacklo_epi16(v, zero), hi = _mm_unpackhi_epi16(v, zero);
+            acc = _mm_add_epi32(acc, _mm_add_epi32(lo, hi));
+            __m128i* out = reinterpret_cast<__m128i*>(rowTime + i);
+            _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), lo));
+            _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), hi));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        total += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+    for (; i < n; ++i) {
+        total += times[i];
+        rowTime[i] += times[i];
+    }
+}
+
+// --- Rows ---
+
+/**
+ * Appends one student line of the analysis file ("id ans time ans time ...") as a row.
+ *
+ * @param line The line, without its newline.
+ * @param dictionary Student ID -> dictionary index of this group.
+ */
+void RowGroup::addRow(const string& line, unordered_map<string, uint32_t>& dictionary) {
+    const char* text = line.c_str();
+    size_t pos = 0, length = line.size();
+    auto token = [&](size_t& start) {
+        while (pos < length && isspace((unsigned char)text[pos])) pos++;
+        start = pos;
+        while (pos < length && !isspace((unsigned char)text[pos])) pos++;
+        return pos - start;
+    };
+
+    size_t start;
+    size_t idLength = token(start);
+    auto id = dictionary.emplace(line.substr(start, idLength), studentIds.size());
+    if (id.second) studentIds.push_back(id.first->first);
+    students.push_back(id.first->second);
+
+    for (size_t q = 0; q < answers.size(); ++q) {
+        size_t answerLength = token(start);
+        uint8_t code = RowGroup::SKIPPED;
+        if (answerLength > 0 && !(answerLength == 1 && text[start] == '-')) {
+            code = (uint8_t)(text[start] - 'A');
+            if (code == RowGroup::SKIPPED) code--;
+        }
+        long seconds = token(start) > 0 ? strtol(text + start, nullptr, 10) : 0;
+        answers[q].push_back(code);
+        times[q].push_back((uint16_t)max(0L, min(seconds, 65535L)));
+    }
+    rows++;
+}
+
+// --- Snapshot ---
+
+const string& ColumnSnapshot::studentId(size_t row) const {
+    const RowGroup& group = *groups[row / AnalysisColumns::ROWS_PER_GROUP];
+    return group.studentIds[group.students[row % AnalysisColumns::ROWS_PER_GROUP]];
+}
+
+// Rows of a group that belong to this snapshot
+size_t ColumnSnapshot::groupRows(size_t group) const {
+    return min(rows - group * AnalysisColumns::ROWS_PER_GROUP, AnalysisColumns::ROWS_PER_GROUP);
+}
+
+// Chosen option letter of a row, '-' if the question was skipped
+char ColumnSnapshot::answer(size_t row, int question) const {
+    uint8_t code = groups[row / AnalysisColumns::ROWS_PER_GROUP]->answers[question][row % AnalysisColumns::ROWS_PER_GROUP];
+    return code == RowGroup::SKIPPED ? '-' : (char)('A' + code);
+}
+
+int ColumnSnapshot::time(size_t row, int question) const {
+    return groups[row / AnalysisColumns::ROWS_PER_GROUP]->times[question][row % AnalysisColumns::ROWS_PER_GROUP];
+}
+
+/**
+ * Adds rows [first, last) to totals: per-question counts and time sums, and one
+ * score/time entry per row appended in row order.
+ *
+ * @param first First row (0-based).
+ * @param last One past the last row.
+ * @param totals Accumulator; may already hold other rows of the same exam.
+ */
+void ColumnSnapshot::aggregate(size_t first, size_t last, ColumnTotals& totals) const {
+    int numQuestions = questionCount();
+    totals.questionCount = numQuestions;
+    totals.scheme = scheme;
+    if (totals.questions.size() != (size_t)numQuestions) totals.questions.assign(numQuestions, ColumnTotals::Question());
+    if (last > rows) last = rows;
+    if (first >= last) return;
+
+    size_t base = totals.rows();
+    size_t count = last - first;
+    totals.rowCorrect.resize(base + count, 0);
+    totals.rowSkipped.resize(base + count, 0);
+    totals.rowTime.resize(base + count, 0);
+
+    // Groups are independent: each task scans one into its own question counters and its
+    // own slice of the row arrays, and the counters are summed afterwards
+    const size_t G = AnalysisColumns::ROWS_PER_GROUP;
+    size_t firstGroup = first / G;
+    size_t groupCount = (last - 1) / G - firstGroup + 1;
+    bool split = groupCount > 1 && AnalysisPool::threads() > 1;
+    vector<vector<ColumnTotals::Question>> partial(split ? groupCount : 0);
+
+    AnalysisPool::parallelFor(groupCount, [&](size_t task) {
+        size_t g = firstGroup + task;
+        const RowGroup& group = *groups[g];
+        size_t begin = max(first, g * G) - g * G;
+        size_t end = min(last, g * G + groupRows(g)) - g * G;
+        if (begin >= end) return;
+        size_t out = base + (g * G + begin - first);
+
+        vector<ColumnTotals::Question>& questions = partial.empty() ? totals.questions : partial[task];
+        if (!partial.empty()) questions.assign(numQuestions, ColumnTotals::Question());
+        for (int q = 0; q < numQuestions; ++q) {
+            uint8_t key = (uint8_t)(correctAnswers[q] - 'A');
+            scanAnswers(group.answers[q].data() + begin, end - begin, key, questions[q],
+                        &totals.rowCorrect[out], &totals.rowSkipped[out]);
+            scanTimes(group.times[q].data() + begin, end - begin, questions[q].totalTime, &totals.rowTime[out]);
+        }
+    });
+
+    for (const auto& questions : partial) {
+        for (size_t q = 0; q < questions.size(); ++q) {
+            ColumnTotals::Question& sum = totals.questions[q];
+            for (int k = 0; k < 5; ++k) sum.optionCount[k] += questions[q].optionCount[k];
+            sum.skipped += questions[q].skipped;
+            sum.corrects += questions[q].corrects;
+            sum.totalTime += questions[q].totalTime;
+        }
+    }
+}
+
+// --- Column store ---
+
+// Encodes one full row group as a length- and checksum-prefixed record of the .col file
+static string encodeGroup(const RowGroup& group) {
+    string payload;
+    put<uint64_t>(payload, group.analysisBytes);
+    put<uint32_t>(payload, group.rows);
+    put<uint32_t>(payload, group.studentIds.size());
+    for (const string& id : group.studentIds) putString(payload, id);
+    payload.append(reinterpret_cast<const char*>(group.students.data()), group.rows * sizeof(uint32_t));
+    for (const auto& column : group.answers) payload.append(reinterpret_cast<const char*>(column.data()), group.rows);
+    for (const auto& column : group.times) payload.append(reinterpret_cast<const char*>(column.data()), group.rows * sizeof(uint16_t));
+
+    string record;
+    put<uint32_t>(record, payload.size());
+    put<uint32_t>(record, checksum(payload));
+    return record + payload;
+}
+
+static bool decodeGroup(const string& payload, int numQuestions, RowGroup& group) {
+    size_t pos = 0;
+    uint64_t bytes;
+    uint32_t rows, dictionarySize;
+    if (!get(payload, pos, bytes) || !get(payload, pos, rows) || !get(payload, pos, dictionarySize)) return false;
+    group.analysisBytes = bytes;
+    group.rows = rows;
+
+    group.studentIds.resize(dictionarySize);
+    for (string& id : group.studentIds) {
+        if (!getString(payload, pos, id)) return false;
+    }
+    size_t columnBytes = (size_t)rows * (sizeof(uint32_t) + numQuestions * (1 + sizeof(uint16_t)));
+    if (payload.size() - pos != columnBytes) return false;
+
+    group.students.resize(rows);
+    memcpy(group.students.data(), payload.data() + pos, rows * sizeof(uint32_t));
+    pos += rows * sizeof(uint32_t);
+    for (uint32_t student : group.students) {
+        if (student >= dictionarySize) return false;
+    }
+    group.answers.assign(numQuestions, vector<uint8_t>(rows));
+    for (auto& column : group.answers) {
+        memcpy(column.data(), payload.data() + pos, rows);
+        pos += rows;
+    }
+    group.times.assign(numQuestions, vector<uint16_t>(rows));
+    for (auto& column : group.times) {
+        memcpy(column.data(), payload.data() + pos, rows * sizeof(uint16_t));
+        pos += rows * sizeof(uint16_t);
+    }
+    return true;
+}
+
+void AnalysisColumns::ExamColumns::reset() {
+    correctAnswers.clear();
+    sealed.clear();
+    startTail();
+    analysisBytes = 0;
+    published.reset();
+}
+
+// Starts a fresh .col file holding just the answer key
+void AnalysisColumns::ExamColumns::writeHeader() {
+    string header(COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC));
+    put<uint32_t>(header, correctAnswers.size());
+    header.append(correctAnswers.begin(), correctAnswers.end());
+
+    int fd = open(columnsPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1 || !writeAll(fd, header.data(), header.size()))
+        cerr << "Error: Unable to write " << columnsPath << "\n";
+    if (fd != -1) close(fd);
+}
+
+/**
+ * Loads the full row groups saved in the .col file, as long as they still describe
+ * a prefix of the analysis file; a torn group at the end is cut off.
+ *
+ * @param textSize Current size of the analysis file.
+ * @return False if there is nothing usable to load.
+ */
+bool AnalysisColumns::ExamColumns::loadColumns(off_t textSize) {
+    ifstream in(columnsPath, ios::binary);
+    if (!in.is_open()) return false;
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+
+    // The answer key must match the first line of the analysis file
+    ifstream text(analysisPath);
+    string keyLine;
+    getline(text, keyLine);
+    vector<char> key;
+    stringstream ks(keyLine);
+    char ans;
+    while (ks >> ans) key.push_back(ans);
+
+    size_t pos = sizeof(COLUMNS_MAGIC);
+    uint32_t numQuestions;
+    if (data.compare(0, sizeof(COLUMNS_MAGIC), string(COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC))) != 0) return false;
+    if (!get(data, pos, numQuestions) || numQuestions != key.size() || data.size() - pos < numQuestions) return false;
+    if (data.compare(pos, numQuestions, string(key.begin(), key.end())) != 0) return false;
+    pos += numQuestions;
+
+    vector<shared_ptr<const RowGroup>> groups;
+    off_t covered = 0;
+    while (data.size() - pos >= GROUP_HEADER_SIZE) {
+        uint32_t length = 0, sum = 0;
+        size_t at = pos;
+        get(data, at, length);
+        get(data, at, sum);
+        if (data.size() - at < length) break;
+        string payload = data.substr(at, length);
+        auto group = make_shared<RowGroup>();
+        if (checksum(payload) != sum || !decodeGroup(payload, numQuestions, *group)) break;
+        if (group->rows != ROWS_PER_GROUP || group->analysisBytes <= covered || group->analysisBytes > textSize) break;
+        covered = group->analysisBytes;
+        groups.push_back(group);
+        pos = at + length;
+    }
+    if (groups.empty()) return false;
+
+    // Drop whatever follows the last good group so new groups line up behind it
+    if (pos < data.size() && truncate(columnsPath.c_str(), pos) != 0) return false;
+
+    correctAnswers = key;
+    sealed = groups;
+    analysisBytes = covered;
+    startTail();
+    return true;
+}
+
+// First use: load the saved groups, then parse whatever the analysis file has beyond them
+void AnalysisColumns::ExamColumns::load() {
+    loaded = true;
+    struct stat st;
+    if (stat(analysisPath.c_str(), &st) != 0) return;
+    if (!loadColumns(st.st_size)) reset();
+    else cout << "[+] Loaded " << sealed.size() * ROWS_PER_GROUP << " analysis rows from " << columnsPath << endl;
+    catchUp();
+}
+
+/**
+ * Starts an empty tail group with room for a full group, so that appending rows never
+ * moves the ones already there: snapshots share the tail instead of copying it.
+ * A tail some snapshot still holds is simply replaced, never cleared.
+ */
+void AnalysisColumns::ExamColumns::startTail() {
+    tail = make_shared<RowGroup>();
+    tail->studentIds.reserve(ROWS_PER_GROUP);
+    tail->students.reserve(ROWS_PER_GROUP);
+    tail->answers.assign(correctAnswers.size(), vector<uint8_t>());
+    tail->times.assign(correctAnswers.size(), vector<uint16_t>());
+    for (auto& column : tail->answers) column.reserve(ROWS_PER_GROUP);
+    for (auto& column : tail->times) column.reserve(ROWS_PER_GROUP);
+    tailIds.clear();
+}
+
+// Moves the full tail group into the sealed list and appends it to the .col file
+void AnalysisColumns::ExamColumns::seal() {
+    shared_ptr<const RowGroup> group = tail;
+    sealed.push_back(group);
+    startTail();
+
+    string record = encodeGroup(*group);
+    int fd = open(columnsPath.c_str(), O_WRONLY | O_APPEND);
+    if (fd == -1 || !writeAll(fd, record.data(), record.size()))
+        cerr << "Error: Unable to write " << columnsPath << "\n";
+    if (fd != -1) close(fd);
+}
+
+// Parses the lines appended to the analysis file since the last call (lock held)
+void AnalysisColumns::ExamColumns::catchUp() {
+    off_t offset = analysisBytes;
+    vector<string> lines;
+    bool restarted;
+    exists = readAppendedLines(analysisPath, offset, lines, restarted);
+    if (!exists) return;
+    if (restarted) reset();
+
+    off_t position = analysisBytes;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        position += lines[i].size() + 1;
+        if (analysisBytes == 0 && i == 0) {
+            // First line: the answer key
+            stringstream ss(lines[i]);
+            char ans;
+            while (ss >> ans) correctAnswers.push_back(ans);
+            startTail();
+            writeHeader();
+        } else if (!lines[i].empty()) {
+            tail->addRow(lines[i], tailIds);
+            tail->analysisBytes = position;
+            if (tail->rows == ROWS_PER_GROUP) seal();
+        }
+    }
+    analysisBytes = offset;
+    if (!lines.empty()) published.reset();
+}
+
+AnalysisColumns::ExamColumns* AnalysisColumns::columns(const string& examName) {
+    pthread_mutex_lock(&lock);
+    unique_ptr<ExamColumns>& slot = exams[examName];
+    if (!slot) {
+        slot.reset(new ExamColumns());
+        slot->analysisPath = analysisPathOf(examName);
+        slot->columnsPath = columnsPathOf(examName);
+    }
+    ExamColumns* result = slot.get();
+    pthread_mutex_unlock(&lock);
+    return result;
+}
+
+/**
+ * Returns every attempt of an exam recorded so far, in analysis file order.
+ *
+ * @param examName The name of the exam.
+ * @return The snapshot, or nullptr if no student has attempted the exam yet.
+ */
+shared_ptr<const ColumnSnapshot> AnalysisColumns::snapshot(const string& examName) {
+    ExamColumns* c = columns(examName);
+    pthread_mutex_lock(&c->lock);
+    if (!c->loaded) c->load();
+    shared_ptr<const ColumnSnapshot> result;
+    if (c->exists) {
+        if (!c->published) {
+            auto snap = make_shared<ColumnSnapshot>();
+            snap->correctAnswers = c->correctAnswers;
+            snap->scheme = ExamCatalog::schemeOf(examName);
+            snap->groups = c->sealed;
+            // The tail keeps growing in place; the snapshot shares it and reads only its own rows of it
+            if (c->tail->rows > 0) snap->groups.push_back(c->tail);
+            snap->rows = c->sealed.size() * ROWS_PER_GROUP + c->tail->rows;
+            snap->analysisBytes = c->analysisBytes;
+            c->published = snap;
+        }
+        result = c->published;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return result;
+}
+
+// Parses attempts just appended to an exam's analysis file
+void AnalysisColumns::refresh(const string& examName) {
+    ExamColumns* c = columns(examName);
+    pthread_mutex_lock(&c->lock);
+    if (!c->loaded) c->load();
+    else c->catchUp();
+    pthread_mutex_unlock(&c->lock);
+}
+
+/**
+ * Loads an exam's columns again after its analysis file was replaced in place (a
+ * re-grade rewrites the answer key line without changing the file's size). The
+ * .col file no longer matches the key, so it is rebuilt from the text file.
+ *
+ * @param examName The name of the exam.
+ */
+void AnalysisColumns::reload(const string& examName) {
+    ExamColumns* c = columns(examName);
+    pthread_mutex_lock(&c->lock);
+    c->reset();
+    c->load();
+    pthread_mutex_unlock(&c->lock);
+}
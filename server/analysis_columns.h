@@ -0,0 +1,155 @@
+#ifndef ANALYSIS_COLUMNS_H
+#define ANALYSIS_COLUMNS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "marking_scheme.h"
+
+using namespace std;
+
+/**
+ * Reads the complete lines appended to a file since `offset` and advances it past them.
+ * A line still being written is left for the next call. If the file shrank (it was
+ * rewritten) reading starts over from the top and `restarted` is set.
+ *
+ * @return False if the file does not exist.
+ */
+bool readAppendedLines(const string& path, off_t& offset, vector<string>& lines, bool& restarted);
+
+string analysisPathOf(const string& examName);
+
+// The attempts (and answer key) a piece of derived analysis data was built from
+struct DataVersion {
+    size_t rows = 0;
+    off_t analysisBytes = 0;
+    string answerKey;            // a re-grade changes the key but neither count
+
+    bool operator==(const DataVersion& other) const {
+        return rows == other.rows && analysisBytes == other.analysisBytes && answerKey == other.answerKey;
+    }
+    // Whether data built at `other` may replace data built at this version
+    bool replacedBy(const DataVersion& other) const {
+        return answerKey != other.answerKey || (rows <= other.rows && analysisBytes <= other.analysisBytes);
+    }
+};
+
+/**
+ * A block of consecutive attempts of one exam, stored column by column: one packed
+ * uint8 answer column and one uint16 time column per question, plus a per-group
+ * dictionary of student IDs that rows refer to by index. An answered question costs
+ * three bytes; student IDs are stored once per group however often they repeat.
+ */
+struct RowGroup {
+    static const uint8_t SKIPPED = 0xFF;     // answer code of an unanswered question
+
+    size_t rows = 0;
+    vector<string> studentIds;               // dictionary
+    vector<uint32_t> students;               // dictionary index per row
+    vector<vector<uint8_t>> answers;         // [question][row]: option index ('A' = 0) or SKIPPED
+    vector<vector<uint16_t>> times;          // [question][row]: seconds, saturated at 65535
+    off_t analysisBytes = 0;                 // analysis file prefix covered through this group's last row
+
+    void addRow(const string& line, unordered_map<string, uint32_t>& dictionary);
+};
+
+// What the aggregation kernels produce for a range of rows
+struct ColumnTotals {
+    struct Question {
+        uint32_t optionCount[5] = {0, 0, 0, 0, 0};   // answers 'A'..'E'
+        uint32_t skipped = 0;
+        uint32_t corrects = 0;
+        uint64_t totalTime = 0;
+    };
+
+    int questionCount = 0;
+    MarkingScheme scheme;
+    vector<Question> questions;
+    // Per row of the range, in row order
+    vector<uint16_t> rowCorrect;
+    vector<uint16_t> rowSkipped;
+    vector<uint32_t> rowTime;
+
+    size_t rows() const { return rowTime.size(); }
+    int attempted(size_t row) const { return questionCount - rowSkipped[row]; }
+    int wrong(size_t row) const { return attempted(row) - rowCorrect[row]; }
+    int score(size_t row) const { return scheme.score(rowCorrect[row], wrong(row), rowSkipped[row]); }
+};
+
+/**
+ * An immutable view of every attempt of an exam at one point in time.
+ *
+ * The last group may be shared with the group still being filled: rows are only ever
+ * appended to it, so read just its first groupRows() rows, never its own row count.
+ */
+class ColumnSnapshot {
+public:
+    vector<char> correctAnswers;                 // answer key letters
+    MarkingScheme scheme;
+    vector<shared_ptr<const RowGroup>> groups;   // every group but the last is full
+    size_t rows = 0;
+    off_t analysisBytes = 0;                     // analysis file prefix these rows come from
+
+    int questionCount() const { return correctAnswers.size(); }
+    DataVersion version() const { return {rows, analysisBytes, string(correctAnswers.begin(), correctAnswers.end())}; }
+    size_t groupRows(size_t group) const;
+    const string& studentId(size_t row) const;
+    char answer(size_t row, int question) const;
+    int time(size_t row, int question) const;
+    void aggregate(size_t first, size_t last, ColumnTotals& totals) const;
+};
+
+/**
+ * Columnar, binary form of each exam's analysis file.
+ *
+ * The text analysis file stays the record that submissions append to; its rows are
+ * parsed once, into row groups of ROWS_PER_GROUP attempts, and everything that
+ * analyses an exam (running totals, leaderboard, instructor drill-down) reads the
+ * columns instead of re-parsing text. Full groups are appended to
+ * "exam_<name>_analysis.col" so a restart loads them back instead of parsing the
+ * whole text file again; only the rows after the last full group are re-parsed.
+ */
+class AnalysisColumns {
+public:
+    static const size_t ROWS_PER_GROUP = 4096;
+
+    static shared_ptr<const ColumnSnapshot> snapshot(const string& examName);
+    static void refresh(const string& examName);
+    static void reload(const string& examName);
+
+private:
+    struct ExamColumns {
+        pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+        string analysisPath;
+        string columnsPath;
+        vector<char> correctAnswers;
+        vector<shared_ptr<const RowGroup>> sealed;
+        shared_ptr<RowGroup> tail = make_shared<RowGroup>();   // the group being filled, reserved to full size
+        unordered_map<string, uint32_t> tailIds;     // tail dictionary lookup
+        off_t analysisBytes = 0;
+        bool loaded = false;
+        bool exists = false;
+        shared_ptr<const ColumnSnapshot> published;  // cached until the next append
+
+        void load();
+        bool loadColumns(off_t textSize);
+        void catchUp();
+        void reset();
+        void startTail();
+        void seal();
+        void writeHeader();
+    };
+
+    static map<string, unique_ptr<ExamColumns>> exams;
+    static pthread_mutex_t lock;
+
+    static ExamColumns* columns(const string& examName);
+};
+
+#endif
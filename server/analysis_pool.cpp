@@ -0,0 +1,82 @@
+#include "analysis_pool.h"
+
+#include <algorithm>
+
+int AnalysisPool::threadCount = 1;
+deque<AnalysisPool::Job*> AnalysisPool::jobs;
+pthread_mutex_t AnalysisPool::lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t AnalysisPool::workAvailable = PTHREAD_COND_INITIALIZER;
+pthread_cond_t AnalysisPool::jobFinished = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Spawns the pool's threads. Call once, before the first parallelFor().
+ *
+ * @param count Threads that work on a job, counting the caller (1 = everything runs serially).
+ */
+void AnalysisPool::start(int count) {
+    threadCount = max(count, 1);
+    for (int i = 1; i < threadCount; ++i) {
+        pthread_t worker;
+        pthread_create(&worker, nullptr, runWorker, nullptr);
+        pthread_detach(worker);
+    }
+}
+
+/**
+ * Runs task(0) .. task(count - 1) on the pool and returns once all of them have finished.
+ * Tasks must not depend on each other's order.
+ *
+ * @param count Number of tasks.
+ * @param task Function run once per task index.
+ */
+void AnalysisPool::parallelFor(size_t count, const function<void(size_t)>& task) {
+    if (count == 0) return;
+    if (threadCount == 1 || count == 1) {
+        for (size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    Job job;
+    job.task = &task;
+    job.count = count;
+    pthread_mutex_lock(&lock);
+    jobs.push_back(&job);
+    pthread_cond_broadcast(&workAvailable);
+    pthread_mutex_unlock(&lock);
+
+    runTasks(job);
+
+    // Every task is claimed; wait for the ones still running elsewhere
+    pthread_mutex_lock(&lock);
+    auto queued = find(jobs.begin(), jobs.end(), &job);
+    if (queued != jobs.end()) jobs.erase(queued);
+    while (job.users > 0 || job.done < job.count) pthread_cond_wait(&jobFinished, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+void AnalysisPool::runTasks(Job& job) {
+    size_t i;
+    while ((i = job.next++) < job.count) {
+        (*job.task)(i);
+        job.done++;
+    }
+}
+
+void* AnalysisPool::runWorker(void* arg) {
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (jobs.empty()) pthread_cond_wait(&workAvailable, &lock);
+        Job* job = jobs.front();
+        if (job->next >= job->count) {
+            // Fully claimed: nothing left for this thread
+            jobs.pop_front();
+            continue;
+        }
+        job->users++;
+        pthread_mutex_unlock(&lock);
+        runTasks(*job);
+        pthread_mutex_lock(&lock);
+        if (--job->users == 0) pthread_cond_broadcast(&jobFinished);
+    }
+    return nullptr;
+}
@@ -0,0 +1,46 @@
+#ifndef ANALYSIS_POOL_H
+#define ANALYSIS_POOL_H
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <pthread.h>
+
+using namespace std;
+
+/**
+ * Shared threads for data-parallel analysis work (aggregating row groups, parsing and
+ * rendering chunks of an exam's attempts).
+ *
+ * parallelFor() splits a job into numbered tasks that the pool's threads and the
+ * calling thread claim one at a time, so the caller never waits on a busy pool: with
+ * every worker taken (or none started) it simply runs the tasks itself. This also makes
+ * nested calls from inside a task safe.
+ */
+class AnalysisPool {
+public:
+    static void start(int threadCount);
+    static int threads() { return threadCount; }
+    static void parallelFor(size_t count, const function<void(size_t)>& task);
+
+private:
+    struct Job {
+        const function<void(size_t)>* task;
+        size_t count;
+        atomic<size_t> next{0};     // next unclaimed task
+        atomic<size_t> done{0};     // tasks finished
+        int users = 0;              // pool threads working on the job (guarded by lock)
+    };
+
+    static int threadCount;         // including the calling thread; 1 = serial
+    static deque<Job*> jobs;
+    static pthread_mutex_t lock;
+    static pthread_cond_t workAvailable;
+    static pthread_cond_t jobFinished;
+
+    static void runTasks(Job& job);
+    static void* runWorker(void* arg);
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "answer_key_cache.h"
+
+#include <fstream>
+#include <iostream>
+#include <cctype>
+
+unordered_map<string, shared_ptr<const PackedKey>> AnswerKeyCache::keys;
+pthread_rwlock_t AnswerKeyCache::lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/**
+ * Packs a key given as one letter per question.
+ *
+ * @param letters The correct option of each question, 'A' to 'D'.
+ * @param key Receives the packed key.
+ * @return False if a letter is not an option A-D.
+ */
+bool PackedKey::pack(const vector<char>& letters, PackedKey& key) {
+    key.questions = letters.size();
+    key.words.assign((letters.size() + 31) / 32, 0);
+    for (size_t q = 0; q < letters.size(); ++q) {
+        if (letters[q] < 'A' || letters[q] > 'D') return false;
+        key.words[q / 32] |= (uint64_t)(letters[q] - 'A') << (2 * (q % 32));
+    }
+    return true;
+}
+
+// Option index of each question, as graders take it
+vector<int8_t> PackedKey::indices() const {
+    vector<int8_t> result(questions);
+    for (size_t q = 0; q < questions; ++q) result[q] = at(q);
+    return result;
+}
+
+vector<char> PackedKey::letters() const {
+    vector<char> result(questions);
+    for (size_t q = 0; q < questions; ++q) result[q] = letter(q);
+    return result;
+}
+
+/**
+ * Returns an exam's answer key, reading its key file on the first request.
+ *
+ * @param examName The name of the exam.
+ * @return The packed key, or nullptr if the exam has no usable key file.
+ */
+shared_ptr<const PackedKey> AnswerKeyCache::get(const string& examName) {
+    pthread_rwlock_rdlock(&lock);
+    auto it = keys.find(examName);
+    shared_ptr<const PackedKey> key = it == keys.end() ? nullptr : it->second;
+    pthread_rwlock_unlock(&lock);
+    if (key) return key;
+
+    // Sessions that miss together may each read the file; the first one stored wins
+    key = load(examName);
+    if (!key) return nullptr;
+    pthread_rwlock_wrlock(&lock);
+    key = keys.emplace(examName, key).first->second;
+    pthread_rwlock_unlock(&lock);
+    return key;
+}
+
+/**
+ * Stores the key of a newly uploaded or re-graded exam, replacing any older version.
+ */
+void AnswerKeyCache::put(const string& examName, const shared_ptr<const PackedKey>& key) {
+    pthread_rwlock_wrlock(&lock);
+    keys[examName] = key;
+    pthread_rwlock_unlock(&lock);
+}
+
+/**
+ * Drops an exam's key, so that the next request reads the key file again.
+ */
+void AnswerKeyCache::invalidate(const string& examName) {
+    pthread_rwlock_wrlock(&lock);
+    keys.erase(examName);
+    pthread_rwlock_unlock(&lock);
+}
+
+// Reads and packs ../data/exams/answers_<exam>.txt: one answer per line, blank lines ignored
+shared_ptr<const PackedKey> AnswerKeyCache::load(const string& examName) {
+    ifstream in("../data/exams/answers_" + examName + ".txt");
+    if (!in.is_open()) return nullptr;
+    vector<char> letters;
+    string line;
+    while (getline(in, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first != string::npos) letters.push_back(toupper((unsigned char)line[first]));
+    }
+    auto key = make_shared<PackedKey>();
+    if (letters.empty() || !PackedKey::pack(letters, *key)) {
+        cerr << "[✖] The answer key of '" << examName << "' is missing or has answers other than A-D.\n";
+        return nullptr;
+    }
+    return key;
+}
@@ -0,0 +1,48 @@
+#ifndef ANSWER_KEY_CACHE_H
+#define ANSWER_KEY_CACHE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <pthread.h>
+
+using namespace std;
+
+// An exam's answer key, 2 bits per question (A=0 ... D=3), 32 questions to a word
+struct PackedKey {
+    size_t questions = 0;
+    vector<uint64_t> words;
+
+    static bool pack(const vector<char>& letters, PackedKey& key);
+    int at(size_t q) const { return (words[q / 32] >> (2 * (q % 32))) & 3; }
+    char letter(size_t q) const { return 'A' + at(q); }
+    vector<int8_t> indices() const;
+    vector<char> letters() const;
+};
+
+/**
+ * Process-wide cache of answer keys, keyed by exam name.
+ *
+ * A key file is read and packed the first time a session needs it; after that,
+ * grading a submission or showing an attempt's correct answers only copies the packed
+ * words out of memory. Uploading an exam stores its key directly, and so does a
+ * re-grade, while it holds Regrader::keyLock exclusively. A key read from the file is
+ * only stored if none is cached yet, so a read racing a re-grade cannot bring back the
+ * old key.
+ */
+class AnswerKeyCache {
+public:
+    static shared_ptr<const PackedKey> get(const string& examName);
+    static void put(const string& examName, const shared_ptr<const PackedKey>& key);
+    static void invalidate(const string& examName);
+
+private:
+    static unordered_map<string, shared_ptr<const PackedKey>> keys;
+    static pthread_rwlock_t lock;
+
+    static shared_ptr<const PackedKey> load(const string& examName);
+};
+
+#endif
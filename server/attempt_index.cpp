@@ -0,0 +1,77 @@
+#include "attempt_index.h"
+
+#include <iostream>
+#include <fstream>
+
+unordered_map<string, uint32_t> AttemptIndex::studentIds;
+unordered_map<string, uint32_t> AttemptIndex::examIds;
+unordered_set<uint64_t> AttemptIndex::attempts;
+pthread_mutex_t AttemptIndex::lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Interns both names and combines them into one key (lock held)
+uint64_t AttemptIndex::key(const string& studentId, const string& examName) {
+    uint32_t student = studentIds.emplace(studentId, studentIds.size()).first->second;
+    uint32_t exam = examIds.emplace(examName, examIds.size()).first->second;
+    return (uint64_t)student << 32 | exam;
+}
+
+// Like key() but without interning unknown names; false if either is unknown (lock held)
+bool AttemptIndex::lookup(const string& studentId, const string& examName, uint64_t& result) {
+    auto student = studentIds.find(studentId);
+    auto exam = examIds.find(examName);
+    if (student == studentIds.end() || exam == examIds.end()) return false;
+    result = (uint64_t)student->second << 32 | exam->second;
+    return true;
+}
+
+/**
+ * Rebuilds the index from the global attempt log ("student: exam: date time" per line).
+ *
+ * @param examLogFile Path to exam_log.txt.
+ */
+void AttemptIndex::load(const string& examLogFile) {
+    ifstream log(examLogFile);
+    string line;
+    size_t count = 0;
+
+    pthread_mutex_lock(&lock);
+    while (getline(log, line)) {
+        size_t first = line.find(": ");
+        if (first == string::npos) continue;
+        size_t second = line.rfind(": ");
+        if (second == first) continue;
+        attempts.insert(key(line.substr(0, first), line.substr(first + 2, second - first - 2)));
+        count++;
+    }
+    pthread_mutex_unlock(&lock);
+    cout << "[+] Attempt index built from " << count << " attempts" << endl;
+}
+
+// True if the student has any recorded attempt of the exam
+bool AttemptIndex::contains(const string& studentId, const string& examName) {
+    pthread_mutex_lock(&lock);
+    uint64_t k;
+    bool found = lookup(studentId, examName, k) && attempts.count(k);
+    pthread_mutex_unlock(&lock);
+    return found;
+}
+
+/**
+ * Records an attempt.
+ *
+ * @return True if this is the student's first attempt of the exam.
+ */
+bool AttemptIndex::insert(const string& studentId, const string& examName) {
+    pthread_mutex_lock(&lock);
+    bool inserted = attempts.insert(key(studentId, examName)).second;
+    pthread_mutex_unlock(&lock);
+    return inserted;
+}
+
+// Forgets an attempt that could not be stored after all
+void AttemptIndex::erase(const string& studentId, const string& examName) {
+    pthread_mutex_lock(&lock);
+    uint64_t k;
+    if (lookup(studentId, examName, k)) attempts.erase(k);
+    pthread_mutex_unlock(&lock);
+}
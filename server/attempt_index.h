@@ -0,0 +1,37 @@
+#ifndef ATTEMPT_INDEX_H
+#define ATTEMPT_INDEX_H
+
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <pthread.h>
+
+using namespace std;
+
+/**
+ * In-memory set of (student, exam) pairs that have at least one recorded attempt.
+ *
+ * Student IDs and exam names are interned to 32-bit numbers, so a pair is a single
+ * 64-bit key and every check is one hash lookup. insert() is an atomic check-and-set:
+ * of two concurrent submissions of the same scheduled exam exactly one gets true.
+ * The set is rebuilt at startup from exam_log.txt, which records every attempt.
+ */
+class AttemptIndex {
+public:
+    static void load(const string& examLogFile);
+    static bool contains(const string& studentId, const string& examName);
+    static bool insert(const string& studentId, const string& examName);
+    static void erase(const string& studentId, const string& examName);
+
+private:
+    static unordered_map<string, uint32_t> studentIds;
+    static unordered_map<string, uint32_t> examIds;
+    static unordered_set<uint64_t> attempts;
+    static pthread_mutex_t lock;
+
+    static uint64_t key(const string& studentId, const string& examName);
+    static bool lookup(const string& studentId, const string& examName, uint64_t& result);
+};
+
+#endif
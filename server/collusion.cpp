@@ -0,0 +1,257 @@
+#include "collusion.h"
+#include "analysis_pool.h"
+#include "report_cache.h"
+#include "streaming_analysis.h"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+
+size_t CollusionDetector::pairLimit = 20;
+
+static const char* PAIR_SEPARATOR = "-------------------------------------------------------------------------\n";
+
+// --- Answer sheets ---
+
+void AnswerSheets::reset(const vector<char>& correctAnswers) {
+    questions = correctAnswers.size();
+    words = (questions + 63) / 64;
+    keyCodes.clear();
+    for (char key : correctAnswers) keyCodes.push_back((uint8_t)(key - 'A'));
+    studentIds.clear();
+    planes.clear();
+    wrong.clear();
+    seen.clear();
+}
+
+/**
+ * Encodes the rows of a snapshot (or of one streamed chunk) as sheets, skipping
+ * students that already have one.
+ *
+ * @param columns Attempts in analysis file order.
+ */
+void AnswerSheets::add(const ColumnSnapshot& columns) {
+    for (size_t g = 0; g < columns.groups.size(); ++g) {
+        const auto& group = columns.groups[g];
+        for (size_t r = 0; r < columns.groupRows(g); ++r) {
+            const string& id = group->studentIds[group->students[r]];
+            if (!seen.insert(id).second) continue;
+
+            studentIds.push_back(id);
+            size_t sheet = planes.size();
+            planes.resize(sheet + PLANES * words, 0);
+            wrong.resize(wrong.size() + words, 0);
+            uint64_t* bits = &planes[sheet];
+            uint64_t* wrongBits = &wrong[wrong.size() - words];
+
+            for (int q = 0; q < questions; ++q) {
+                uint8_t code = group->answers[q][r];
+                if (code == RowGroup::SKIPPED) continue;
+                uint64_t bit = 1ULL << (q % 64);
+                size_t word = q / 64;
+                bits[OPTIONS * words + word] |= bit;
+                if (code < OPTIONS) bits[code * words + word] |= bit;
+                if (code != keyCodes[q]) wrongBits[word] |= bit;
+            }
+        }
+    }
+}
+
+// --- Pair kernel ---
+
+// Best pairs first: most identical wrong answers, then the closest sheets
+static bool ranksBefore(const SuspiciousPair& a, const SuspiciousPair& b) {
+    if (a.sharedWrong != b.sharedWrong) return a.sharedWrong > b.sharedWrong;
+    if (a.differing != b.differing) return a.differing < b.differing;
+    if (a.first != b.first) return a.first < b.first;
+    return a.second < b.second;
+}
+
+/**
+ * Compares sheets [first, last) with every later sheet, keeping the best `limit` pairs
+ * in `best` (a heap with the weakest kept pair on top).
+ *
+ * The later sheets are walked in tiles small enough for their wrong-answer words to stay
+ * in L1 across the block. Each pair is first bounded by popcount(wrongA & wrongB): it
+ * can share no more identical wrong answers than questions both got wrong, so it is
+ * dropped unless that reaches the weakest pair still wanted here or by any other task
+ * (`floor`, raised as tasks fill their heaps).
+ */
+static inline __attribute__((always_inline))
+void compareRows(const AnswerSheets& sheets, size_t first, size_t last, size_t limit,
+                 atomic<int>& floor, vector<SuspiciousPair>& best) {
+    const size_t TILE = 1024;
+    const size_t n = sheets.size(), words = sheets.words;
+    const size_t stride = AnswerSheets::PLANES * words;
+    const size_t answered = AnswerSheets::OPTIONS * words;
+
+    for (size_t tile = first + 1; tile < n; tile += TILE) {
+        size_t tileEnd = min(n, tile + TILE);
+        for (size_t i = first; i < last && i + 1 < tileEnd; ++i) {
+            const uint64_t* wrongI = &sheets.wrong[i * words];
+            const uint64_t* planesI = &sheets.planes[i * stride];
+            int need = floor.load(memory_order_relaxed);
+            if (best.size() == limit) need = max(need, best.front().sharedWrong);
+
+            for (size_t j = max(tile, i + 1); j < tileEnd; ++j) {
+                const uint64_t* wrongJ = &sheets.wrong[j * words];
+                int bound = 0;
+                for (size_t w = 0; w < words; ++w) bound += __builtin_popcountll(wrongI[w] & wrongJ[w]);
+                if (bound < need) continue;
+
+                const uint64_t* planesJ = &sheets.planes[j * stride];
+                SuspiciousPair pair{(uint32_t)i, (uint32_t)j, 0, 0, 0};
+                for (size_t w = 0; w < words; ++w) {
+                    uint64_t same = 0;
+                    for (int o = 0; o < AnswerSheets::OPTIONS; ++o) same |= planesI[o * words + w] & planesJ[o * words + w];
+                    pair.identical += __builtin_popcountll(same);
+                    pair.sharedWrong += __builtin_popcountll(same & wrongI[w]);
+                    pair.differing += __builtin_popcountll((planesI[answered + w] | planesJ[answered + w]) & ~same);
+                }
+                if (pair.sharedWrong < need) continue;
+
+                if (best.size() == limit) {
+                    if (!ranksBefore(pair, best.front())) continue;
+                    pop_heap(best.begin(), best.end(), ranksBefore);
+                    best.pop_back();
+                }
+                best.push_back(pair);
+                push_heap(best.begin(), best.end(), ranksBefore);
+                if (best.size() == limit && best.front().sharedWrong > need) {
+                    need = best.front().sharedWrong;
+                    int published = floor.load(memory_order_relaxed);
+                    while (published < need && !floor.compare_exchange_weak(published, need, memory_order_relaxed)) {}
+                }
+            }
+        }
+    }
+}
+
+// The build targets baseline x86-64, whose popcount is a bit-twiddling library call;
+// the same kernel compiled for the POPCNT instruction is used when the CPU has it
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("popcnt")))
+static void compareRowsPopcnt(const AnswerSheets& sheets, size_t first, size_t last, size_t limit,
+                              atomic<int>& floor, vector<SuspiciousPair>& best) {
+    compareRows(sheets, first, last, limit, floor, best);
+}
+#endif
+
+static void compareRowsPortable(const AnswerSheets& sheets, size_t first, size_t last, size_t limit,
+                                atomic<int>& floor, vector<SuspiciousPair>& best) {
+    compareRows(sheets, first, last, limit, floor, best);
+}
+
+// --- Detector ---
+
+void CollusionDetector::setPairLimit(size_t pairs) {
+    pairLimit = pairs;
+}
+
+/**
+ * Compares every pair of sheets and returns the most similar ones.
+ *
+ * @param sheets The encoded answer sheets.
+ * @param limit Most pairs to return.
+ * @return Pairs sharing at least MIN_SHARED_WRONG identical wrong answers, best first.
+ */
+vector<SuspiciousPair> CollusionDetector::findPairs(const AnswerSheets& sheets, size_t limit) {
+    const size_t BLOCK_ROWS = 64;
+    size_t n = sheets.size();
+    if (n < 2 || limit == 0) return {};
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    static const bool hardwarePopcount = (__builtin_cpu_init(), __builtin_cpu_supports("popcnt"));
+    auto kernel = hardwarePopcount ? compareRowsPopcnt : compareRowsPortable;
+#else
+    auto kernel = compareRowsPortable;
+#endif
+
+    // Blocks near the top compare against the most sheets; they are claimed first
+    vector<vector<SuspiciousPair>> found((n + BLOCK_ROWS - 1) / BLOCK_ROWS);
+    atomic<int> floor(MIN_SHARED_WRONG);
+    AnalysisPool::parallelFor(found.size(), [&](size_t b) {
+        kernel(sheets, b * BLOCK_ROWS, min(n, (b + 1) * BLOCK_ROWS), limit, floor, found[b]);
+    });
+
+    vector<SuspiciousPair> pairs;
+    for (const auto& block : found) pairs.insert(pairs.end(), block.begin(), block.end());
+    sort(pairs.begin(), pairs.end(), ranksBefore);
+    if (pairs.size() > limit) pairs.resize(limit);
+    return pairs;
+}
+
+string CollusionDetector::render(const AnswerSheets& sheets, const vector<SuspiciousPair>& pairs) {
+    ostringstream report;
+    size_t n = sheets.size();
+    report << "\n-----------------------------Answer Similarity Check-----------------------------\n";
+    report << "Students compared: " << n << " (" << (n < 2 ? 0 : (uint64_t)n * (n - 1) / 2) << " pairs, first attempt each)\n";
+
+    if (n < 2) {
+        report << "[!] At least two students must attempt the exam before answer sheets can be compared.\n";
+        return report.str();
+    }
+    if (pairs.empty()) {
+        report << "[✔] No two students share " << MIN_SHARED_WRONG << " or more identical wrong answers.\n";
+        return report.str();
+    }
+
+    report << "Most similar pairs, by identical wrong answers, then fewest differing answers:\n\n";
+    report << PAIR_SEPARATOR;
+    report << "| Sr.  | Student A   | Student B   | Same wrong | Identical | Differing |\n";
+    report << PAIR_SEPARATOR;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        const SuspiciousPair& pair = pairs[i];
+        report << "| " << setw(5) << left << i + 1 << "| ";
+        report << setw(11) << left << sheets.studentIds[pair.first] << " | ";
+        report << setw(11) << left << sheets.studentIds[pair.second] << " | ";
+        report << setw(10) << right << pair.sharedWrong << " | ";
+        report << setw(9) << right << pair.identical << " | ";
+        report << setw(9) << right << pair.differing << " |\n";
+    }
+    report << PAIR_SEPARATOR;
+    report << "Out of " << sheets.questions << " questions. A high count of identical wrong answers is a reason to look\n"
+              "at the two sheets, not proof of copying.\n";
+    return report.str();
+}
+
+/**
+ * The similarity report of an exam, rebuilt only when new attempts have arrived.
+ * Sheets come from the analysis columns, or from one pass over the analysis file in
+ * streaming mode.
+ *
+ * @param examName The name of the exam.
+ * @return The report, or nullptr if no student has attempted the exam.
+ */
+shared_ptr<const string> CollusionDetector::report(const string& examName) {
+    if (!StreamingAnalysis::enabled()) {
+        shared_ptr<const ColumnSnapshot> columns = AnalysisColumns::snapshot(examName);
+        if (!columns) return nullptr;
+        return ReportCache::collusion(examName, columns->version(), [&]() {
+            AnswerSheets sheets;
+            sheets.reset(columns->correctAnswers);
+            sheets.add(*columns);
+            return render(sheets, findPairs(sheets, pairLimit));
+        });
+    }
+
+    // The file's size and key line stand in for the version: rows are only counted by the pass itself
+    ifstream file(analysisPathOf(examName));
+    DataVersion version;
+    if (!file.is_open() || !getline(file, version.answerKey)) return nullptr;
+    file.seekg(0, ios::end);
+    version.analysisBytes = file.tellg();
+    file.close();
+    return ReportCache::collusion(examName, version, [&]() {
+        AnswerSheets sheets;
+        vector<char> correctAnswers;
+        StreamingAnalysis::scan(examName, correctAnswers, [&](const ColumnSnapshot& chunk, const ColumnTotals&,
+                                                              const vector<off_t>&) {
+            if (sheets.size() == 0 && sheets.questions == 0) sheets.reset(correctAnswers);
+            sheets.add(chunk);
+        });
+        return render(sheets, findPairs(sheets, pairLimit));
+    });
+}
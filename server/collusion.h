@@ -0,0 +1,69 @@
+#ifndef COLLUSION_H
+#define COLLUSION_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include <cstdint>
+
+#include "analysis_columns.h"
+
+using namespace std;
+
+/**
+ * Every student's answer sheet of an exam as bit planes, one bit per question:
+ * a plane per option A-E, one of answered questions and one of wrong answers.
+ * Only a student's first attempt is kept (on a scheduled exam it is the only one;
+ * later practice attempts would just be compared against the student's own).
+ */
+struct AnswerSheets {
+    static const int OPTIONS = 5;
+    static const int PLANES = OPTIONS + 1;   // options A-E, then answered
+
+    int questions = 0;
+    size_t words = 0;                  // 64-bit words per plane
+    vector<string> studentIds;
+    vector<uint64_t> planes;           // [sheet][plane][word]
+    vector<uint64_t> wrong;            // [sheet][word], kept apart for the pruning pass
+
+    size_t size() const { return studentIds.size(); }
+    void reset(const vector<char>& correctAnswers);
+    void add(const ColumnSnapshot& columns);
+
+private:
+    vector<uint8_t> keyCodes;
+    unordered_set<string> seen;
+};
+
+// Two sheets that agree more than chance suggests
+struct SuspiciousPair {
+    uint32_t first, second;            // sheet indices, first < second
+    int sharedWrong;                   // questions both got wrong with the same option
+    int identical;                     // questions both answered with the same option
+    int differing;                     // questions answered differently: the sheets' Hamming distance
+};
+
+/**
+ * Answer-similarity check an instructor runs after an exam.
+ *
+ * Identical wrong answers are the signal: two students who studied apart rarely pick
+ * the same wrong option on many questions. Every pair of sheets is compared with
+ * AND + popcount over the bit planes, split across the analysis pool; a pair is only
+ * scored in full when its overlap of wrong answers could still reach the best pairs
+ * found so far.
+ */
+class CollusionDetector {
+public:
+    static const int MIN_SHARED_WRONG = 2;   // fewer identical wrong answers is not worth reporting
+
+    static void setPairLimit(size_t pairs);
+    static vector<SuspiciousPair> findPairs(const AnswerSheets& sheets, size_t limit);
+    static string render(const AnswerSheets& sheets, const vector<SuspiciousPair>& pairs);
+    static shared_ptr<const string> report(const string& examName);
+
+private:
+    static size_t pairLimit;
+};
+
+#endif
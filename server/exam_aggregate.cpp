@@ -0,0 +1,277 @@
+#include "exam_aggregate.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+map<string, shared_ptr<const ExamAggregate>> ExamAggregate::aggregates;
+map<string, bool> ExamAggregate::dirty;
+pthread_mutex_t ExamAggregate::lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t ExamAggregate::update_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static string aggregatePathOf(const string& examName) {
+    return "../data/results/exam_" + examName + "_aggregate.txt";
+}
+
+// Median of all scores, walked from the score distribution
+double ExamAggregate::medianScore() const {
+    if (totalStudents == 0) return 0.0;
+    int lowerRank = (totalStudents - 1) / 2, upperRank = totalStudents / 2;
+    int lower = 0, upper = 0, seen = 0;
+    for (const auto& [score, count] : scoreCounts) {
+        if (seen <= lowerRank && lowerRank < seen + count) lower = score;
+        if (seen <= upperRank && upperRank < seen + count) {
+            upper = score;
+            break;
+        }
+        seen += count;
+    }
+    return (totalStudents % 2 == 0) ? (lower + upper) / 2.0 : upper;
+}
+
+/**
+ * Folds in the attempts of the snapshot not counted yet, with the column kernels.
+ * Starts over if the analysis file was rewritten or re-graded since the totals were taken.
+ *
+ * @param columns Every attempt of the exam recorded so far.
+ */
+void ExamAggregate::catchUp(const ColumnSnapshot& columns) {
+    if (columns.analysisBytes < analysisBytes || columns.rows < (size_t)totalStudents ||
+        (!correctAnswers.empty() && (columns.correctAnswers != correctAnswers || columns.scheme != scheme))) {
+        *this = ExamAggregate();
+    }
+
+    ColumnTotals totals;
+    columns.aggregate(totalStudents, columns.rows, totals);
+    add(columns.correctAnswers, totals);
+    analysisBytes = columns.analysisBytes;
+}
+
+/**
+ * Adds the kernel output for a range of attempts to the totals.
+ *
+ * @param key The exam's answer key (taken on the first call).
+ * @param totals Column totals of the attempts being added.
+ */
+void ExamAggregate::add(const vector<char>& key, const ColumnTotals& totals) {
+    if (correctAnswers.empty()) {
+        correctAnswers = key;
+        scheme = totals.scheme;
+        questions.assign(correctAnswers.size(), QuestionStats());
+    }
+    for (int i = 0; i < totals.questionCount && i < questionCount(); ++i) {
+        QuestionStats& q = questions[i];
+        const ColumnTotals::Question& t = totals.questions[i];
+        q.attempts += totals.rows() - t.skipped;
+        q.corrects += t.corrects;
+        q.skipped += t.skipped;
+        q.totalTime += t.totalTime;
+        for (int j = 0; j < 5; ++j) q.optionCount[j] += t.optionCount[j];
+        q.optionCount[4] += t.skipped;    // the last column counts 'E' and unanswered alike
+    }
+    for (size_t r = 0; r < totals.rows(); ++r) {
+        int score = totals.score(r);
+        scoreSum += score;
+        timeSum += totals.rowTime[r];
+        scoreCounts[score]++;
+    }
+    totalStudents += totals.rows();
+}
+
+// Writes the totals next to the analysis file (a cache: it can always be rebuilt)
+bool ExamAggregate::save(const string& path) const {
+    string tempPath = path + ".tmp";
+    ofstream out(tempPath, ios::trunc);
+    if (!out) return false;
+
+    out << "bytes " << analysisBytes << "\n";
+    out << "key " << string(correctAnswers.begin(), correctAnswers.end()) << "\n";
+    out << "scheme " << scheme.text() << "\n";
+    out << "students " << totalStudents << " " << scoreSum << " " << timeSum << "\n";
+    for (const QuestionStats& q : questions) {
+        out << "q " << q.attempts << " " << q.corrects << " " << q.skipped << " " << q.totalTime;
+        for (int count : q.optionCount) out << " " << count;
+        out << "\n";
+    }
+    for (const auto& [score, count] : scoreCounts) {
+        out << "score " << score << " " << count << "\n";
+    }
+    out.close();
+    if (!out) return false;
+    return rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+bool ExamAggregate::load(const string& path) {
+    ifstream in(path);
+    if (!in.is_open()) return false;
+
+    ExamAggregate loaded;
+    string line, tag;
+    while (getline(in, line)) {
+        istringstream iss(line);
+        iss >> tag;
+        if (tag == "bytes") {
+            long long bytes;
+            iss >> bytes;
+            loaded.analysisBytes = bytes;
+        } else if (tag == "key") {
+            string key;
+            iss >> key;
+            loaded.correctAnswers.assign(key.begin(), key.end());
+        } else if (tag == "scheme") {
+            string text;
+            iss >> text;
+            if (!MarkingScheme::parse(text, loaded.scheme)) return false;
+        } else if (tag == "students") {
+            iss >> loaded.totalStudents >> loaded.scoreSum >> loaded.timeSum;
+        } else if (tag == "q") {
+            QuestionStats q;
+            iss >> q.attempts >> q.corrects >> q.skipped >> q.totalTime;
+            for (int& count : q.optionCount) iss >> count;
+            loaded.questions.push_back(q);
+        } else if (tag == "score") {
+            int score, count;
+            iss >> score >> count;
+            loaded.scoreCounts[score] = count;
+        }
+        if (iss.fail()) return false;
+    }
+    if (loaded.questions.size() != loaded.correctAnswers.size()) return false;
+
+    *this = loaded;
+    return true;
+}
+
+// Published version of an exam's aggregate, loading and catching it up on first use
+shared_ptr<const ExamAggregate> ExamAggregate::current(const string& examName) {
+    pthread_mutex_lock(&lock);
+    auto it = aggregates.find(examName);
+    shared_ptr<const ExamAggregate> aggregate = (it != aggregates.end()) ? it->second : nullptr;
+    pthread_mutex_unlock(&lock);
+    if (aggregate) return aggregate;
+
+    shared_ptr<const ColumnSnapshot> columns = AnalysisColumns::snapshot(examName);
+    if (!columns) return nullptr;
+
+    auto loaded = make_shared<ExamAggregate>();
+    loaded->load(aggregatePathOf(examName));
+    DataVersion before = loaded->version();
+    loaded->catchUp(*columns);
+    if (!(loaded->version() == before)) loaded->save(aggregatePathOf(examName));
+
+    pthread_mutex_lock(&lock);
+    aggregates[examName] = loaded;
+    pthread_mutex_unlock(&lock);
+    return loaded;
+}
+
+/**
+ * Returns the current totals of an exam.
+ *
+ * @param examName The name of the exam.
+ * @return The aggregate, or nullptr if no student has attempted the exam yet.
+ */
+shared_ptr<const ExamAggregate> ExamAggregate::get(const string& examName) {
+    pthread_mutex_lock(&update_lock);
+    shared_ptr<const ExamAggregate> aggregate = current(examName);
+    pthread_mutex_unlock(&update_lock);
+    return aggregate;
+}
+
+// Folds attempts just added to an exam's analysis columns into a new published version
+void ExamAggregate::refresh(const string& examName) {
+    pthread_mutex_lock(&update_lock);
+    shared_ptr<const ExamAggregate> base = current(examName);
+    shared_ptr<const ColumnSnapshot> columns = AnalysisColumns::snapshot(examName);
+    if (base && columns) {
+        auto next = make_shared<ExamAggregate>(*base);
+        next->catchUp(*columns);
+        if (!(next->version() == base->version())) {
+            pthread_mutex_lock(&lock);
+            aggregates[examName] = next;
+            dirty[examName] = true;
+            pthread_mutex_unlock(&lock);
+        }
+    }
+    pthread_mutex_unlock(&update_lock);
+}
+
+// Saves every aggregate changed since the last call (once per batch of submissions)
+void ExamAggregate::persistDirty() {
+    vector<pair<string, shared_ptr<const ExamAggregate>>> changed;
+    pthread_mutex_lock(&lock);
+    for (const auto& entry : dirty) changed.push_back({entry.first, aggregates[entry.first]});
+    dirty.clear();
+    pthread_mutex_unlock(&lock);
+
+    for (const auto& [examName, aggregate] : changed) {
+        if (!aggregate->save(aggregatePathOf(examName)))
+            cerr << "Error: Unable to save aggregate of " << examName << "\n";
+    }
+}
+
+// The overall, per-question and answer-option sections of the analysis report
+string ExamAggregate::metricsReport() const {
+    int numQuestions = questionCount();
+    stringstream report;
+
+    double avgScore = (double)scoreSum / totalStudents;
+    double avgTime = (double)timeSum / totalStudents;
+
+    // Write overall exam metrics header and summary
+    report << "\n-------------------------------Overall Exam Metrics--------------------------------\n";
+    report << "Total Students: " << totalStudents << "\n";
+    report << "Average Score: " << fixed << setprecision(1) << avgScore << " / " << scheme.maxMarks(numQuestions) << "\n";
+    report << "Median Score: " << medianScore() << " / " << scheme.maxMarks(numQuestions) << "\n";
+    report << "Marking Scheme: " << scheme.text() << "\n";
+    report << "Average Time Spent: " << fixed << setprecision(1) << avgTime << " s\n";
+    report << "-----------------------------------------------------------------------------------\n\n";
+
+    // Write per-question performance header and column titles
+    report << "------------------------------------Per-Question Performance------------------------------------------\n\n";
+    report << "| Question | # Attempted | # Correct  | # Wrong | # Skipped | % Correct | Avg Time (s) | Difficulty  |\n";
+    report << "------------------------------------------------------------------------------------------------------\n";
+
+    for (int i = 0; i < numQuestions; ++i) {
+        const QuestionStats& q = questions[i];
+        int wrong = q.attempts - q.corrects;
+
+        double percentCorrect = (totalStudents > 0) ? (100.0 * q.corrects / totalStudents) : 0.0;
+        double avgQTime = (totalStudents > 0) ? ((double)q.totalTime / totalStudents) : 0.0;
+
+        // Determine difficulty label based on percentage correct
+        string difficulty;
+        if (percentCorrect >= 70.0) difficulty = "Easy";
+        else if (percentCorrect >= 30.0) difficulty = "Medium";
+        else difficulty = "Hard";
+
+        report << "|    Q" << setw(2) << (i + 1) << "   | ";
+        report << setw(11) << q.attempts << " | ";
+        report << setw(9) << q.corrects << " | ";
+        report << setw(7) << wrong << " | ";
+        report << setw(9) << q.skipped << " | ";
+        report << setw(9) << fixed << setprecision(1) << percentCorrect << "% | ";
+        report << setw(12) << fixed << setprecision(1) << avgQTime << " | ";
+        report << setw(11) << difficulty << " |\n";
+        report << "------------------------------------------------------------------------------------------------------\n";
+    }
+    report << "\n";
+
+    // Write header for answer-option distribution per question
+    report << "-------------------Answer-Option Distribution----------------------\n\n";
+    report << "| Question |  A  |  B  |  C  |  D  | NA  |\n";
+    report << "------------------------------------------\n";
+
+    for (int i = 0; i < numQuestions; ++i) {
+        report << "|   Q" << setw(2) << (i + 1) << "    |";
+        for (int j = 0; j < 5; ++j) {
+            report << " " << setw(3) << questions[i].optionCount[j] << " |";
+        }
+        report << "\n";
+        report << "------------------------------------------\n";
+    }
+    report << "\n";
+    return report.str();
+}
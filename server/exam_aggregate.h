@@ -0,0 +1,70 @@
+#ifndef EXAM_AGGREGATE_H
+#define EXAM_AGGREGATE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "analysis_columns.h"
+
+using namespace std;
+
+/**
+ * Running totals behind the "Overall Exam Metrics", "Per-Question Performance"
+ * and "Answer-Option Distribution" sections of an exam's analysis.
+ *
+ * An aggregate is a pure function of the exam's analysis file: it remembers how many
+ * attempts (and bytes of that file) it has folded in, so new submissions are added by
+ * running the column kernels over the new rows only (O(questions) each) and a stale or
+ * missing snapshot on disk is caught up instead of rebuilt. Published versions are immutable; the submission view
+ * thread builds a new version and swaps it in.
+ */
+class ExamAggregate {
+public:
+    struct QuestionStats {
+        int attempts = 0;
+        int corrects = 0;
+        int skipped = 0;
+        long long totalTime = 0;
+        int optionCount[5] = {0, 0, 0, 0, 0};   // A, B, C, D, NA
+    };
+
+    vector<char> correctAnswers;     // answer key letters, from the first line of the analysis file
+    MarkingScheme scheme;            // the scores below were marked with
+    int totalStudents = 0;
+    long long scoreSum = 0;
+    long long timeSum = 0;
+    vector<QuestionStats> questions;
+    map<int, int> scoreCounts;       // score distribution: score -> number of students
+    off_t analysisBytes = 0;         // prefix of the analysis file folded into these totals
+
+    int questionCount() const { return correctAnswers.size(); }
+    DataVersion version() const {
+        return {(size_t)totalStudents, analysisBytes, string(correctAnswers.begin(), correctAnswers.end())};
+    }
+    double medianScore() const;
+    string metricsReport() const;
+    void add(const vector<char>& key, const ColumnTotals& totals);
+
+    static shared_ptr<const ExamAggregate> get(const string& examName);
+    static void refresh(const string& examName);
+    static void persistDirty();
+
+private:
+    void catchUp(const ColumnSnapshot& columns);
+    bool save(const string& path) const;
+    bool load(const string& path);
+
+    static shared_ptr<const ExamAggregate> current(const string& examName);
+
+    static map<string, shared_ptr<const ExamAggregate>> aggregates;
+    static map<string, bool> dirty;
+    static pthread_mutex_t lock;        // guards the maps
+    static pthread_mutex_t update_lock; // serializes building new versions
+};
+
+#endif
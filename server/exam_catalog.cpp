@@ -0,0 +1,155 @@
+#include "exam_catalog.h"
+
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+/**
+ * Parses the text of a metadata file (as returned by load_exam_metadata).
+ *
+ * @param metadataText "Key: value" lines of one exam.
+ * @param meta Receives the parsed fields.
+ * @return False if the text has no exam name.
+ */
+bool ExamMeta::parse(const string& metadataText, ExamMeta& meta) {
+    istringstream iss(metadataText);
+    string line;
+
+    while (getline(iss, line)) {
+        size_t colon = line.find(':');
+        if (colon == string::npos) continue;
+        string key = line.substr(0, colon);
+        string value = line.size() > colon + 2 ? line.substr(colon + 2) : "";
+
+        if (key == "Exam Name") meta.name = value;
+        else if (key == "Exam type") meta.type = value;
+        else if (key == "Start Time") meta.startTimeText = value;
+        else if (key == "Duration (minutes)") meta.duration = atoi(value.c_str());
+        else if (key == "Total Questions") meta.questionCount = atoi(value.c_str());
+        else if (key == "Instructor") meta.instructor = value;
+        else if (key == "Marking Scheme") MarkingScheme::parse(value, meta.scheme);
+    }
+
+    if (!meta.startTimeText.empty()) {
+        tm tm = {};
+        istringstream ss(meta.startTimeText);
+        ss >> get_time(&tm, "%Y-%m-%d %H:%M:%S");
+        if (!ss.fail()) {
+            tm.tm_isdst = -1;
+            meta.startTime = mktime(&tm);
+        }
+    }
+    return !meta.name.empty();
+}
+
+// True while a scheduled exam is between its start time and its end
+bool ExamMeta::isRunning(time_t now) const {
+    if (!isScheduled() || startTime == -1) return false;
+    return now < startTime + duration * 60;
+}
+
+// One line of the student's exam list (without the "N. " prefix)
+string ExamMeta::studentListing() const {
+    return "Exam Name: " + name + " | Exam type: " + type + " | Start Time: " + startTimeText +
+           " | Duration (minutes): " + to_string(duration) + " | Total Questions: " + to_string(questionCount) +
+           " | Instructor: " + instructor + " | Marking Scheme: " + scheme.text() + " |";
+}
+
+// One line of the instructor's own exam list (without the "N. " prefix)
+string ExamMeta::instructorListing() const {
+    string typeText = isScheduled() ? "Scheduled Test" : "Practice Test";
+    return "Exam Name: " + name + " | Exam type: " + typeText + " | Start Time: " + startTimeText +
+           " | Duration (minutes): " + to_string(duration) + " | Total Questions: " + to_string(questionCount) +
+           " | Marking Scheme: " + scheme.text() + " | ";
+}
+
+shared_ptr<const ExamCatalog> ExamCatalog::current = make_shared<const ExamCatalog>();
+pthread_mutex_t ExamCatalog::writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+unordered_set<string> ExamCatalog::reserved;
+
+void ExamCatalog::add(const ExamMeta& meta) {
+    size_t position = exams.size();
+    exams.push_back(make_shared<const ExamMeta>(meta));
+    nameIndex[meta.name] = position;
+    instructorIndex[meta.instructor].push_back(position);
+}
+
+// Looks up an exam by name; nullptr if it is not in the catalog
+const ExamMeta* ExamCatalog::find(const string& name) const {
+    auto it = nameIndex.find(name);
+    return it == nameIndex.end() ? nullptr : exams[it->second].get();
+}
+
+// Exams uploaded by one instructor, in upload order
+vector<const ExamMeta*> ExamCatalog::byInstructor(const string& instructor) const {
+    vector<const ExamMeta*> result;
+    auto it = instructorIndex.find(instructor);
+    if (it == instructorIndex.end()) return result;
+    for (size_t position : it->second) result.push_back(exams[position].get());
+    return result;
+}
+
+// The current catalog; stays valid for as long as the caller holds it
+shared_ptr<const ExamCatalog> ExamCatalog::snapshot() {
+    return atomic_load(&current);
+}
+
+// Replaces the whole catalog (startup)
+void ExamCatalog::publish(const shared_ptr<const ExamCatalog>& catalog) {
+    pthread_mutex_lock(&writer_mutex);
+    atomic_store(&current, catalog);
+    pthread_mutex_unlock(&writer_mutex);
+}
+
+/**
+ * Publishes a new catalog version with one more exam.
+ *
+ * @param meta The newly uploaded exam.
+ */
+void ExamCatalog::publishExam(const ExamMeta& meta) {
+    pthread_mutex_lock(&writer_mutex);
+    auto next = make_shared<ExamCatalog>(*atomic_load(&current));
+    next->add(meta);
+    atomic_store(&current, shared_ptr<const ExamCatalog>(move(next)));
+    pthread_mutex_unlock(&writer_mutex);
+}
+
+/**
+ * Publishes a new catalog version with a batch of exams, so readers see all or none of them.
+ *
+ * @param metas The newly imported exams.
+ */
+void ExamCatalog::publishExams(const vector<ExamMeta>& metas) {
+    pthread_mutex_lock(&writer_mutex);
+    auto next = make_shared<ExamCatalog>(*atomic_load(&current));
+    for (const ExamMeta& meta : metas) next->add(meta);
+    atomic_store(&current, shared_ptr<const ExamCatalog>(move(next)));
+    pthread_mutex_unlock(&writer_mutex);
+}
+
+/**
+ * Claims an exam name for an upload about to store its files.
+ *
+ * @param name The name of the new exam.
+ * @return False if the name is in the catalog or another upload holds it.
+ */
+bool ExamCatalog::reserve(const string& name) {
+    pthread_mutex_lock(&writer_mutex);
+    bool free = !atomic_load(&current)->find(name) && reserved.insert(name).second;
+    pthread_mutex_unlock(&writer_mutex);
+    return free;
+}
+
+// Gives back reserved names, after their exams are published or the upload failed
+void ExamCatalog::release(const vector<string>& names) {
+    pthread_mutex_lock(&writer_mutex);
+    for (const string& name : names) reserved.erase(name);
+    pthread_mutex_unlock(&writer_mutex);
+}
+
+// The marking scheme of an exam; the default one if the exam is not in the catalog
+MarkingScheme ExamCatalog::schemeOf(const string& examName) {
+    shared_ptr<const ExamCatalog> catalog = snapshot();
+    const ExamMeta* meta = catalog->find(examName);
+    return meta ? meta->scheme : MarkingScheme();
+}
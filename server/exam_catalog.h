@@ -0,0 +1,72 @@
+#ifndef EXAM_CATALOG_H
+#define EXAM_CATALOG_H
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <pthread.h>
+
+#include "marking_scheme.h"
+
+using namespace std;
+
+// Typed form of one exam's metadata file
+struct ExamMeta {
+    string name;
+    string type;             // "g" for scheduled, "q" for practice
+    string startTimeText;    // start time as written in the metadata file (empty for practice tests)
+    time_t startTime = -1;   // startTimeText parsed once, -1 if absent or malformed
+    int duration = 0;        // minutes
+    int questionCount = 0;
+    string instructor;
+    MarkingScheme scheme;    // +4 / -1 when the metadata file predates marking schemes
+
+    static bool parse(const string& metadataText, ExamMeta& meta);
+
+    bool isScheduled() const { return type == "g" || type == "G"; }
+    bool isRunning(time_t now) const;
+    string studentListing() const;
+    string instructorListing() const;
+};
+
+/**
+ * All uploaded exams, in exam_list.txt order (the numbering students pick from),
+ * indexed by exam name and by instructor.
+ *
+ * A catalog is immutable once published. Readers take the current version with
+ * snapshot() and never block; an upload copies the current version (only pointers
+ * to the shared ExamMeta entries), appends the new exam and swaps the copy in.
+ * An upload or import reserves its names before writing any file, so two of them
+ * cannot both store an exam of the same name; the names are released once published.
+ */
+class ExamCatalog {
+public:
+    void add(const ExamMeta& meta);
+
+    const ExamMeta* find(const string& name) const;
+    vector<const ExamMeta*> byInstructor(const string& instructor) const;
+    const vector<shared_ptr<const ExamMeta>>& all() const { return exams; }
+    size_t size() const { return exams.size(); }
+
+    static shared_ptr<const ExamCatalog> snapshot();
+    static void publish(const shared_ptr<const ExamCatalog>& catalog);
+    static void publishExam(const ExamMeta& meta);
+    static void publishExams(const vector<ExamMeta>& metas);
+    static bool reserve(const string& name);
+    static void release(const vector<string>& names);
+    static MarkingScheme schemeOf(const string& examName);
+
+private:
+    vector<shared_ptr<const ExamMeta>> exams;
+    unordered_map<string, size_t> nameIndex;
+    unordered_map<string, vector<size_t>> instructorIndex;
+
+    static shared_ptr<const ExamCatalog> current;
+    static pthread_mutex_t writer_mutex;   // serializes uploads; readers never take it
+    static unordered_set<string> reserved; // names of uploads in progress, under writer_mutex
+};
+
+#endif
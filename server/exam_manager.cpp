@@ -1,74 +1,223 @@
 #include "exam_manager.h"
+#include "record_io.h"
 
-// Mutex to protect concurrent access to exam_list.txt when appending new exams
+// Mutex to protect concurrent access to exam_list.txt when adding new exams
 pthread_mutex_t file_mutex4 = PTHREAD_MUTEX_INITIALIZER;
 
+// Open pre-rendered question papers, shared by every session sending the same exam
+static map<string, shared_ptr<Session::FileBody>> openPapers;
+static pthread_mutex_t paper_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Maps a whole file read-only; the mapping is released with the object.
+ */
+struct MappedFile {
+    const char* data = nullptr;
+    size_t length = 0;
+
+    bool open(const string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        if (ok && st.st_size > 0) {
+            void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ok = mapped != MAP_FAILED;
+            if (ok) {
+                data = static_cast<const char*>(mapped);
+                length = st.st_size;
+                madvise(mapped, length, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+        return ok;
+    }
+    string_view text() const { return string_view(data, length); }
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), length);
+    }
+};
+
+// Where a question of an exam text was found, and its answer as written
+struct BankEntry {
+    string_view answer;      // after "A:", empty if there is none
+    int line;                // line of the "Q:"
+    int answerLine = 0;
+};
+
+static bool isBlank(string_view line) {
+    return line.find_first_not_of(" \t\r") == string_view::npos;
+}
+
+/**
+ * Splits exam text in the upload format into questions without copying it: a "Q:" line
+ * (the question may go on over the next lines), the options "A)" to "D)" and the correct
+ * answer as "A:". Every question and option is a view into the text.
+ *
+ * @param text The exam text; it must outlive the views.
+ * @param questions Receives each question, in order.
+ * @param bank Receives where each question was found and its answer.
+ * @param error Receives the line number and what is wrong with it.
+ * @return False if a line does not fit the format.
+ */
+static bool parseQuestionBank(string_view text, vector<CompiledExam::Question>& questions, vector<BankEntry>& bank,
+                              string& error) {
+    BankEntry* current = nullptr;
+    int seenOptions = 0;         // bit per option of the current question
+    bool inText = false;         // still reading the current question's text
+    const char* textEnd = nullptr;
+
+    // Checks the question being read is complete, once the next one (or the end) is reached
+    auto finish = [&]() {
+        if (!current) return true;
+        for (int option = 0; option < 4; ++option) {
+            if (!(seenOptions & (1 << option))) {
+                error = "line " + to_string(current->line) + ": the question has no option " + string(1, 'A' + option) + ")";
+                return false;
+            }
+        }
+        return true;
+    };
+
+    int lineNo = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == string_view::npos) eol = text.size();
+        string_view line = text.substr(pos, eol - pos);
+        const char* lineStart = text.data() + pos;
+        pos = eol + 1;
+        ++lineNo;
+
+        if (line.substr(0, 2) == "Q:") {
+            if (!finish()) return false;
+            questions.push_back(CompiledExam::Question());
+            bank.push_back(BankEntry());
+            current = &bank.back();
+            current->line = lineNo;
+            questions.back().text = line.substr(2);
+            textEnd = lineStart + line.size();
+            seenOptions = 0;
+            inText = true;
+        } else if (line.size() >= 2 && line[0] >= 'A' && line[0] <= 'D' && line[1] == ')') {
+            int option = line[0] - 'A';
+            if (!current) {
+                error = "line " + to_string(lineNo) + ": option before the first question (Q:)";
+                return false;
+            }
+            if (seenOptions & (1 << option)) {
+                error = "line " + to_string(lineNo) + ": option " + string(1, line[0]) + ") appears twice in the question";
+                return false;
+            }
+            if (inText) {
+                // The text ends at the last line before the options, as it was written
+                const char* textStart = questions.back().text.data();
+                questions.back().text = string_view(textStart, textEnd - textStart);
+                inText = false;
+            }
+            seenOptions |= 1 << option;
+            questions.back().options[option] = line.substr(2);
+        } else if (line.substr(0, 2) == "A:") {
+            if (!current || current->answerLine) {
+                error = "line " + to_string(lineNo) + (current ? ": second answer (A:) for the question" : ": answer before the first question (Q:)");
+                return false;
+            }
+            current->answer = line.substr(2);
+            current->answerLine = lineNo;
+        } else if (inText) {
+            // The question text goes on, blank lines included
+            textEnd = lineStart + line.size();
+        } else if (!isBlank(line)) {
+            error = "line " + to_string(lineNo) + (current ? ": only the question text (Q:) may go on over several lines"
+                                                           : ": text before the first question (Q:)");
+            return false;
+        }
+    }
+    return finish();
+}
+
+static string metadataPathOf(const string& examName) {
+    return "../data/exams/metadata_" + examName + ".txt";
+}
+
+// Writes a whole file with one write
+static bool writeFile(const string& path, const string& data) {
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(data.data(), data.size());
+    out.close();
+    if (!out) cerr << "Error: Unable to write " << path << "\n";
+    return (bool)out;
+}
+
 /**
- * Parses an exam file and stores its questions, answers, and metadata.
+ * Parses an exam file, stores its questions, answers, and metadata, and adds it to exam_list.txt.
  * 
- * @param exam_type Type of exam (e.g., "g" for scheduled, "p" for practice).
+ * @param exam_type Type of exam (e.g., "g" for scheduled, "q" for practice).
  * @param input_file Path to the input file containing questions and answers.
  * @param exam_name Name to assign to this exam.
  * @param instructor Name of the instructor who created the exam.
  * @param duration Duration of the exam in minutes.
  * @param start_time Scheduled start time of the exam.
+ * @param scheme Marks for a correct, a wrong and an unanswered question.
+ * @param error Receives what is wrong with the file, with its line number.
  * 
  * @return True if parsing and storage were successful, false otherwise.
  */
-bool ExamManager::parse_exam(const string& exam_type, const string& input_file, const string& exam_name, const string& instructor, int duration, const string& start_time){
-    
-    ifstream infile(input_file);  // Open the input exam file
-    string line, currentQuestion, optionA, optionB, optionC, optionD, correctAnswer;
-    vector<string> questions;  // Holds formatted questions with options
-    vector<string> answers;    // Holds correct answers for each question
-    int questionCount = 0;
-    bool readingQuestion = false;  // Tracks whether we are currently reading a question block
-
-    // Read file line-by-line to extract questions, options, and answers
-    while (getline(infile, line)) {
-        if (line.rfind("Q:", 0) == 0) {  // New question line detected
-            if (!currentQuestion.empty()) {  
-                // Store previous question with options and correct answer before starting new question
-                questions.push_back(currentQuestion + "\nA) " + optionA + "\nB) " + optionB + "\nC) " + optionC + "\nD) " + optionD);
-                answers.push_back(correctAnswer);
-                questionCount++;
-            }
-            currentQuestion = line;  // Start a new question
-            readingQuestion = true;
-        } else if (line.rfind("A)", 0) == 0) {
-            optionA = line.substr(2);  // Extract option A text
-            readingQuestion = false;
-        } else if (line.rfind("B)", 0) == 0) {
-            optionB = line.substr(2);  // Extract option B text
-        } else if (line.rfind("C)", 0) == 0) {
-            optionC = line.substr(2);  // Extract option C text
-        } else if (line.rfind("D)", 0) == 0) {
-            optionD = line.substr(2);  // Extract option D text
-        } else if (line.rfind("A:", 0) == 0) {
-            correctAnswer = line.substr(2);  // Extract correct answer
-        } else if (readingQuestion) {  
-            // Append continuation lines to the current question text
-            currentQuestion += "\n" + line;
-        }
+bool ExamManager::parse_exam(const string& exam_type, const string& input_file, const string& exam_name, const string& instructor, int duration, const string& start_time, const MarkingScheme& scheme, string& error){
+    if (!store_exam(exam_type, input_file, exam_name, instructor, duration, start_time, scheme, error)) return false;
+    if (!commit_exams({exam_name})) {
+        discard_exam(exam_name);
+        error = "unable to update exam_list.txt";
+        cout << "[-] Error: " << error << "\n";
+        return false;
     }
+    cout << "[+] Exam successfully parsed and stored!\n";
+    return true;
+}
 
-    // Add last question after EOF if any
-    if (!currentQuestion.empty()) {
-        questions.push_back(currentQuestion + "\nA) " + optionA + "\nB) " + optionB + "\nC) " + optionC + "\nD) " + optionD);
-        answers.push_back(correctAnswer);
-        questionCount++;
+/**
+ * Parses an exam file and stores its questions, answers, metadata and compiled paper,
+ * without listing the exam yet (see commit_exams). Safe to run for several exams at once.
+ *
+ * Takes the same parameters as parse_exam.
+ * @return True if the file is valid and every output was written.
+ */
+bool ExamManager::store_exam(const string& exam_type, const string& input_file, const string& exam_name, const string& instructor, int duration, const string& start_time, const MarkingScheme& scheme, string& error){
+    error.clear();
+    // The upload is mapped and split into views of it; nothing is copied until the outputs are written
+    MappedFile input;
+    vector<CompiledExam::Question> questions;
+    vector<BankEntry> bank;
+    if (!input.open(input_file)) {
+        error = "unable to read " + input_file;
+    } else if (parseQuestionBank(input.text(), questions, bank, error) && questions.empty()) {
+        error = "no questions found in the file";
     }
-
-    infile.close();
-
-    // Validate that at least one question was found
-    if (questions.empty()) {
-        cout << "[-] Error: No valid questions found in file.\n";
+    if (!error.empty()) {
+        cout << "[-] Error: " << error << "\n";
         return false;
     }
+    int questionCount = questions.size();
+
+    // Each answer is a single option letter; it is packed into the answer key cache
+    vector<char> letters;
+    letters.reserve(questionCount);
+    for (const BankEntry& entry : bank) {
+        size_t first = entry.answer.find_first_not_of(" \t\r");
+        char letter = first == string_view::npos ? 0 : toupper((unsigned char)entry.answer[first]);
+        if (letter < 'A' || letter > 'D') {
+            error = entry.answerLine ? "line " + to_string(entry.answerLine) + ": the answer must be A, B, C or D"
+                                     : "line " + to_string(entry.line) + ": the question has no answer (A:)";
+            cout << "[-] Error: " << error << "\n";
+            return false;
+        }
+        letters.push_back(letter);
+    }
+    auto key = make_shared<PackedKey>();
+    PackedKey::pack(letters, *key);
 
     // Define file paths for metadata, questions, and answers
-    string metadataFile = "../data/exams/metadata_" + exam_name + ".txt";
+    string metadataFile = metadataPathOf(exam_name);
     string questionsFile = "../data/exams/questions_" + exam_name + ".txt";
     string answersFile = "../data/exams/answers_" + exam_name + ".txt";
 
@@ -80,33 +229,99 @@ bool ExamManager::parse_exam(const string& exam_type, const string& input_file,
     metaFile << "Duration (minutes): " << duration << "\n";
     metaFile << "Total Questions: " << questionCount << "\n";
     metaFile << "Instructor: " << instructor << "\n";
+    metaFile << "Marking Scheme: " << scheme.text() << "\n";
     metaFile << "Questions File: " << questionsFile << "\n";
     metaFile << "Answers File: " << answersFile << "\n";
     metaFile.close();
+    bool stored = (bool)metaFile;
 
-    // Write questions to separate file
-    ofstream questionFile(questionsFile);
-    for (const string &q : questions) {
-        questionFile << q << "\n\n";
+    // Each remaining output is built in one buffer of its final size and written in one go
+    size_t questionBytes = 0;
+    for (const CompiledExam::Question &q : questions) {
+        questionBytes += 2 + q.text.size() + 4 * 4 + 2;
+        for (const string_view& option : q.options) questionBytes += option.size();
     }
-    questionFile.close();
+    string questionData;
+    questionData.reserve(questionBytes);
+    for (const CompiledExam::Question &q : questions) {
+        questionData.append("Q:").append(q.text);
+        for (int option = 0; option < 4; ++option) {
+            questionData.append(1, '\n').append(1, 'A' + option).append(") ").append(q.options[option]);
+        }
+        questionData.append("\n\n");
+    }
+    stored = writeFile(questionsFile, questionData) && stored;
+    string().swap(questionData);
+
+    // Compile the paper and keep it exactly as it goes on the wire, on disk and in memory
+    string frame = encodeFrameHeader(CompiledExam::compiledSize(questions));
+    CompiledExam::compile(questions, frame);
+    stored = renderPaper(exam_name, frame) && stored;
+    PaperCache::put(exam_name, make_shared<const string>(move(frame)));
 
     // Write answers to separate file
-    ofstream answerFile(answersFile);
-    for (const string &a : answers) {
-        answerFile << a << "\n";
+    string answerData;
+    answerData.reserve(letters.size() * 2);
+    for (char a : letters) answerData.append(1, a).append(1, '\n');
+    stored = writeFile(answersFile, answerData) && stored;
+    AnswerKeyCache::put(exam_name, key);
+
+    if (!stored) {
+        error = "unable to store the exam files";
+        discard_exam(exam_name);
+        return false;
     }
-    answerFile.close();
+    return true;
+}
+
+/**
+ * Lists exams whose files are already stored, all of them or none: exam_list.txt is
+ * rewritten with the new lines under a temporary name, synced, and renamed into place,
+ * so readers see either the old list or the complete new one.
+ *
+ * @param examNames The exams to add, in order.
+ * @return False if the list could not be replaced; it is then unchanged.
+ */
+bool ExamManager::commit_exams(const vector<string>& examNames) {
+    const string listPath = "../data/exams/exam_list.txt";
+    const string tempPath = listPath + ".tmp";
 
-    // Append exam name and metadata file path to exam list file, thread-safe using mutex
     pthread_mutex_lock(&file_mutex4);
-    ofstream examList("../data/exams/exam_list.txt", ios::app);
-    examList << exam_name << "|" << metadataFile << "\n";
-    examList.close();
+    string list;
+    ifstream current(listPath, ios::binary);
+    if (current) list.assign(istreambuf_iterator<char>(current), istreambuf_iterator<char>());
+    current.close();
+    if (!list.empty() && list.back() != '\n') list += '\n';
+    for (const string& name : examNames) list += name + "|" + metadataPathOf(name) + "\n";
+
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = fd != -1 && writeAll(fd, list.data(), list.size()) && fdatasync(fd) == 0;
+    if (fd != -1) close(fd);
+    ok = ok && rename(tempPath.c_str(), listPath.c_str()) == 0;
+    if (!ok) {
+        cerr << "Error: Unable to update " << listPath << "\n";
+        remove(tempPath.c_str());
+    }
     pthread_mutex_unlock(&file_mutex4);
+    return ok;
+}
 
-    cout << "[+] Exam successfully parsed and stored!\n";
-    return true;
+/**
+ * Removes the stored files and cached copies of an exam that was never listed.
+ *
+ * @param examName The name of the exam.
+ */
+void ExamManager::discard_exam(const string& examName) {
+    remove(metadataPathOf(examName).c_str());
+    remove(("../data/exams/questions_" + examName + ".txt").c_str());
+    remove(("../data/exams/answers_" + examName + ".txt").c_str());
+    remove(getPaperFilePath(examName).c_str());
+
+    pthread_mutex_lock(&paper_mutex);
+    openPapers.erase(examName);
+    pthread_mutex_unlock(&paper_mutex);
+    PaperCache::invalidate(examName);
+    AnswerKeyCache::invalidate(examName);
 }
 
 /**
@@ -154,6 +369,37 @@ vector<string> ExamManager::load_exam_metadata(const string& exam_list_file) {
     return examMetadata;
 }
 
+/**
+ * Loads every exam listed in the given exam list file into a typed catalog.
+ * 
+ * @param exam_list_file Path to the file containing exam names and metadata paths.
+ * @return Catalog of the exams, in the order they appear in the list file.
+ */
+shared_ptr<ExamCatalog> ExamManager::load_exam_catalog(const string& exam_list_file) {
+    auto catalog = make_shared<ExamCatalog>();
+    for (const string& metadata : load_exam_metadata(exam_list_file)) {
+        ExamMeta meta;
+        if (ExamMeta::parse(metadata, meta)) catalog->add(meta);
+    }
+    return catalog;
+}
+
+/**
+ * Loads the metadata of a single exam, e.g. right after it was uploaded.
+ * 
+ * @param examName The name of the exam.
+ * @param meta Receives the parsed metadata.
+ * @return True if the metadata file exists and names an exam.
+ */
+bool ExamManager::load_exam_meta(const string& examName, ExamMeta& meta) {
+    ifstream metadataFile("../data/exams/metadata_" + examName + ".txt");
+    if (!metadataFile) return false;
+
+    ostringstream metadata;
+    metadata << metadataFile.rdbuf();
+    return ExamMeta::parse(metadata.str(), meta);
+}
+
 /**
  * Retrieves the metadata file path for a given exam name.
  * 
@@ -205,17 +451,131 @@ string ExamManager::getQuestionsFilePath(const string& metadataPath) {
 }
 
 /**
- * Sends the questions of a specified exam over a socket.
+ * Returns the path of the pre-rendered question paper of an exam.
+ * 
+ * @param examName The name of the exam.
+ * @return Path to the paper file (a complete frame: header followed by the compiled paper).
+ */
+string ExamManager::getPaperFilePath(const string& examName) {
+    return "../data/exams/paper_" + examName + ".exm";
+}
+
+/**
+ * Writes the compiled question paper of an exam as a ready-to-send frame, so it can be
+ * streamed to clients with sendfile() instead of being read and copied per request.
+ * The file is written under a temporary name and renamed into place; sessions
+ * still streaming the previous version keep their open descriptor.
+ * 
+ * @param examName The name of the exam.
+ * @param frame The frame header followed by the compiled paper (see CompiledExam).
+ * @return True if the paper file was written, false otherwise.
+ */
+bool ExamManager::renderPaper(const string& examName, const string& frame) {
+    string paperFile = getPaperFilePath(examName);
+    string tempFile = paperFile + ".tmp";
+
+    ofstream out(tempFile, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Error: Unable to write paper file " << tempFile << "\n";
+        return false;
+    }
+    out.write(frame.data(), frame.size());
+    out.close();
+    if (!out || rename(tempFile.c_str(), paperFile.c_str()) != 0) {
+        cerr << "Error: Unable to store paper file " << paperFile << "\n";
+        remove(tempFile.c_str());
+        return false;
+    }
+
+    // Drop any descriptor or cached copy of the old paper; the next request loads the new one
+    pthread_mutex_lock(&paper_mutex);
+    openPapers.erase(examName);
+    pthread_mutex_unlock(&paper_mutex);
+    PaperCache::invalidate(examName);
+    return true;
+}
+
+/**
+ * Returns the open pre-rendered paper of an exam, opening it on first use.
+ * sendfile() is given an explicit offset, so one descriptor serves any number of sessions.
+ * 
+ * @param examName The name of the exam.
+ * @return The open paper, or nullptr if it has not been rendered.
+ */
+shared_ptr<Session::FileBody> ExamManager::openPaper(const string& examName) {
+    pthread_mutex_lock(&paper_mutex);
+    auto it = openPapers.find(examName);
+    if (it != openPapers.end()) {
+        shared_ptr<Session::FileBody> paper = it->second;
+        pthread_mutex_unlock(&paper_mutex);
+        return paper;
+    }
+
+    shared_ptr<Session::FileBody> paper;
+    int fd = open(getPaperFilePath(examName).c_str(), O_RDONLY);
+    if (fd != -1) {
+        struct stat st;
+        // Anything shorter than a frame header is not a usable paper
+        if (fstat(fd, &st) == 0 && st.st_size > (off_t)FRAME_HEADER_SIZE) {
+            paper = make_shared<Session::FileBody>(fd, st.st_size);
+            openPapers[examName] = paper;
+        } else {
+            close(fd);
+        }
+    }
+    pthread_mutex_unlock(&paper_mutex);
+    return paper;
+}
+
+/**
+ * Reads a whole pre-rendered paper into memory.
  * 
- * @param sock The socket descriptor to send data over.
+ * @param paper The open paper file.
+ * @return The frame stored in the file, or nullptr on a read error.
+ */
+static shared_ptr<const string> readPaper(const Session::FileBody& paper) {
+    string frame(paper.length, '\0');
+    off_t done = 0;
+    while (done < paper.length) {
+        ssize_t n = pread(paper.fd, &frame[done], paper.length - done, done);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return nullptr;
+        done += n;
+    }
+    return make_shared<const string>(move(frame));
+}
+
+/**
+ * Sends the questions of a specified exam to a client session.
+ * Papers are served from the in-memory cache when possible, otherwise from the
+ * pre-rendered paper file; if neither exists the questions file is read and the
+ * paper is compiled for the next request.
+ * 
+ * @param session The client session to queue the questions on.
  * @param examName The name of the exam whose questions are to be sent.
  */
-void ExamManager::sendExamQuestions(int sock, const string& examName) {
+void ExamManager::sendExamQuestions(Session& session, const string& examName) {
+    shared_ptr<const string> cached = PaperCache::get(examName);
+    if (cached) {
+        session.sendShared(cached);
+        return;
+    }
+
+    shared_ptr<Session::FileBody> paper = openPaper(examName);
+    if (paper) {
+        // Papers too large for the cache keep streaming from disk
+        shared_ptr<const string> frame;
+        if (PaperCache::fits(paper->length)) frame = readPaper(*paper);
+        if (frame && PaperCache::put(examName, frame)) session.sendShared(frame);
+        else session.sendFile(paper);
+        return;
+    }
+
     // Retrieve the path to the metadata file for the exam
     string metadataPath = getMetadataFilePath(examName);
     if (metadataPath.empty()) {
         string errorMsg = "Error: Exam not found.\n";
-        send(sock, errorMsg.c_str(), errorMsg.size(), 0);
+        session.send(errorMsg);
         return;
     }
 
@@ -223,28 +583,31 @@ void ExamManager::sendExamQuestions(int sock, const string& examName) {
     string questionFilePath = getQuestionsFilePath(metadataPath);
     if (questionFilePath.empty()) {
         string errorMsg = "Error: No questions file found.\n";
-        send(sock, errorMsg.c_str(), errorMsg.size(), 0);
+        session.send(errorMsg);
         return;
     }
 
     ifstream questionFile(questionFilePath);
     if (!questionFile) {
         string errorMsg = "Error: Unable to open questions file.\n";
-        send(sock, errorMsg.c_str(), errorMsg.size(), 0);
+        session.send(errorMsg);
         return;
     }
 
-    // Read entire questions file content
-    string questionData, line;
-    while (getline(questionFile, line)) {
-        questionData += line + "\n";
-    }
-    
-    // Handle empty questions file case
-    if (questionData.empty()) {
-        questionData = "Error: Questions file is empty.\n";
+    // Exams uploaded before papers were compiled get one now
+    string questionData((istreambuf_iterator<char>(questionFile)), istreambuf_iterator<char>());
+    vector<CompiledExam::Question> questions;
+    vector<BankEntry> bank;
+    string error;
+    if (!parseQuestionBank(questionData, questions, bank, error) || questions.empty()) {
+        cerr << "Error: Questions file of " << examName << " is not usable: " << error << "\n";
+        session.send("Error: Questions file is empty or invalid.\n");
+        return;
     }
-    
-    // Send questions data to client via socket
-    send(sock, questionData.c_str(), questionData.size(), 0);
+    string compiled = encodeFrameHeader(CompiledExam::compiledSize(questions));
+    CompiledExam::compile(questions, compiled);
+    renderPaper(examName, compiled);
+    shared_ptr<const string> frame = make_shared<const string>(move(compiled));
+    PaperCache::put(examName, frame);
+    session.sendShared(frame);
 }
@@ -11,16 +11,47 @@
 #include <sys/stat.h>
 #include <fstream>
 #include<pthread.h>
+#include <map>
+#include <cerrno>
+#include <memory>
+#include <string_view>
+#include <sys/mman.h>
+
+#include "session.h"
+#include "paper_cache.h"
+#include "compiled_exam.h"
+#include "answer_key_cache.h"
+#include "exam_catalog.h"
 
 using namespace std;
 
+// The fields of an upload request "name|type|duration|file|start[|scheme]"
+struct ExamUpload {
+    string name;
+    string type;             // "g" (or "G") scheduled, anything else ("q") practice
+    int duration = 0;        // minutes
+    string file;             // the exam file, as a server path
+    string startTime;        // scheduled exams only
+    MarkingScheme scheme;
+};
+
 class ExamManager {
 public:
-    bool parse_exam(const string& exam_type, const string& input_file, const string& exam_name, const string& instructor, int duration, const string& start_time);
+    bool parse_exam(const string& exam_type, const string& input_file, const string& exam_name, const string& instructor, int duration, const string& start_time, const MarkingScheme& scheme, string& error);
+    bool store_exam(const string& exam_type, const string& input_file, const string& exam_name, const string& instructor, int duration, const string& start_time, const MarkingScheme& scheme, string& error);
+    bool commit_exams(const vector<string>& examNames);
+    void discard_exam(const string& examName);
     vector<string> load_exam_metadata(const string& exam_list_file);
+    shared_ptr<ExamCatalog> load_exam_catalog(const string& exam_list_file);
+    bool load_exam_meta(const string& examName, ExamMeta& meta);
     string getMetadataFilePath(const string& examName);
     string getQuestionsFilePath(const string& metadataPath) ;
-    void sendExamQuestions(int sock, const string& examName);
+    void sendExamQuestions(Session& session, const string& examName);
+    string getPaperFilePath(const string& examName);
+    bool renderPaper(const string& examName, const string& frame);
+
+private:
+    shared_ptr<Session::FileBody> openPaper(const string& examName);
 };
 
 #endif
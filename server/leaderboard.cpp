@@ -0,0 +1,392 @@
+#include "leaderboard.h"
+#include "analysis_pool.h"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+map<string, unique_ptr<Leaderboard::ExamRanking>> Leaderboard::rankings;
+pthread_mutex_t Leaderboard::lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* LEADERBOARD_HEADER =
+    "----------------------------------Leaderboard------------------------------------------\n\n"
+    "|Sr No.| Student ID | Total Marks | Rank |  % Marks  | Avg Time/Q | Attempted | Wrong |\n"
+    "---------------------------------------------------------------------------------------\n";
+
+static const char* ROW_SEPARATOR =
+    "---------------------------------------------------------------------------------------\n";
+
+void Leaderboard::ExamRanking::insert(const RankEntry& entry) {
+    index->entries.push_back(entry);
+    index->order.insert(RankIndex::keyOf(entry));
+    index->attemptsOf[entry.id].push_back(entry.originalIndex);
+}
+
+// Inserts the attempts of the snapshot not ranked yet (write lock held)
+void Leaderboard::ExamRanking::catchUp(const ColumnSnapshot& columns) {
+    // The analysis file was rewritten, or re-graded with a new key: rank everything again
+    if (columns.analysisBytes < analysisBytes || columns.rows < index->entries.size() ||
+        columns.correctAnswers != correctAnswers || columns.scheme != scheme) {
+        // Pins of the old index keep it: it is replaced, never cleared
+        index = make_shared<RankIndex>();
+    }
+    correctAnswers = columns.correctAnswers;
+    scheme = columns.scheme;
+    loaded = true;
+
+    ColumnTotals totals;
+    size_t first = index->entries.size();
+    columns.aggregate(first, columns.rows, totals);
+    for (size_t r = 0; r < totals.rows(); ++r) {
+        insert({columns.studentId(first + r), totals.score(r), (double)totals.rowTime[r],
+                totals.attempted(r), totals.wrong(r), (int)(first + r)});
+    }
+    analysisBytes = columns.analysisBytes;
+}
+
+Leaderboard::ExamRanking* Leaderboard::ranking(const string& examName) {
+    pthread_mutex_lock(&lock);
+    unique_ptr<ExamRanking>& slot = rankings[examName];
+    if (!slot) slot.reset(new ExamRanking());
+    ExamRanking* result = slot.get();
+    pthread_mutex_unlock(&lock);
+    return result;
+}
+
+// Runs reader under the exam's read lock, building the ranking first if needed
+bool Leaderboard::read(const string& examName, const function<void(const ExamRanking&)>& reader) {
+    ExamRanking* r = ranking(examName);
+    pthread_rwlock_rdlock(&r->lock);
+    if (!r->loaded) {
+        pthread_rwlock_unlock(&r->lock);
+        pthread_rwlock_wrlock(&r->lock);
+        if (!r->loaded) {
+            shared_ptr<const ColumnSnapshot> columns = AnalysisColumns::snapshot(examName);
+            if (columns) r->catchUp(*columns);
+        }
+        pthread_rwlock_unlock(&r->lock);
+        pthread_rwlock_rdlock(&r->lock);
+    }
+    bool loaded = r->loaded;
+    if (loaded) reader(*r);
+    pthread_rwlock_unlock(&r->lock);
+    return loaded;
+}
+
+// Inserts attempts just added to an exam's analysis columns
+void Leaderboard::refresh(const string& examName) {
+    shared_ptr<const ColumnSnapshot> columns = AnalysisColumns::snapshot(examName);
+    if (columns) refresh(examName, *columns);
+}
+
+/**
+ * Brings an exam's ranking up to the given columns, inserting only the rows not ranked yet.
+ *
+ * @param examName The name of the exam.
+ * @param columns Every attempt of the exam, in analysis file order.
+ */
+void Leaderboard::refresh(const string& examName, const ColumnSnapshot& columns) {
+    ExamRanking* r = ranking(examName);
+    pthread_rwlock_wrlock(&r->lock);
+    r->catchUp(columns);
+    pthread_rwlock_unlock(&r->lock);
+}
+
+// Attempts ranked and the key they were scored with: changes with every submission and re-grade
+DataVersion Leaderboard::version(const string& examName) {
+    DataVersion result;
+    read(examName, [&](const ExamRanking& r) {
+        result = {r.index->entries.size(), r.analysisBytes, string(r.correctAnswers.begin(), r.correctAnswers.end())};
+    });
+    return result;
+}
+
+/**
+ * Pins the leaderboard at its current version. Taking a pin copies nothing; paging
+ * through it never mixes in later attempts.
+ *
+ * @param examName The name of the exam.
+ * @param version Receives the version the pin was taken at.
+ */
+shared_ptr<const PinnedRanking> Leaderboard::pinned(const string& examName, DataVersion& version) {
+    auto pin = make_shared<PinnedRanking>();
+    pin->ranking = ranking(examName);
+    version = DataVersion();
+    read(examName, [&](const ExamRanking& r) {
+        pin->index = r.index;
+        pin->rowCount = r.index->entries.size();
+        version = {pin->rowCount, r.analysisBytes, string(r.correctAnswers.begin(), r.correctAnswers.end())};
+    });
+    return pin;
+}
+
+// --- Pinned rankings ---
+
+// Keys of the attempts ranked since the pin, in rank order (read lock held)
+vector<Leaderboard::RankKey> PinnedRanking::keysSincePin() const {
+    vector<Leaderboard::RankKey> keys;
+    for (size_t i = rowCount; i < index->entries.size(); ++i) keys.push_back(Leaderboard::RankIndex::keyOf(index->entries[i]));
+    sort(keys.begin(), keys.end());
+    return keys;
+}
+
+/**
+ * 0-based rank of a student's best attempt among the pinned rows.
+ *
+ * @param studentId The student.
+ * @return The rank, or Leaderboard::NO_RANK if the student has no pinned attempt.
+ */
+size_t PinnedRanking::rankOf(const string& studentId) const {
+    if (!index) return Leaderboard::NO_RANK;
+    pthread_rwlock_rdlock(&ranking->lock);
+    size_t rank = Leaderboard::NO_RANK;
+    auto attempts = index->attemptsOf.find(studentId);
+    if (attempts != index->attemptsOf.end() && !attempts->second.empty() && (size_t)attempts->second.front() < rowCount) {
+        Leaderboard::RankKey best = Leaderboard::RankIndex::keyOf(index->entries[attempts->second.front()]);
+        for (int row : attempts->second) {
+            if ((size_t)row >= rowCount) break;
+            best = min(best, Leaderboard::RankIndex::keyOf(index->entries[row]));
+        }
+        // Ranked above it in the tree, less the attempts that came after the pin
+        vector<Leaderboard::RankKey> later = keysSincePin();
+        rank = index->order.order_of_key(best) - (lower_bound(later.begin(), later.end(), best) - later.begin());
+    }
+    pthread_rwlock_unlock(&ranking->lock);
+    return rank;
+}
+
+/**
+ * Pinned rows ranked [first, first + count), in rank order.
+ *
+ * @param first 0-based rank of the first row.
+ * @param count Maximum number of rows.
+ */
+vector<RankEntry> PinnedRanking::rows(size_t first, size_t count) const {
+    vector<RankEntry> result;
+    if (!index || first >= rowCount) return result;
+    pthread_rwlock_rdlock(&ranking->lock);
+    const Leaderboard::RankTree& order = index->order;
+    vector<Leaderboard::RankKey> later = keysSincePin();
+
+    // The pinned row ranked `first` sits in the tree behind every later attempt ranked above
+    // it: grow the skip until it counts exactly the later attempts up to the row it lands on
+    size_t skipped = 0;
+    while (true) {
+        Leaderboard::RankKey key = *order.find_by_order(first + skipped);
+        size_t upTo = upper_bound(later.begin(), later.end(), key) - later.begin();
+        if (upTo == skipped) break;
+        skipped = upTo;
+    }
+    for (auto it = order.find_by_order(first + skipped); it != order.end() && result.size() < count; ++it) {
+        if ((size_t)get<2>(*it) < rowCount) result.push_back(index->entries[get<2>(*it)]);
+    }
+    pthread_rwlock_unlock(&ranking->lock);
+    return result;
+}
+
+/**
+ * Formats leaderboard rows in the report's table layout.
+ *
+ * @param rows Consecutive rows in rank order.
+ * @param firstRank Rank (1-based) of the first row.
+ * @param numQuestions Number of questions in the exam.
+ * @param maxMarks Full marks of the exam.
+ */
+string Leaderboard::renderRows(const vector<RankEntry>& rows, size_t firstRank, int numQuestions, int maxMarks) {
+    // Long leaderboards are formatted a chunk per task on the analysis pool, then joined in order
+    const size_t CHUNK_ROWS = AnalysisColumns::ROWS_PER_GROUP;
+    vector<string> chunks((rows.size() + CHUNK_ROWS - 1) / CHUNK_ROWS);
+    AnalysisPool::parallelFor(chunks.size(), [&](size_t c) {
+        ostringstream report;
+        size_t end = min(rows.size(), (c + 1) * CHUNK_ROWS);
+        for (size_t i = c * CHUNK_ROWS; i < end; ++i) {
+            const RankEntry& s = rows[i];
+            size_t rank = firstRank + i;
+            double percentMarks = (100.0 * s.score) / maxMarks;
+            double avgTimePerQ = s.time / numQuestions;
+
+            report << "| " << setw(5) << left << rank << "|";
+            report << setw(11) << left << s.id << " | ";
+            report << setw(6) << right << s.score << " / " << maxMarks << " | ";
+            report << setw(4) << right << rank << " | ";
+            report << setw(8) << fixed << setprecision(1) << percentMarks << "% | ";
+            report << setw(8) << fixed << setprecision(1) << avgTimePerQ << " s | ";
+            report << setw(9) << right << s.attempted << " | ";
+            report << setw(5) << right << s.wrong << " |\n";
+            report << ROW_SEPARATOR;
+        }
+        chunks[c] = report.str();
+    });
+
+    string report;
+    size_t length = 0;
+    for (const string& chunk : chunks) length += chunk.size();
+    report.reserve(length);
+    for (const string& chunk : chunks) report += chunk;
+    return report;
+}
+
+/**
+ * Leaderboard of an exam as paged through by a student, positioned on the student's
+ * best attempt. The rows are pinned at the current version, so the rank and page
+ * count shown stay true to the rows the student pages through.
+ *
+ * @param examName The name of the exam.
+ * @param studentId The student viewing it.
+ */
+shared_ptr<LeaderboardView> Leaderboard::studentView(const string& examName, const string& studentId) {
+    DataVersion version;
+    shared_ptr<const PinnedRanking> rows = pinned(examName, version);
+    int numQuestions = 0, maxMarks = 0;
+    read(examName, [&](const ExamRanking& r) {
+        numQuestions = r.correctAnswers.size();
+        maxMarks = r.scheme.maxMarks(numQuestions);
+    });
+    size_t total = rows->size();
+    return make_shared<LeaderboardView>(LeaderboardView::rowsOf(rows), total, total, numQuestions, maxMarks,
+                                        rows->rankOf(studentId));
+}
+
+/**
+ * Lays out a student's leaderboard: the top rows, the rows around the student's best
+ * attempt and the student's rank.
+ *
+ * @param total Number of ranked attempts.
+ * @param numQuestions Number of questions in the exam.
+ * @param maxMarks Full marks of the exam.
+ * @param position 0-based rank of the student's best attempt, or NO_RANK.
+ * @param rowsFrom Returns the rows ranked [first, last).
+ */
+string Leaderboard::renderStudentReport(size_t total, int numQuestions, int maxMarks, size_t position,
+                                        const function<vector<RankEntry>(size_t, size_t)>& rowsFrom) {
+    string report = LEADERBOARD_HEADER;
+    size_t topEnd = min(total, (size_t)TOP_ROWS);
+    report += renderRows(rowsFrom(0, topEnd), 1, numQuestions, maxMarks);
+
+    if (position != NO_RANK) {
+        // The student's neighbourhood, unless it is already inside the top rows
+        size_t windowStart = max(topEnd, position >= WINDOW_ROWS ? position - WINDOW_ROWS : 0);
+        size_t windowEnd = min(total, position + WINDOW_ROWS + 1);
+        if (windowStart < windowEnd) {
+            if (windowStart > topEnd) report += "   ...\n" + string(ROW_SEPARATOR);
+            report += renderRows(rowsFrom(windowStart, windowEnd), windowStart + 1, numQuestions, maxMarks);
+        }
+        report += "\nYour rank: " + to_string(position + 1) + " of " + to_string(total) + "\n";
+    }
+    return report + "\n";
+}
+
+// --- Paging ---
+
+LeaderboardView::LeaderboardView(const RowSource& rows, size_t pageable, size_t total, int numQuestions, int maxMarks,
+                                 size_t ownRank)
+    : rows(rows), pageable(min(pageable, total)), total(total), numQuestions(numQuestions), maxMarks(maxMarks),
+      ownRank(ownRank) {}
+
+// Pages of a fixed list of rows in rank order
+LeaderboardView::RowSource LeaderboardView::rowsOf(const shared_ptr<const vector<RankEntry>>& list) {
+    return [list](size_t begin, size_t count) {
+        size_t end = min(list->size(), begin + count);
+        return begin < end ? vector<RankEntry>(list->begin() + begin, list->begin() + end) : vector<RankEntry>();
+    };
+}
+
+// Pages of a pinned leaderboard, read from the rank index
+LeaderboardView::RowSource LeaderboardView::rowsOf(const shared_ptr<const PinnedRanking>& pinned) {
+    return [pinned](size_t begin, size_t count) { return pinned->rows(begin, count); };
+}
+
+// Rows ranked around the viewer that lie beyond the pageable rows (streaming mode)
+void LeaderboardView::setNeighbourhood(size_t begin, const vector<RankEntry>& shown) {
+    neighbourhoodFirst = begin;
+    neighbourhood = shown;
+}
+
+// Rows ranked [begin, end) that this view knows
+vector<RankEntry> LeaderboardView::rowsFrom(size_t begin, size_t end) const {
+    vector<RankEntry> result;
+    if (begin < pageable) result = rows(begin, min(end, pageable) - begin);
+    for (size_t pos = max(begin, pageable); pos < end; ++pos) {
+        if (pos >= neighbourhoodFirst && pos - neighbourhoodFirst < neighbourhood.size())
+            result.push_back(neighbourhood[pos - neighbourhoodFirst]);
+    }
+    return result;
+}
+
+// The first view a student gets: the top rows, their neighbourhood and their rank
+string LeaderboardView::summary() const {
+    return Leaderboard::renderStudentReport(total, numQuestions, maxMarks, ownRank,
+                                            [&](size_t begin, size_t end) { return rowsFrom(begin, end); });
+}
+
+string LeaderboardView::page() const {
+    return render(first, rowsFrom(first, min(first + pageSize, pageable)));
+}
+
+string LeaderboardView::render(size_t begin, const vector<RankEntry>& shown) const {
+    string report = LEADERBOARD_HEADER;
+    report += Leaderboard::renderRows(shown, begin + 1, numQuestions, maxMarks);
+
+    size_t pages = max((size_t)1, (pageable + pageSize - 1) / pageSize);
+    string ranks = shown.empty() ? "no attempts"
+                                 : "ranks " + to_string(begin + 1) + "-" + to_string(begin + shown.size()) + " of " + to_string(total);
+    if (begin < pageable || shown.empty()) {
+        report += "\nPage " + to_string(begin / pageSize + 1) + " of " + to_string(pages) + " (" + ranks + ")\n";
+    } else {
+        // A neighbourhood beyond the pageable rows has no page number
+        report += "\nShowing " + ranks + "\n";
+    }
+    if (pageable < total) {
+        report += "Only the top " + to_string(pageable) + " of " + to_string(total) + " attempts are kept.\n";
+    }
+    if (ownRank != Leaderboard::NO_RANK) {
+        report += "Your rank: " + to_string(ownRank + 1) + " of " + to_string(total) + "\n";
+    }
+    return report + "\n";
+}
+
+/**
+ * Applies one paging command and renders the page it leads to.
+ *
+ * @param request NEXT, PREV, TOP, PAGE <n>, SIZE <rows> or AROUND.
+ * @param reply Receives the page (or an error message).
+ * @return False if the request is not a paging command.
+ */
+bool LeaderboardView::handle(const string& request, string& reply) {
+    istringstream in(request);
+    string command;
+    long value = 0;
+    in >> command;
+    bool hasValue = (bool)(in >> value);
+    size_t lastPageStart = pageable == 0 ? 0 : (pageable - 1) / pageSize * pageSize;
+
+    if (command == "NEXT") {
+        first = min(first + pageSize, lastPageStart);
+    } else if (command == "PREV") {
+        first = first > pageSize ? first - pageSize : 0;
+    } else if (command == "TOP") {
+        first = 0;
+    } else if (command == "PAGE" && hasValue && value >= 1) {
+        first = min((size_t)(value - 1), lastPageStart / pageSize) * pageSize;
+    } else if (command == "SIZE" && hasValue && value >= 1) {
+        pageSize = min((size_t)value, MAX_PAGE_SIZE);
+        first = first / pageSize * pageSize;
+    } else if (command == "AROUND") {
+        if (ownRank == Leaderboard::NO_RANK) {
+            reply = "[!] You have no attempt on this leaderboard.";
+            return true;
+        }
+        if (ownRank >= pageable) {
+            // Beyond the kept rows: show the neighbourhood found for this viewer
+            reply = render(neighbourhoodFirst, neighbourhood);
+            return true;
+        }
+        // Centre the page on the viewer's row
+        first = ownRank > pageSize / 2 ? ownRank - pageSize / 2 : 0;
+        if (first + pageSize > pageable) first = pageable > pageSize ? pageable - pageSize : 0;
+    } else {
+        return false;
+    }
+    reply = page();
+    return true;
+}
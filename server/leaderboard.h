@@ -0,0 +1,159 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <pthread.h>
+#include <sys/types.h>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+#include "analysis_columns.h"
+
+using namespace std;
+
+// One leaderboard row: a student's line of the analysis file, scored
+struct RankEntry {
+    string id;
+    int score;
+    double time;
+    int attempted;
+    int wrong;
+    int originalIndex;   // position of the line among the student lines of the analysis file
+};
+
+/**
+ * Ranking of every attempt of one exam, ordered by score (descending) then total time
+ * (ascending), kept in an order-statistic tree so that inserting a submission, finding
+ * a student's rank and reading any page of the leaderboard are all O(log n). Viewers
+ * read the tree through a PinnedRanking, which keeps to the rows ranked when it was taken.
+ *
+ * A leaderboard is built once from the exam's analysis columns and then follows them: the
+ * submission view thread calls refresh() after appending, which inserts only the new rows.
+ * A re-grade or a rewritten analysis file starts a new index rather than clearing the
+ * old one, so pins taken before it keep reading the rows they were taken from.
+ */
+class Leaderboard {
+public:
+    static const int TOP_ROWS = 10;      // rows every student sees
+    static const int WINDOW_ROWS = 5;    // rows shown above and below the student's own rank
+    static const size_t NO_RANK = (size_t)-1;
+
+    static void refresh(const string& examName);
+    static void refresh(const string& examName, const ColumnSnapshot& columns);
+    static DataVersion version(const string& examName);
+    static shared_ptr<const class PinnedRanking> pinned(const string& examName, DataVersion& version);
+    static shared_ptr<class LeaderboardView> studentView(const string& examName, const string& studentId);
+    static string renderRows(const vector<RankEntry>& rows, size_t firstRank, int numQuestions, int maxMarks);
+    static string renderStudentReport(size_t total, int numQuestions, int maxMarks, size_t position,
+                                      const function<vector<RankEntry>(size_t, size_t)>& rowsFrom);
+
+private:
+    friend class PinnedRanking;
+
+    // (-score, time, originalIndex): ascending order is leaderboard order
+    typedef tuple<int, double, int> RankKey;
+    typedef __gnu_pbds::tree<RankKey, __gnu_pbds::null_type, less<RankKey>,
+                             __gnu_pbds::rb_tree_tag,
+                             __gnu_pbds::tree_order_statistics_node_update> RankTree;
+
+    // The attempts ranked since the index was (re)built; only ever appended to
+    struct RankIndex {
+        vector<RankEntry> entries;                        // by originalIndex
+        RankTree order;
+        unordered_map<string, vector<int>> attemptsOf;    // student -> originalIndex, ascending
+
+        static RankKey keyOf(const RankEntry& entry) { return RankKey(-entry.score, entry.time, entry.originalIndex); }
+    };
+
+    struct ExamRanking {
+        pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;    // guards index, including pinned readers of it
+        vector<char> correctAnswers;
+        MarkingScheme scheme;
+        shared_ptr<RankIndex> index = make_shared<RankIndex>();
+        off_t analysisBytes = 0;
+        bool loaded = false;
+
+        void catchUp(const ColumnSnapshot& columns);
+        void insert(const RankEntry& entry);
+    };
+
+    static map<string, unique_ptr<ExamRanking>> rankings;
+    static pthread_mutex_t lock;
+
+    static ExamRanking* ranking(const string& examName);
+    static bool read(const string& examName, const function<void(const ExamRanking&)>& reader);
+};
+
+/**
+ * The leaderboard of an exam as it stood at one version, read from the rank index.
+ *
+ * Attempts ranked after the pin (originalIndex >= size()) are skipped, so ranks and
+ * pages stay those of the pinned version. A rank costs one order_of_key() and a page one
+ * find_by_order() plus the page walk, each corrected for the attempts ranked since the
+ * pin: O(log n + attempts since the pin + rows returned).
+ */
+class PinnedRanking {
+public:
+    size_t size() const { return rowCount; }
+    size_t rankOf(const string& studentId) const;
+    vector<RankEntry> rows(size_t first, size_t count) const;
+
+private:
+    friend class Leaderboard;
+
+    Leaderboard::ExamRanking* ranking = nullptr;            // its lock guards the index
+    shared_ptr<const Leaderboard::RankIndex> index;
+    size_t rowCount = 0;                                    // rows of the index at the pin
+
+    vector<Leaderboard::RankKey> keysSincePin() const;
+};
+
+/**
+ * A leaderboard being paged through by one client.
+ *
+ * Rows come from a RowSource over rows pinned when the view was created (a PinnedRanking,
+ * or the top K in streaming mode), so the header, the ranks and the pages agree however
+ * many attempts arrive meanwhile. Clients move with the
+ * commands NEXT, PREV, TOP, PAGE <n>, SIZE <rows> and AROUND (the viewer's own rank).
+ * In streaming analysis mode only the top `pageable` rows are kept, plus the rows
+ * around the viewer's rank (setNeighbourhood).
+ */
+class LeaderboardView {
+public:
+    typedef function<vector<RankEntry>(size_t first, size_t count)> RowSource;
+
+    static const size_t DEFAULT_PAGE_SIZE = 20;
+    static const size_t MAX_PAGE_SIZE = 500;
+
+    LeaderboardView(const RowSource& rows, size_t pageable, size_t total, int numQuestions, int maxMarks,
+                    size_t ownRank = Leaderboard::NO_RANK);
+    static RowSource rowsOf(const shared_ptr<const vector<RankEntry>>& rows);
+    static RowSource rowsOf(const shared_ptr<const PinnedRanking>& pinned);
+    void setNeighbourhood(size_t first, const vector<RankEntry>& rows);
+    string summary() const;
+    string page() const;
+    bool handle(const string& request, string& reply);
+
+private:
+    RowSource rows;
+    size_t pageable;                 // rows that can be paged through
+    size_t total;                    // attempts ranked
+    int numQuestions;
+    int maxMarks;                    // full marks of the exam's scheme
+    size_t ownRank;                  // 0-based rank of the viewer's best attempt, or NO_RANK
+    size_t pageSize = DEFAULT_PAGE_SIZE;
+    size_t first = 0;                // rank (0-based) of the current page's first row
+    size_t neighbourhoodFirst = 0;
+    vector<RankEntry> neighbourhood;
+
+    vector<RankEntry> rowsFrom(size_t begin, size_t end) const;
+    string render(size_t begin, const vector<RankEntry>& shown) const;
+};
+
+#endif
@@ -0,0 +1,115 @@
+// leaderboard_test.cpp
+// Checks the rank index against a brute-force sort of a synthetic cohort: students'
+// ranks (from order_of_key) and a page from the middle of the leaderboard (from
+// find_by_order). A pin taken before more attempts arrive must keep answering for
+// the rows it was taken at, and a new pin must cover the later ones.
+//
+// Usage: ./leaderboard_test   (run by make test)
+
+#include "leaderboard.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+
+using namespace std;
+
+static const int QUESTIONS = 10;
+static const int STUDENTS = 700;     // fewer than attempts, so most students have several
+
+// A snapshot of the first `rows` attempts of a deterministic cohort; a longer one extends a shorter one
+static ColumnSnapshot makeCohort(size_t rows) {
+    ColumnSnapshot cohort;
+    for (int q = 0; q < QUESTIONS; ++q) cohort.correctAnswers.push_back("ABCD"[q % 4]);
+
+    uint32_t seed = 2024;
+    auto next = [&]() {
+        seed = seed * 1103515245u + 12345u;
+        return seed >> 8;
+    };
+    for (size_t first = 0; first < rows; first += AnalysisColumns::ROWS_PER_GROUP) {
+        auto group = make_shared<RowGroup>();
+        group->rows = min(rows - first, AnalysisColumns::ROWS_PER_GROUP);
+        for (size_t r = 0; r < group->rows; ++r) {
+            group->studentIds.push_back("s" + to_string((first + r) * 7919 % STUDENTS));
+            group->students.push_back(r);
+        }
+        group->answers.assign(QUESTIONS, vector<uint8_t>(group->rows));
+        group->times.assign(QUESTIONS, vector<uint16_t>(group->rows));
+        for (size_t r = 0; r < group->rows; ++r) {
+            for (int q = 0; q < QUESTIONS; ++q) {
+                uint32_t answer = next() % 5;
+                group->answers[q][r] = answer == 4 ? RowGroup::SKIPPED : answer;
+                group->times[q][r] = next() % 4;     // few distinct totals: many ties on score and time
+            }
+        }
+        cohort.groups.push_back(group);
+    }
+    cohort.rows = rows;
+    cohort.analysisBytes = rows;
+    return cohort;
+}
+
+// The leaderboard by sorting every attempt: score descending, then time, then file order
+static vector<RankEntry> sortedBoard(const ColumnSnapshot& cohort) {
+    ColumnTotals totals;
+    cohort.aggregate(0, cohort.rows, totals);
+    vector<RankEntry> board;
+    for (size_t r = 0; r < cohort.rows; ++r) {
+        board.push_back({cohort.studentId(r), totals.score(r), (double)totals.rowTime[r], totals.attempted(r),
+                         totals.wrong(r), (int)r});
+    }
+    sort(board.begin(), board.end(), [](const RankEntry& a, const RankEntry& b) {
+        return make_tuple(-a.score, a.time, a.originalIndex) < make_tuple(-b.score, b.time, b.originalIndex);
+    });
+    return board;
+}
+
+static bool check(bool ok, const string& what) {
+    cout << (ok ? "[✔] " : "[✖] ") << what << endl;
+    return ok;
+}
+
+// Every student's rank and a page from the middle, as the pin answers them, against the sorted board
+static bool matches(const PinnedRanking& pin, const vector<RankEntry>& board, const string& what) {
+    bool ok = check(pin.size() == board.size(), what + ": " + to_string(board.size()) + " rows pinned");
+
+    bool ranks = true;
+    for (int s = 0; s < STUDENTS; ++s) {
+        string id = "s" + to_string(s);
+        size_t expected = Leaderboard::NO_RANK;
+        for (size_t i = 0; i < board.size() && expected == Leaderboard::NO_RANK; ++i) {
+            if (board[i].id == id) expected = i;
+        }
+        ranks = ranks && pin.rankOf(id) == expected;
+    }
+    ok = check(ranks, what + ": every student's rank") && ok;
+
+    size_t first = board.size() / 2 - 7, count = 20;
+    vector<RankEntry> page = pin.rows(first, count);
+    bool same = page.size() == count;
+    for (size_t i = 0; same && i < count; ++i) same = page[i].originalIndex == board[first + i].originalIndex;
+    ok = check(same, what + ": rows ranked " + to_string(first + 1) + "-" + to_string(first + count)) && ok;
+
+    vector<RankEntry> tail = pin.rows(board.size() - 3, 10);
+    ok = check(tail.size() == 3 && tail.back().originalIndex == board.back().originalIndex, what + ": last page") && ok;
+    return ok;
+}
+
+int main() {
+    const string exam = "rank_test";
+    ColumnSnapshot before = makeCohort(5000), after = makeCohort(9000);
+
+    Leaderboard::refresh(exam, before);
+    DataVersion version;
+    shared_ptr<const PinnedRanking> pinned = Leaderboard::pinned(exam, version);
+    bool ok = matches(*pinned, sortedBoard(before), "pinned");
+
+    // Later attempts are inserted into the same tree; the old pin must skip them
+    Leaderboard::refresh(exam, after);
+    ok = matches(*pinned, sortedBoard(before), "old pin after more attempts") && ok;
+    ok = matches(*Leaderboard::pinned(exam, version), sortedBoard(after), "new pin") && ok;
+    return ok ? 0 : 1;
+}
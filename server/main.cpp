@@ -1,11 +1,66 @@
 // main.cpp
 // Entry point for the server-side application.
+//
+// Usage: ./server [--port=N] [--mode=thread|reactor|pool] [--loops=N]
+//                 [--workers=N] [--queue=N] [--retry-after=SECONDS] [--stats=SECONDS]
+//                 [--paper-cache=MB] [--analysis=memory|streaming] [--top-k=N]
+//                 [--analysis-threads=N] [--collusion-pairs=N]
 
 #include "server.h"  // Include server class definition
 
-int main() {
-    // Create a server object listening on port 8080
-    Server server(8080);
+int main(int argc, char* argv[]) {
+    // Default: listen on port 8080 with one thread per client
+    ServerConfig config;
+
+    // Read --key=value options from the command line
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = (eq == string::npos) ? "" : arg.substr(eq + 1);
+
+        if (key == "--port") config.port = atoi(value.c_str());
+        else if (key == "--mode") config.mode = value;
+        else if (key == "--loops") config.eventLoops = atoi(value.c_str());
+        else if (key == "--workers") config.workers = atoi(value.c_str());
+        else if (key == "--queue") config.queueCapacity = atoi(value.c_str());
+        else if (key == "--retry-after") config.retryAfter = atoi(value.c_str());
+        else if (key == "--stats") config.statsInterval = atoi(value.c_str());
+        else if (key == "--paper-cache") config.paperCacheMB = atoi(value.c_str());
+        else if (key == "--analysis") config.analysis = value;
+        else if (key == "--top-k") config.topK = atoi(value.c_str());
+        else if (key == "--analysis-threads") config.analysisThreads = atoi(value.c_str());
+        else if (key == "--collusion-pairs") config.collusionPairs = atoi(value.c_str());
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+
+    if (config.mode != "thread" && config.mode != "reactor" && config.mode != "pool") {
+        cerr << "Unknown mode: " << config.mode << " (expected thread, reactor or pool)" << endl;
+        return 1;
+    }
+
+    if (config.analysis != "memory" && config.analysis != "streaming") {
+        cerr << "Unknown analysis mode: " << config.analysis << " (expected memory or streaming)" << endl;
+        return 1;
+    }
+    if (config.topK < 1) {
+        cerr << "--top-k must be at least 1" << endl;
+        return 1;
+    }
+    if (config.analysisThreads < 0) {
+        cerr << "--analysis-threads must be 0 (one per core) or more" << endl;
+        return 1;
+    }
+    if (config.collusionPairs < 1) {
+        cerr << "--collusion-pairs must be at least 1" << endl;
+        return 1;
+    }
+
+    // Create a server object listening on the configured port
+    Server server(config);
 
     // Start the server (bind, listen, accept connections, etc.)
     server.start();
@@ -0,0 +1,101 @@
+#include "marking_scheme.h"
+
+#include <vector>
+#include <cstdlib>
+#include <cctype>
+
+string signedMark(int mark) {
+    return mark > 0 ? "+" + to_string(mark) : to_string(mark);
+}
+
+/**
+ * Parses a scheme written as "<correct>/<wrong>" or "<correct>/<wrong>/<unanswered>",
+ * e.g. "+4/-1", "1/0" or "+2/0/+1".
+ *
+ * @param text The scheme as typed by the instructor.
+ * @param scheme Receives the marks.
+ * @return False if the text is malformed, or a correct answer is not worth the most.
+ */
+bool MarkingScheme::parse(const string& text, MarkingScheme& scheme) {
+    vector<int> marks;
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t end = text.find('/', pos);
+        if (end == string::npos) end = text.size();
+        string field = text.substr(pos, end - pos);
+        size_t first = field.find_first_not_of(" \t"), last = field.find_last_not_of(" \t");
+        if (first == string::npos) return false;
+        field = field.substr(first, last - first + 1);
+
+        char* rest;
+        long mark = strtol(field.c_str(), &rest, 10);
+        if (*rest != '\0' || !isdigit((unsigned char)field.back()) || mark < -MAX_MARK || mark > MAX_MARK) return false;
+        marks.push_back(mark);
+        pos = end + 1;
+    }
+    if (marks.size() != 2 && marks.size() != 3) return false;
+
+    MarkingScheme parsed;
+    parsed.correct = marks[0];
+    parsed.wrong = marks[1];
+    parsed.skipped = marks.size() == 3 ? marks[2] : 0;
+    if (parsed.correct <= 0 || parsed.wrong >= parsed.correct || parsed.skipped >= parsed.correct) return false;
+    scheme = parsed;
+    return true;
+}
+
+// "+4/-1", with the unanswered mark only when it is not 0 ("+2/0/+1")
+string MarkingScheme::text() const {
+    string result = signedMark(correct) + "/" + signedMark(wrong);
+    if (skipped != 0) result += "/" + signedMark(skipped);
+    return result;
+}
+
+// --- Grading kernels ---
+
+// The marks are template arguments, so each instantiation grades with constants: the
+// mark is a sum of two compare results scaled by constants, with no branch and no load
+// of the scheme, which lets the compiler vectorize the loop
+template <int Correct, int Wrong, int Skipped>
+static int gradeFixed(const MarkingScheme&, const int8_t* answers, const int8_t* key, int8_t* marks, size_t questions) {
+    int total = 0;
+    for (size_t q = 0; q < questions; ++q) {
+        int answered = answers[q] >= 0;
+        int correct = answers[q] == key[q];      // a skipped answer (-1) never matches the key
+        int8_t mark = Skipped + answered * (Wrong - Skipped) + correct * (Correct - Wrong);
+        marks[q] = mark;
+        total += mark;
+    }
+    return total;
+}
+
+// Any other scheme: the outcome of each question indexes a table of its marks
+static int gradeGeneric(const MarkingScheme& scheme, const int8_t* answers, const int8_t* key, int8_t* marks,
+                        size_t questions) {
+    const int8_t table[3] = {(int8_t)scheme.wrong, (int8_t)scheme.correct, (int8_t)scheme.skipped};
+    int total = 0;
+    for (size_t q = 0; q < questions; ++q) {
+        int outcome = answers[q] < 0 ? 2 : answers[q] == key[q];
+        marks[q] = table[outcome];
+        total += marks[q];
+    }
+    return total;
+}
+
+// Schemes common enough to get their own kernel
+static const struct {
+    MarkingScheme scheme;
+    SheetGrader grade;
+} SPECIALIZED[] = {
+    {{4, -1, 0}, gradeFixed<4, -1, 0>},
+    {{3, -1, 0}, gradeFixed<3, -1, 0>},
+    {{4, 0, 0}, gradeFixed<4, 0, 0>},
+    {{1, 0, 0}, gradeFixed<1, 0, 0>},
+};
+
+SheetGrader MarkingScheme::grader() const {
+    for (const auto& entry : SPECIALIZED) {
+        if (entry.scheme == *this) return entry.grade;
+    }
+    return gradeGeneric;
+}
@@ -0,0 +1,49 @@
+#ifndef MARKING_SCHEME_H
+#define MARKING_SCHEME_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+struct MarkingScheme;
+
+// Grades one answer sheet (answers[q] is -1 when skipped): fills marks[q], returns the total
+typedef int (*SheetGrader)(const MarkingScheme& scheme, const int8_t* answers, const int8_t* key,
+                           int8_t* marks, size_t questions);
+
+/**
+ * Marks an exam awards for a correct, a wrong and an unanswered question, chosen by
+ * the instructor at upload and written as "+4/-1" or, with credit for skipping,
+ * "+2/0/+1". The default is the original +4 / -1 / 0.
+ *
+ * Sheets are graded by grader(): the common schemes have kernels compiled with their
+ * marks as constants, any other scheme gets the generic kernel that reads them from
+ * a table. Either way the choice is made once per sheet, not per question.
+ */
+struct MarkingScheme {
+    static const int MAX_MARK = 100;       // marks are stored per question as int8
+
+    int correct = 4;
+    int wrong = -1;
+    int skipped = 0;
+
+    static bool parse(const string& text, MarkingScheme& scheme);
+    string text() const;
+    SheetGrader grader() const;
+
+    int mark(int answer, int key) const { return answer < 0 ? skipped : answer == key ? correct : wrong; }
+    int score(int corrects, int wrongs, int skips) const { return correct * corrects + wrong * wrongs + skipped * skips; }
+    int maxMarks(int questions) const { return correct * questions; }
+
+    bool operator==(const MarkingScheme& other) const {
+        return correct == other.correct && wrong == other.wrong && skipped == other.skipped;
+    }
+    bool operator!=(const MarkingScheme& other) const { return !(*this == other); }
+};
+
+// A mark with its sign, as shown to students and instructors ("+4", "-1", "0")
+string signedMark(int mark);
+
+#endif
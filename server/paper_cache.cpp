@@ -0,0 +1,106 @@
+#include "paper_cache.h"
+
+PaperCache::LruList PaperCache::lru;
+unordered_map<string, PaperCache::LruList::iterator> PaperCache::index;
+size_t PaperCache::capacity = 64 * 1024 * 1024;
+PaperCache::Stats PaperCache::counters{};
+pthread_mutex_t PaperCache::lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Sets the memory cap, evicting papers if the cache is already larger.
+ *
+ * @param bytes Maximum total size of the cached papers (0 disables the cache).
+ */
+void PaperCache::setCapacity(size_t bytes) {
+    pthread_mutex_lock(&lock);
+    capacity = bytes;
+    evictUntilFits(0);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Looks up the wire bytes of an exam's paper and marks it most recently used.
+ *
+ * @param examName The name of the exam.
+ * @return The cached frame, or nullptr on a miss.
+ */
+shared_ptr<const string> PaperCache::get(const string& examName) {
+    pthread_mutex_lock(&lock);
+    auto it = index.find(examName);
+    if (it == index.end()) {
+        counters.misses++;
+        pthread_mutex_unlock(&lock);
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    shared_ptr<const string> frame = it->second->second;
+    counters.hits++;
+    pthread_mutex_unlock(&lock);
+    return frame;
+}
+
+/**
+ * Caches the wire bytes of an exam's paper, replacing any older version.
+ *
+ * @param examName The name of the exam.
+ * @param frame The complete frame sent to students.
+ * @return False if the paper is larger than the whole cache and was not stored.
+ */
+bool PaperCache::put(const string& examName, const shared_ptr<const string>& frame) {
+    pthread_mutex_lock(&lock);
+    auto it = index.find(examName);
+    if (it != index.end()) {
+        counters.bytes -= it->second->second->size();
+        lru.erase(it->second);
+        index.erase(it);
+    }
+    if (frame->size() > capacity) {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+
+    evictUntilFits(frame->size());
+    lru.emplace_front(examName, frame);
+    index[examName] = lru.begin();
+    counters.bytes += frame->size();
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+// Forgets an exam's paper, e.g. after it was re-uploaded
+void PaperCache::invalidate(const string& examName) {
+    pthread_mutex_lock(&lock);
+    auto it = index.find(examName);
+    if (it != index.end()) {
+        counters.bytes -= it->second->second->size();
+        lru.erase(it->second);
+        index.erase(it);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+// True if a paper of this size could be cached at all
+bool PaperCache::fits(size_t bytes) {
+    pthread_mutex_lock(&lock);
+    bool result = bytes <= capacity;
+    pthread_mutex_unlock(&lock);
+    return result;
+}
+
+PaperCache::Stats PaperCache::stats() {
+    pthread_mutex_lock(&lock);
+    Stats snapshot = counters;
+    snapshot.entries = index.size();
+    pthread_mutex_unlock(&lock);
+    return snapshot;
+}
+
+// Drops least recently used papers until `incoming` more bytes fit (lock held)
+void PaperCache::evictUntilFits(size_t incoming) {
+    while (!lru.empty() && counters.bytes + incoming > capacity) {
+        counters.bytes -= lru.back().second->size();
+        index.erase(lru.back().first);
+        lru.pop_back();
+        counters.evictions++;
+    }
+}
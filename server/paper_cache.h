@@ -0,0 +1,49 @@
+#ifndef PAPER_CACHE_H
+#define PAPER_CACHE_H
+
+#include <string>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <pthread.h>
+
+using namespace std;
+
+/**
+ * Process-wide cache of question papers in their final wire form (frame header + questions),
+ * keyed by exam name.
+ *
+ * Serving a cached paper is a hash lookup plus a send: every session shares the same
+ * immutable buffer. The total size is capped and the least recently served paper is
+ * evicted first; papers larger than the cap are never cached.
+ */
+class PaperCache {
+public:
+    struct Stats {
+        size_t entries;
+        size_t bytes;
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+    };
+
+    static void setCapacity(size_t bytes);
+    static shared_ptr<const string> get(const string& examName);
+    static bool put(const string& examName, const shared_ptr<const string>& frame);
+    static void invalidate(const string& examName);
+    static bool fits(size_t bytes);
+    static Stats stats();
+
+private:
+    typedef list<pair<string, shared_ptr<const string>>> LruList;
+
+    static LruList lru;                                       // most recently served at the front
+    static unordered_map<string, LruList::iterator> index;
+    static size_t capacity;
+    static Stats counters;
+    static pthread_mutex_t lock;
+
+    static void evictUntilFits(size_t incoming);
+};
+
+#endif
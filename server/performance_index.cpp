@@ -0,0 +1,148 @@
+#include "performance_index.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+pthread_mutex_t PerformanceIndex::rebuildLock = PTHREAD_MUTEX_INITIALIZER;
+
+static_assert(sizeof(PerformanceIndex::Entry) == 40, "index entries are fixed-size on disk");
+
+// Reads exactly `length` bytes at `offset`; false on a short read
+static bool preadAll(int fd, char* data, size_t length, off_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, data + done, length - done, offset + done);
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+static bool sameTimestamp(const PerformanceIndex::Entry& entry, const string& timestamp) {
+    return timestamp.size() < sizeof(entry.timestamp) &&
+           strncmp(entry.timestamp, timestamp.c_str(), sizeof(entry.timestamp)) == 0;
+}
+
+string PerformanceIndex::indexPathOf(const string& perfPath) {
+    size_t dot = perfPath.rfind(".txt");
+    return (dot == string::npos ? perfPath : perfPath.substr(0, dot)) + ".idx";
+}
+
+/**
+ * Serializes one index entry for appending to the ".idx" file.
+ *
+ * @param timestamp Attempt timestamp, as written on the record's summary line.
+ * @param offset Byte offset of the record's START line in the performance file.
+ * @param length Length of the record in bytes.
+ */
+string PerformanceIndex::encode(const string& timestamp, off_t offset, size_t length) {
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = offset;
+    entry.length = length;
+    strncpy(entry.timestamp, timestamp.c_str(), sizeof(entry.timestamp) - 1);
+    return string(reinterpret_cast<const char*>(&entry), sizeof(entry));
+}
+
+/**
+ * Reads the text of one attempt record ("START" through the last question line).
+ *
+ * @param perfPath Path to the performance file.
+ * @param ordinal Position of the attempt among this exam's attempts (0-based).
+ * @param timestamp Timestamp the record must carry.
+ * @param record Receives the record text.
+ * @return False if the performance file or the attempt does not exist.
+ */
+bool PerformanceIndex::readAttempt(const string& perfPath, size_t ordinal, const string& timestamp, string& record) {
+    if (lookup(perfPath, ordinal, timestamp, record)) return true;
+    // Stale or missing index: rebuild it once from the performance file and retry
+    return rebuild(perfPath) && lookup(perfPath, ordinal, timestamp, record);
+}
+
+bool PerformanceIndex::lookup(const string& perfPath, size_t ordinal, const string& timestamp, string& record) {
+    int idx = open(indexPathOf(perfPath).c_str(), O_RDONLY);
+    if (idx == -1) return false;
+
+    // The attempt's position is its slot; fall back to the first entry with the same
+    // timestamp, which is what the attempt list shows
+    Entry entry;
+    bool found = preadAll(idx, reinterpret_cast<char*>(&entry), sizeof(entry), ordinal * sizeof(entry)) &&
+                 sameTimestamp(entry, timestamp);
+    if (!found) {
+        struct stat st;
+        fstat(idx, &st);
+        vector<Entry> entries(st.st_size / sizeof(Entry));
+        if (!entries.empty() && preadAll(idx, reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(Entry), 0)) {
+            for (const Entry& candidate : entries) {
+                if (sameTimestamp(candidate, timestamp)) {
+                    entry = candidate;
+                    found = true;
+                    break;
+                }
+            }
+        }
+    }
+    close(idx);
+    if (!found) return false;
+
+    int perf = open(perfPath.c_str(), O_RDONLY);
+    if (perf == -1) return false;
+    record.resize(entry.length);
+    bool ok = preadAll(perf, &record[0], entry.length, entry.offset);
+    close(perf);
+
+    // The entry must point at this attempt's START block
+    return ok && record.compare(0, 6 + timestamp.size() + 1, "START\n" + timestamp + "|") == 0;
+}
+
+// Rewrites the ".idx" file from a scan of the performance file
+bool PerformanceIndex::rebuild(const string& perfPath) {
+    pthread_mutex_lock(&rebuildLock);
+    bool rebuilt = rebuildLocked(perfPath);
+    pthread_mutex_unlock(&rebuildLock);
+    return rebuilt;
+}
+
+bool PerformanceIndex::rebuildLocked(const string& perfPath) {
+    ifstream perfFile(perfPath, ios::binary);
+    if (!perfFile.is_open()) return false;
+
+    string entries, line, timestamp;
+    off_t start = -1, position = 0;
+    bool expectSummary = false;
+    while (getline(perfFile, line)) {
+        if (line == "START") {
+            if (start != -1) entries += encode(timestamp, start, position - start);
+            start = position;
+            expectSummary = true;
+        } else if (expectSummary) {
+            timestamp = line.substr(0, line.find('|'));
+            expectSummary = false;
+        }
+        position += line.size() + 1;
+    }
+    // The last line may lack its newline
+    struct stat st;
+    if (stat(perfPath.c_str(), &st) == 0 && position > st.st_size) position = st.st_size;
+    if (start != -1) entries += encode(timestamp, start, position - start);
+
+    // Swap in the new index whole so readers never see a half-written one
+    string indexPath = indexPathOf(perfPath);
+    string tmpPath = indexPath + ".tmp";
+    ofstream out(tmpPath, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+    out.write(entries.data(), entries.size());
+    out.close();
+    if (!out || rename(tmpPath.c_str(), indexPath.c_str()) != 0) {
+        cerr << "Error: Unable to write " << indexPath << "\n";
+        return false;
+    }
+    cout << "[+] Rebuilt attempt index " << indexPath << endl;
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef PERFORMANCE_INDEX_H
+#define PERFORMANCE_INDEX_H
+
+#include <string>
+#include <cstdint>
+#include <pthread.h>
+#include <sys/types.h>
+
+using namespace std;
+
+/**
+ * Byte-offset index of a student's performance file.
+ *
+ * Next to every "student_<id>_<exam>_performance.txt" lives a ".idx" file with one
+ * fixed-size entry per attempt, in the same order as the attempts list, so attempt
+ * details are read with one pread of the entry and one pread of the record instead
+ * of scanning the whole performance file.
+ *
+ * The index is derived data: an entry that does not point at the matching
+ * START block (missing index, files written before the index existed, a crash
+ * between the two appends) makes the reader rebuild it from the performance file.
+ */
+class PerformanceIndex {
+public:
+    struct Entry {
+        uint64_t offset;          // first byte of the attempt's START line
+        uint32_t length;          // bytes up to the next START (or end of file)
+        uint32_t reserved;
+        char timestamp[24];       // "YYYY-MM-DD HH:MM:SS", NUL padded
+    };
+
+    static string indexPathOf(const string& perfPath);
+    static string encode(const string& timestamp, off_t offset, size_t length);
+    static bool readAttempt(const string& perfPath, size_t ordinal, const string& timestamp, string& record);
+
+private:
+    static pthread_mutex_t rebuildLock;     // one rebuild at a time per process
+
+    static bool lookup(const string& perfPath, size_t ordinal, const string& timestamp, string& record);
+    static bool rebuild(const string& perfPath);
+    static bool rebuildLocked(const string& perfPath);
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "reactor.h"
+
+#include <iostream>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/eventfd.h>
+
+/**
+ * Creates the epoll instances for the event loops, each watching its own eventfd.
+ *
+ * @param loopCount Number of event-loop threads that will serve all connections.
+ * @param handlerCount Number of threads running requests that may block.
+ */
+Reactor::Reactor(int loopCount, int handlerCount) : handlerCount(handlerCount < 1 ? 1 : handlerCount) {
+    if (loopCount < 1) loopCount = 1;
+    loops.resize(loopCount);
+    for (EventLoop& loop : loops) {
+        loop.reactor = this;
+        loop.epfd = epoll_create1(0);
+        loop.wakeFd = eventfd(0, EFD_NONBLOCK);
+        if (loop.epfd == -1 || loop.wakeFd == -1) {
+            cerr << "Error: Could not create epoll instance\n";
+            exit(EXIT_FAILURE);
+        }
+        // The eventfd is the only registration without a connection behind it
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        epoll_ctl(loop.epfd, EPOLL_CTL_ADD, loop.wakeFd, &ev);
+    }
+}
+
+// Spawns one thread per event loop and the handler threads
+void Reactor::start() {
+    for (EventLoop& loop : loops) {
+        pthread_create(&loop.thread, nullptr, runLoop, &loop);
+        pthread_detach(loop.thread);
+    }
+    for (int i = 0; i < handlerCount; ++i) {
+        pthread_t handler;
+        pthread_create(&handler, nullptr, runHandler, this);
+        pthread_detach(handler);
+    }
+}
+
+/**
+ * Hands an accepted socket to one of the event loops (round robin).
+ * Called from the accepting thread; epoll_ctl is safe across threads.
+ *
+ * @param fd The accepted client socket.
+ */
+void Reactor::addConnection(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    EventLoop& loop = loops[nextLoop++ % loops.size()];
+    Connection* conn = new Connection(fd, &loop);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    if (epoll_ctl(loop.epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        cerr << "Error: Could not register client socket\n";
+        close(fd);
+        delete conn;
+    }
+}
+
+void* Reactor::runLoop(void* arg) {
+    EventLoop& loop = *static_cast<EventLoop*>(arg);
+    epoll_event events[64];
+
+    while (true) {
+        int n = epoll_wait(loop.epfd, events, 64, -1);
+        if (n == -1 && errno != EINTR) {
+            cerr << "Error: epoll_wait failed\n";
+            continue;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (!events[i].data.ptr) {
+                onFinished(loop);
+                continue;
+            }
+            Connection* conn = static_cast<Connection*>(events[i].data.ptr);
+
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                onReadable(conn);
+            }
+            advance(loop, conn);
+        }
+    }
+    return nullptr;
+}
+
+// Runs blocking requests one at a time and posts each connection back to its loop
+void* Reactor::runHandler(void* arg) {
+    Reactor* reactor = static_cast<Reactor*>(arg);
+
+    while (true) {
+        pthread_mutex_lock(&reactor->requestLock);
+        while (reactor->requests.empty()) {
+            pthread_cond_wait(&reactor->requestReady, &reactor->requestLock);
+        }
+        Connection* conn = reactor->requests.front();
+        reactor->requests.pop_front();
+        pthread_mutex_unlock(&reactor->requestLock);
+
+        conn->session.onMessage(conn->request);
+
+        EventLoop& loop = *conn->loop;
+        pthread_mutex_lock(&loop.lock);
+        loop.finished.push_back(conn);
+        pthread_mutex_unlock(&loop.lock);
+        uint64_t one = 1;
+        if (write(loop.wakeFd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+            cerr << "Error: Could not wake event loop\n";
+        }
+    }
+    return nullptr;
+}
+
+// Takes back the connections whose blocking request finished and resumes them
+void Reactor::onFinished(EventLoop& loop) {
+    uint64_t count;
+    while (read(loop.wakeFd, &count, sizeof(count)) == -1 && errno == EINTR);
+
+    vector<Connection*> finished;
+    pthread_mutex_lock(&loop.lock);
+    finished.swap(loop.finished);
+    pthread_mutex_unlock(&loop.lock);
+
+    for (Connection* conn : finished) {
+        conn->busy = false;
+        conn->request.clear();
+        advance(loop, conn);
+    }
+}
+
+/**
+ * Moves a connection along: writes its queued replies, dispatches the frames it has
+ * buffered and closes it once the session is over. A connection whose request is on
+ * a handler thread is left alone until that thread posts it back.
+ */
+void Reactor::advance(EventLoop& loop, Connection* conn) {
+    if (conn->busy) return;
+
+    bool alive = flush(conn);
+    if (alive) {
+        dispatch(conn);
+        if (conn->busy) return;
+        alive = flush(conn);
+    }
+    if (!alive || (conn->session.isClosed() && conn->session.outbox.empty())) {
+        closeConnection(loop, conn);
+    }
+}
+
+/**
+ * Feeds the buffered frames to the session until one of them may block, which goes
+ * to a handler thread. Marks the session closed when the peer hung up.
+ */
+void Reactor::dispatch(Connection* conn) {
+    string message;
+    while (!conn->session.isClosed() && conn->decoder.next(message)) {
+        if (conn->session.mayBlock(message)) {
+            Reactor* reactor = conn->loop->reactor;
+            conn->busy = true;
+            conn->request = move(message);
+            pthread_mutex_lock(&reactor->requestLock);
+            reactor->requests.push_back(conn);
+            pthread_cond_signal(&reactor->requestReady);
+            pthread_mutex_unlock(&reactor->requestLock);
+            return;
+        }
+        conn->session.onMessage(message);
+    }
+    if (conn->hungUp || conn->decoder.failed()) {
+        conn->session.outbox.clear();
+        conn->session.close();
+    }
+}
+
+/**
+ * Drains the socket (edge-triggered: read until EAGAIN) into the frame decoder and
+ * notes whether the peer hung up. Frames are dispatched by advance().
+ */
+void Reactor::onReadable(Connection* conn) {
+    char buffer[4096];
+    bool eof = false;
+
+    while (true) {
+        ssize_t n = recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn->decoder.feed(buffer, n);
+            continue;
+        }
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        eof = true;  // orderly shutdown or error
+        break;
+    }
+
+    if (eof) conn->hungUp = true;
+}
+
+/**
+ * Writes as much of the session's outbox as the socket accepts without blocking.
+ * sentBytes tracks progress through the front item, whether a string or a file.
+ *
+ * @return False if the connection failed while writing.
+ */
+bool Reactor::flush(Connection* conn) {
+    auto& outbox = conn->session.outbox;
+
+    while (!outbox.empty()) {
+        // Pre-rendered files go straight from the page cache to the socket
+        if (outbox.front().file) {
+            const Session::FileBody& file = *outbox.front().file;
+            while ((off_t)conn->sentBytes < file.length) {
+                off_t offset = conn->sentBytes;
+                ssize_t n = sendfile(conn->fd, file.fd, &offset, file.length - offset);
+                if (n == -1 && errno == EINTR) continue;
+                if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;  // wait for EPOLLOUT
+                if (n <= 0) return false;
+                conn->sentBytes += n;
+            }
+            conn->sentBytes = 0;
+            outbox.pop_front();
+            continue;
+        }
+
+        const string& frame = outbox.front().bytes();
+
+        while (conn->sentBytes < frame.size()) {
+            ssize_t n = send(conn->fd, frame.data() + conn->sentBytes,
+                             frame.size() - conn->sentBytes, MSG_NOSIGNAL);
+            if (n == -1 && errno == EINTR) continue;
+            if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;  // wait for EPOLLOUT
+            if (n <= 0) return false;
+            conn->sentBytes += n;
+        }
+        conn->sentBytes = 0;
+        outbox.pop_front();
+    }
+    return true;
+}
+
+void Reactor::closeConnection(EventLoop& loop, Connection* conn) {
+    epoll_ctl(loop.epfd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    cout << "[-] client[ " << conn->session.username << " ] disconnected!" << endl;
+    delete conn;
+}
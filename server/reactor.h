@@ -0,0 +1,74 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <pthread.h>
+
+#include "session.h"
+
+using namespace std;
+
+/**
+ * Edge-triggered epoll reactor.
+ *
+ * A fixed set of event-loop threads serves every client connection. Each
+ * connection's Session is advanced frame by frame on readable events and its
+ * outbox is drained on writable events, so no thread ever blocks on a single client.
+ *
+ * Requests that wait on the disk or run long (see Session::mayBlock) are handed to a
+ * small set of handler threads instead. The connection stays with its loop meanwhile:
+ * further frames are buffered but not dispatched, and once the handler is done the
+ * connection is posted back through the loop's eventfd, which flushes the replies and
+ * resumes the session.
+ */
+class Reactor {
+public:
+    Reactor(int loopCount, int handlerCount);
+    void start();
+    void addConnection(int fd);
+
+private:
+    struct EventLoop;
+
+    struct Connection {
+        int fd;
+        EventLoop* loop;
+        Session session;
+        FrameDecoder decoder;      // reassembles client frames across reads
+        size_t sentBytes = 0;      // progress through outbox.front()
+        bool busy = false;         // a handler thread owns the session until it posts back
+        bool hungUp = false;       // peer closed (or sent a bad frame); close after the pending frames
+        string request;            // the frame handed to the handler thread
+        Connection(int fd, EventLoop* loop) : fd(fd), loop(loop), session(fd) {}
+    };
+
+    struct EventLoop {
+        int epfd;
+        int wakeFd;                        // eventfd: handler threads post finished connections
+        pthread_t thread;
+        Reactor* reactor;
+        pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+        vector<Connection*> finished;      // connections whose blocking request is done
+    };
+
+    vector<EventLoop> loops;
+    size_t nextLoop = 0;
+
+    int handlerCount;
+    deque<Connection*> requests;           // connections waiting for a handler thread
+    pthread_mutex_t requestLock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t requestReady = PTHREAD_COND_INITIALIZER;
+
+    static void* runLoop(void* arg);
+    static void* runHandler(void* arg);
+    static void onReadable(Connection* conn);
+    static void onFinished(EventLoop& loop);
+    static void advance(EventLoop& loop, Connection* conn);
+    static void dispatch(Connection* conn);
+    static bool flush(Connection* conn);
+    static void closeConnection(EventLoop& loop, Connection* conn);
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef RECORD_IO_H
+#define RECORD_IO_H
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+using namespace std;
+
+// Helpers for the server's binary record files (submission log, analysis columns)
+
+// Writes the whole buffer to a file descriptor, retrying on short writes
+inline bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+// FNV-1a, enough to tell a torn or garbled record from a complete one
+inline uint32_t checksum(const char* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+inline uint32_t checksum(const string& data) {
+    return checksum(data.data(), data.size());
+}
+
+template <typename T>
+inline void put(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+inline bool get(const string& in, size_t& pos, T& value) {
+    if (in.size() - pos < sizeof(value)) return false;
+    memcpy(&value, in.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+inline void putString(string& out, const string& value) {
+    put<uint16_t>(out, value.size());
+    out += value;
+}
+
+inline bool getString(const string& in, size_t& pos, string& value) {
+    uint16_t length;
+    if (!get(in, pos, length) || in.size() - pos < length) return false;
+    value.assign(in, pos, length);
+    pos += length;
+    return true;
+}
+
+#endif
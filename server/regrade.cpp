@@ -0,0 +1,396 @@
+#include "regrade.h"
+#include "answer_key_cache.h"
+#include "analysis_columns.h"
+#include "analysis_pool.h"
+#include "exam_catalog.h"
+#include "exam_aggregate.h"
+#include "leaderboard.h"
+#include "performance_index.h"
+#include "streaming_analysis.h"
+#include "submission_log.h"
+#include "record_io.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cctype>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
+
+pthread_rwlock_t Regrader::keyLock = PTHREAD_RWLOCK_INITIALIZER;
+pthread_mutex_t Regrader::lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* RESULTS_DIR = "../data/results";
+static const char* PENDING_PATH = "../data/results/regrade.pending";
+
+// A key as the submission log stores it: option index per question
+static vector<int8_t> indicesOf(const vector<char>& key) {
+    vector<int8_t> indices;
+    for (char answer : key) indices.push_back(answer - 'A');
+    return indices;
+}
+
+static string answersPathOf(const string& examName) {
+    return "../data/exams/answers_" + examName + ".txt";
+}
+
+// A rewritten file waiting under its temporary name
+struct Replacement {
+    string tempPath;
+    string path;
+};
+
+static bool readFile(const string& path, string& data) {
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) return false;
+    data.assign((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    return true;
+}
+
+static bool writeFile(const string& path, const string& data, bool sync) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) return false;
+    bool ok = writeAll(fd, data.data(), data.size()) && (!sync || fdatasync(fd) == 0);
+    close(fd);
+    return ok;
+}
+
+// Writes a small file in full under a temporary name and renames it into place
+static bool replaceFile(const string& path, const string& data) {
+    string tempPath = path + ".tmp";
+    return writeFile(tempPath, data, true) && rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+static vector<string> split(const string& text, char delimiter) {
+    vector<string> fields;
+    size_t start = 0, end;
+    while ((end = text.find(delimiter, start)) != string::npos) {
+        fields.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    fields.push_back(text.substr(start));
+    return fields;
+}
+
+static string join(const vector<string>& fields, char delimiter) {
+    string text;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (i > 0) text += delimiter;
+        text += fields[i];
+    }
+    return text;
+}
+
+/**
+ * Re-scores every attempt of a performance file ("START", summary line, "END", then
+ * "Q<n>|marks|answer|time" lines) with a new key.
+ *
+ * @param text The performance file.
+ * @param key The corrected answer key letters.
+ * @param scheme The exam's marking scheme.
+ * @param out Receives the re-scored file.
+ * @param index Receives its offset index (see PerformanceIndex).
+ * @param totals Receives each attempt's new marks, in file order.
+ */
+static void rescorePerformance(const string& text, const vector<char>& key, const MarkingScheme& scheme,
+                               string& out, string& index, vector<int>& totals) {
+    vector<int8_t> keyIndex;
+    for (char answer : key) keyIndex.push_back(answer - 'A');
+    SheetGrader grade = scheme.grader();
+
+    vector<string> lines = split(text, '\n');
+    if (!lines.empty() && lines.back().empty()) lines.pop_back();
+
+    size_t i = 0;
+    while (i < lines.size() && lines[i] != "START") out += lines[i++] + "\n";
+    while (i < lines.size()) {
+        size_t blockStart = out.size();
+        size_t end = i + 1;
+        while (end < lines.size() && lines[end] != "START") end++;
+
+        // Summary block is copied through END; the question lines after it are re-scored
+        vector<string> summary = split(i + 1 < end ? lines[i + 1] : "", '|');
+        size_t questionLine = i + 2;
+        while (questionLine < end && lines[questionLine - 1] != "END") questionLine++;
+
+        // The sheet is rebuilt from its answers and graded like a new submission
+        vector<int8_t> answers(key.size(), -1), marks(key.size(), 0);
+        int wrong = 0;
+        for (size_t j = questionLine; j < end; ++j) {
+            vector<string> fields = split(lines[j], '|');
+            size_t q = fields[0].size() >= 2 ? atoi(fields[0].c_str() + 1) - 1 : key.size();
+            if (fields.size() == 4 && q < key.size() && fields[2] != "NA") {
+                answers[q] = fields[2][0] - 'A';
+                if (answers[q] != keyIndex[q]) wrong++;
+            }
+        }
+        int total = grade(scheme, answers.data(), keyIndex.data(), marks.data(), key.size());
+
+        string body;
+        for (size_t j = questionLine; j < end; ++j) {
+            vector<string> fields = split(lines[j], '|');
+            size_t q = fields[0].size() >= 2 ? atoi(fields[0].c_str() + 1) - 1 : key.size();
+            if (fields.size() != 4 || q >= key.size()) {
+                body += lines[j] + "\n";
+                continue;
+            }
+            fields[1] = to_string(marks[q]);
+            body += join(fields, '|') + "\n";
+        }
+
+        // timestamp|exam|marks|max marks|questions|attempted|wrong|time
+        if (summary.size() == 8) {
+            summary[2] = to_string(total);
+            summary[6] = to_string(wrong);
+        }
+        out += "START\n";
+        if (i + 1 < end) out += join(summary, '|') + "\n";
+        for (size_t j = i + 2; j < questionLine; ++j) out += lines[j] + "\n";
+        out += body;
+
+        totals.push_back(total);
+        index += PerformanceIndex::encode(summary[0], blockStart, out.size() - blockStart);
+        i = end;
+    }
+}
+
+// Puts the new marks of an exam's attempts, in order, on its lines of a student's attempts list
+static string rescoreAttempts(const string& text, const string& examName, const vector<int>& totals) {
+    vector<string> lines = split(text, '\n');
+    if (!lines.empty() && lines.back().empty()) lines.pop_back();
+
+    string out;
+    size_t next = 0;
+    for (const string& line : lines) {
+        vector<string> fields = split(line, '|');
+        // exam|timestamp|marks|max marks|performance file
+        if (fields.size() == 5 && fields[0] == examName && next < totals.size()) fields[2] = to_string(totals[next++]);
+        out += join(fields, '|') + "\n";
+    }
+    return out;
+}
+
+/**
+ * Reads an exam's answer key (from the answer key cache).
+ *
+ * @param examName The name of the exam.
+ * @param key Receives one letter per question.
+ * @return False if the exam has no answer key.
+ */
+bool Regrader::loadKey(const string& examName, vector<char>& key) {
+    shared_ptr<const PackedKey> packed = AnswerKeyCache::get(examName);
+    if (!packed) return false;
+    key = packed->letters();
+    return true;
+}
+
+/**
+ * Parses a key typed by an instructor: one letter A-D per question, with or without
+ * spaces or commas between them ("ABDC", "a b d c", "A,B,D,C").
+ *
+ * @return False, with a message in `error`, if the key does not fit the exam.
+ */
+bool Regrader::parseKey(const string& text, size_t questions, vector<char>& key, string& error) {
+    key.clear();
+    for (char c : text) {
+        if (isspace((unsigned char)c) || c == ',') continue;
+        char letter = toupper((unsigned char)c);
+        if (letter < 'A' || letter > 'D') {
+            error = "[!] Answers must be letters A to D.";
+            return false;
+        }
+        key.push_back(letter);
+    }
+    if (key.size() != questions) {
+        error = "[!] The exam has " + to_string(questions) + " questions, but the key has " + to_string(key.size()) + " answers.";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Replaces an exam's answer key and re-scores every stored attempt with it.
+ *
+ * @param examName The name of the exam.
+ * @param key The corrected key, one letter per question.
+ * @param result Receives what changed.
+ * @param error Receives a message for the instructor on failure.
+ * @return False if nothing was re-graded.
+ */
+bool Regrader::run(const string& examName, const vector<char>& key, RegradeResult& result, string& error) {
+    auto start = chrono::steady_clock::now();
+    pthread_mutex_lock(&lock);
+
+    if (!loadKey(examName, result.oldKey) || result.oldKey.size() != key.size()) {
+        error = "[!] The answer key of this exam could not be read.";
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    for (size_t q = 0; q < key.size(); ++q) {
+        if (key[q] != result.oldKey[q]) result.changedQuestions.push_back(q);
+    }
+    if (result.changedQuestions.empty()) {
+        error = "[!] The corrected key is the same as the current one; nothing to re-grade.";
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+
+    // From here on a restart finishes the job from the key file
+    if (!replaceFile(PENDING_PATH, examName + "\n")) {
+        error = "[✖] Unable to start the re-grade: " + string(PENDING_PATH) + " could not be written.";
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    string keyText;
+    for (char answer : key) keyText += string(1, answer) + "\n";
+    auto packed = make_shared<PackedKey>();
+    PackedKey::pack(key, *packed);
+    pthread_rwlock_wrlock(&keyLock);
+    // Logged before the swap, after every submission graded with the old key: replaying them marks them anew
+    bool logged = SubmissionLog::appendRegrade(examName, indicesOf(key));
+    bool swapped = logged && replaceFile(answersPathOf(examName), keyText);
+    // Stored rather than dropped: a reader that missed the cache and read the old file
+    // cannot put the old key back afterwards (its store keeps a key already there)
+    if (swapped) AnswerKeyCache::put(examName, packed);
+    else if (logged) SubmissionLog::appendRegrade(examName, indicesOf(result.oldKey));
+    pthread_rwlock_unlock(&keyLock);
+    if (!swapped) {
+        unlink(PENDING_PATH);
+        error = logged ? "[✖] Unable to write the new answer key." : "[✖] Unable to record the re-grade in the submission log.";
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+
+    bool ok = rewrite(examName, key, result, error);
+    pthread_mutex_unlock(&lock);
+    result.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+/**
+ * Rewrites the files derived from an exam's attempts for the (already stored) key,
+ * with the submission views paused, then refreshes the in-memory analysis.
+ */
+bool Regrader::rewrite(const string& examName, const vector<char>& key, RegradeResult& result, string& error) {
+    SubmissionLog::pauseViews();
+
+    // One pass over the analysis file: a copy with the new key line, and the students to re-score
+    vector<Replacement> replacements;
+    vector<string> students;
+    string analysisPath = analysisPathOf(examName);
+    ifstream analysis(analysisPath, ios::binary);
+    if (analysis.is_open()) {
+        string tempPath = analysisPath + ".tmp";
+        ofstream out(tempPath, ios::binary | ios::trunc);
+        unordered_set<string> seen;
+        string line;
+        getline(analysis, line);
+        for (char answer : key) out << answer << " ";
+        out << "\n";
+        while (getline(analysis, line)) {
+            out << line;
+            if (!analysis.eof()) out << "\n";
+            string id = line.substr(0, line.find(' '));
+            if (!id.empty() && seen.insert(id).second) students.push_back(id);
+        }
+        out.close();
+        if (!out) {
+            error = "[✖] Unable to write " + tempPath + ".";
+            SubmissionLog::resumeViews();
+            return false;
+        }
+        replacements.push_back({tempPath, analysisPath});
+    }
+
+    // Every student's files are independent: re-score them on the analysis pool
+    MarkingScheme scheme = ExamCatalog::schemeOf(examName);
+    vector<vector<Replacement>> written(students.size());
+    vector<size_t> attempts(students.size(), 0);
+    vector<string> errors(students.size());
+    AnalysisPool::parallelFor(students.size(), [&](size_t s) {
+        string prefix = string(RESULTS_DIR) + "/student_" + students[s];
+        string perfPath = prefix + "_" + examName + "_performance.txt";
+        string perfText, attemptsText;
+        if (!readFile(perfPath, perfText)) return;
+
+        string rescored, index;
+        vector<int> totals;
+        rescorePerformance(perfText, key, scheme, rescored, index, totals);
+        attempts[s] = totals.size();
+        if (rescored == perfText) return;
+
+        string indexPath = PerformanceIndex::indexPathOf(perfPath);
+        vector<pair<string, string>> files = {{perfPath, rescored}, {indexPath, index}};
+        string attemptsPath = prefix + "_attempts.txt";
+        if (readFile(attemptsPath, attemptsText)) {
+            string updated = rescoreAttempts(attemptsText, examName, totals);
+            if (updated != attemptsText) files.push_back({attemptsPath, updated});
+        }
+        for (const auto& [path, data] : files) {
+            if (!writeFile(path + ".tmp", data, false)) {
+                errors[s] = "[✖] Unable to write " + path + ".tmp.";
+                return;
+            }
+            written[s].push_back({path + ".tmp", path});
+        }
+    });
+    for (size_t s = 0; s < students.size(); ++s) {
+        if (!errors[s].empty() && error.empty()) error = errors[s];
+        replacements.insert(replacements.end(), written[s].begin(), written[s].end());
+        result.attempts += attempts[s];
+    }
+    result.students = students.size();
+    result.filesRewritten = replacements.size();
+
+    if (!error.empty()) {
+        for (const Replacement& r : replacements) unlink(r.tempPath.c_str());
+        SubmissionLog::resumeViews();
+        return false;
+    }
+
+    // One sync makes every new file durable, then they all replace the old ones
+    int dir = open(RESULTS_DIR, O_RDONLY);
+    if (dir != -1) syncfs(dir);
+    for (const Replacement& r : replacements) {
+        if (rename(r.tempPath.c_str(), r.path.c_str()) != 0) cerr << "Error: Unable to replace " << r.path << "\n";
+    }
+    if (dir != -1) {
+        syncfs(dir);
+        close(dir);
+    }
+    unlink(PENDING_PATH);
+
+    // The in-memory analysis notices the new key and starts over; streaming mode reads the files as they are
+    if (!StreamingAnalysis::enabled()) {
+        AnalysisColumns::reload(examName);
+        ExamAggregate::refresh(examName);
+        Leaderboard::refresh(examName);
+        ExamAggregate::persistDirty();
+    }
+    SubmissionLog::resumeViews();
+    return true;
+}
+
+// Finishes a re-grade the server was stopped in the middle of
+void Regrader::resumePending() {
+    string marker;
+    if (!readFile(PENDING_PATH, marker)) return;
+    string examName = marker.substr(0, marker.find('\n'));
+    vector<char> key;
+    RegradeResult result;
+    string error;
+    if (examName.empty() || !loadKey(examName, key)) {
+        cerr << "[!] Dropping unfinished re-grade of '" << examName << "': no answer key\n";
+        unlink(PENDING_PATH);
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    // The server may have stopped after logging the new key but before swapping the key file
+    SubmissionLog::appendRegrade(examName, indicesOf(key));
+    bool ok = rewrite(examName, key, result, error);
+    pthread_mutex_unlock(&lock);
+    if (ok) cout << "[+] Finished the interrupted re-grade of '" << examName << "' (" << result.attempts << " attempts)" << endl;
+    else cerr << error << endl;
+}
@@ -0,0 +1,53 @@
+#ifndef REGRADE_H
+#define REGRADE_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+// What a re-grade changed
+struct RegradeResult {
+    size_t students = 0;
+    size_t attempts = 0;
+    size_t filesRewritten = 0;
+    vector<int> changedQuestions;    // 0-based
+    vector<char> oldKey;
+    double millis = 0;
+};
+
+/**
+ * Re-scores every stored attempt of an exam after its answer key is corrected.
+ *
+ * The key file is swapped first, under keyLock: submissions are graded and logged
+ * while holding it shared, so once the swap is done every submission graded with the
+ * old key is in the log. The submission views are then brought up to date and paused,
+ * each student's performance file (with its offset index) and attempts list is
+ * re-scored into a temporary file on the analysis pool, and the answer key line of
+ * the analysis file is replaced; everything is synced and renamed into place at once.
+ *
+ * The renames are not atomic as a group: a crash can leave some files re-scored and
+ * some not. What makes a re-grade all-or-nothing is the marker file "regrade.pending",
+ * written before the key is swapped and removed once every file is in place: on the
+ * next start resumePending() redoes the whole rewrite from the key file, which is
+ * idempotent since marks are always derived from the stored answers. The new key is
+ * also logged in the submission log before the swap, so replaying submissions graded
+ * with the old key cannot bring their old marks back.
+ */
+class Regrader {
+public:
+    static pthread_rwlock_t keyLock;
+
+    static bool loadKey(const string& examName, vector<char>& key);
+    static bool parseKey(const string& text, size_t questions, vector<char>& key, string& error);
+    static bool run(const string& examName, const vector<char>& key, RegradeResult& result, string& error);
+    static void resumePending();
+
+private:
+    static pthread_mutex_t lock;     // one re-grade at a time
+
+    static bool rewrite(const string& examName, const vector<char>& key, RegradeResult& result, string& error);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "report_cache.h"
+
+VersionedCache<string> ReportCache::metricsReports;
+VersionedCache<string> ReportCache::collusionReports;
+
+/**
+ * The overall, per-question and option-distribution block of an exam's analysis.
+ *
+ * @param examName The name of the exam.
+ * @param version Version of the totals the report is rendered from.
+ * @param render Renders the report; called only when the cached one is out of date.
+ */
+shared_ptr<const string> ReportCache::metrics(const string& examName, const Version& version,
+                                              const function<string()>& render) {
+    return metricsReports.get(examName, version, [&]() { return make_shared<const string>(render()); });
+}
+
+/**
+ * The answer-similarity report of an exam; it compares every pair of students, so a
+ * burst of instructors asking for it after an exam share one run.
+ *
+ * @param examName The name of the exam.
+ * @param version Version of the attempts the sheets come from.
+ * @param render Runs the check; called only when the cached report is out of date.
+ */
+shared_ptr<const string> ReportCache::collusion(const string& examName, const Version& version,
+                                                const function<string()>& render) {
+    return collusionReports.get(examName, version, [&]() { return make_shared<const string>(render()); });
+}
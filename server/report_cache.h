@@ -0,0 +1,101 @@
+#ifndef REPORT_CACHE_H
+#define REPORT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <pthread.h>
+
+#include "leaderboard.h"
+
+using namespace std;
+
+/**
+ * One value per key, tagged with the version of the data it was built from.
+ *
+ * get() returns the cached value while the version matches and builds a new one
+ * otherwise. Builds are single-flight: callers that arrive while a key is being built
+ * wait for that build instead of starting their own, so a burst of identical requests
+ * costs one computation. A build that throws releases the key (the waiters retry) and
+ * the exception reaches its caller.
+ */
+template <typename T>
+class VersionedCache {
+public:
+    typedef DataVersion Version;
+
+    shared_ptr<const T> get(const string& key, const Version& version, const function<shared_ptr<const T>()>& build) {
+        pthread_mutex_lock(&lock);
+        Slot& slot = slots[key];
+        while (!(slot.value && slot.version == version) && slot.building) pthread_cond_wait(&built, &lock);
+        if (slot.value && slot.version == version) {
+            shared_ptr<const T> value = slot.value;
+            pthread_mutex_unlock(&lock);
+            return value;
+        }
+        slot.building = true;
+        pthread_mutex_unlock(&lock);
+
+        // Clears the flag if build() throws, so the callers waiting on it are not left hanging
+        struct BuildGuard {
+            VersionedCache* cache;
+            Slot& slot;
+            bool finished = false;
+            ~BuildGuard() {
+                if (finished) return;
+                pthread_mutex_lock(&cache->lock);
+                slot.building = false;
+                pthread_cond_broadcast(&cache->built);
+                pthread_mutex_unlock(&cache->lock);
+            }
+        } guard{this, slot};
+        shared_ptr<const T> value = build();
+        guard.finished = true;
+
+        pthread_mutex_lock(&lock);
+        slot.building = false;
+        // A slower build of older data must not replace a newer value
+        if (!slot.value || slot.version.replacedBy(version)) {
+            slot.value = value;
+            slot.version = version;
+        }
+        pthread_cond_broadcast(&built);
+        pthread_mutex_unlock(&lock);
+        return value;
+    }
+
+private:
+    struct Slot {
+        Version version;
+        shared_ptr<const T> value;
+        bool building = false;
+    };
+
+    map<string, Slot> slots;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t built = PTHREAD_COND_INITIALIZER;
+};
+
+/**
+ * Analysis reports shared by every viewer of an exam until the next submission
+ * changes the data behind them: the rendered metrics block and the answer-similarity
+ * check. Leaderboards need no copy here: viewers page through the rank index itself,
+ * pinned at one version (Leaderboard::pinned).
+ */
+class ReportCache {
+public:
+    typedef VersionedCache<string>::Version Version;
+
+    static shared_ptr<const string> metrics(const string& examName, const Version& version,
+                                            const function<string()>& render);
+    static shared_ptr<const string> collusion(const string& examName, const Version& version,
+                                              const function<string()>& render);
+
+private:
+    static VersionedCache<string> metricsReports;
+    static VersionedCache<string> collusionReports;
+};
+
+#endif
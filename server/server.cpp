@@ -1,16 +1,33 @@
 #include "server.h"
+#include "reactor.h"
+#include "worker_pool.h"
+#include "paper_cache.h"
+#include "answer_key_cache.h"
+#include "submission_log.h"
+#include "exam_aggregate.h"
+#include "attempt_index.h"
+#include "performance_index.h"
+#include "streaming_analysis.h"
+#include "analysis_pool.h"
+#include "collusion.h"
+#include "regrade.h"
 #include <cctype>
-#define INT_MIN -1000
-
-static vector<string> exams;
-map<int, string> Server::socketToUsername;
+#include <charconv>
+#include <limits>
+#include <csignal>
+#include <cerrno>
+#include <sys/sendfile.h>
+#include <dirent.h>
 
 pthread_mutex_t file_mutex1 = PTHREAD_MUTEX_INITIALIZER; // global variables
-pthread_mutex_t file_mutex2 = PTHREAD_MUTEX_INITIALIZER; // exam log file
-pthread_mutex_t file_mutex3 = PTHREAD_MUTEX_INITIALIZER; // analysis file
 
-// Constructor to initialize and start the server on the specified port
-Server::Server(int port) {
+// Constructor taking the full runtime configuration (mode, event loops, port)
+Server::Server(const ServerConfig& cfg) : config(cfg) {
+    listenOn(config.port);
+}
+
+// Creates, binds and starts listening on the server socket
+void Server::listenOn(int port) {
     // Create a TCP socket (IPv4, stream-oriented)
     server_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket == -1) {
@@ -18,6 +35,10 @@ Server::Server(int port) {
         exit(EXIT_FAILURE);
     }
 
+    // Allow quick restarts without waiting for TIME_WAIT sockets to expire
+    int reuse = 1;
+    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
     // Define server address structure and zero-initialize
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;            // IPv4
@@ -30,8 +51,8 @@ Server::Server(int port) {
         exit(EXIT_FAILURE);
     }
 
-    // Start listening for incoming connections (backlog size 5)
-    if (listen(server_socket, 5) == -1) {
+    // Start listening for incoming connections; a full exam hall connects at once
+    if (listen(server_socket, SOMAXCONN) == -1) {
         cerr << "Error: Could not listen for connections\n";
         exit(EXIT_FAILURE);
     }
@@ -42,517 +63,538 @@ Server::Server(int port) {
 
 // Starts the server loop to handle incoming client connections
 void Server::start() {
+    // A client that disconnects mid-sendfile() must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+
     // Initialize the authentication manager (e.g., load user credentials)
     AuthManager();
 
     // Create an instance of ExamManager
     ExamManager em;
 
-    // Load exam metadata from file into the exams list
-    exams = em.load_exam_metadata("../data/exams/exam_list.txt");
+    // Memory cap for question papers kept in their wire form
+    PaperCache::setCapacity((size_t)config.paperCacheMB * 1024 * 1024);
+
+    // Threads that analysis kernels and report rendering split their rows across
+    int analysisThreads = config.analysisThreads > 0 ? config.analysisThreads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    AnalysisPool::start(analysisThreads);
+    cout << "[+] Analysis pool: " << AnalysisPool::threads() << " thread(s)" << endl;
+
+    // Streaming analysis keeps no per-attempt state, so it has to be chosen before the log replays
+    if (config.analysis == "streaming") {
+        StreamingAnalysis::enable(config.topK);
+        cout << "[+] Streaming analysis: leaderboards keep the top " << config.topK << " attempts" << endl;
+    }
+    CollusionDetector::setPairLimit(config.collusionPairs);
+
+    // Load exam metadata from file into the exam catalog (replayed submissions are marked by its schemes)
+    ExamCatalog::publish(em.load_exam_catalog("../data/exams/exam_list.txt"));
+
+    // Open the submission log, bringing the result files up to date with it
+    if (!SubmissionLog::open("../data/results/submissions.wal", writeSubmissionViews, onViewsWritten)) {
+        exit(EXIT_FAILURE);
+    }
+    Regrader::resumePending();
+
+    // Index every recorded (student, exam) attempt for the single-attempt check
+    AttemptIndex::load("../data/results/exam_log.txt");
+
+    // Reactor mode: a fixed set of epoll event loops serves every connection
+    if (config.mode == "reactor") {
+        Reactor reactor(config.eventLoops, config.workers);
+        reactor.start();
+        cout << "[+] Reactor mode with " << config.eventLoops << " event loops and " << config.workers
+             << " request handlers" << endl;
+
+        while (true) {
+            int client_socket = accept(server_socket, nullptr, nullptr);
+            if (client_socket == -1) continue;
+            reactor.addConnection(client_socket);
+        }
+    }
+
+    // Pool mode: accepted clients wait in a bounded queue for one of a fixed set of workers
+    if (config.mode == "pool") {
+        WorkerPool pool(config.workers, config.queueCapacity, config.retryAfter, serveClient);
+        pool.start();
+        cout << "[+] Pool mode with " << config.workers << " workers, queue of " << config.queueCapacity << endl;
+
+        if (config.statsInterval > 0) {
+            pthread_t statsThread;
+            static pair<WorkerPool*, int> statsArg;
+            statsArg = {&pool, config.statsInterval};
+            pthread_create(&statsThread, nullptr, reportPoolStats, &statsArg);
+            pthread_detach(statsThread);
+        }
+
+        while (true) {
+            int client_socket = accept(server_socket, nullptr, nullptr);
+            if (client_socket == -1) continue;
+            if (!pool.submit(client_socket)) {
+                cerr << "[!] Worker queue full, client turned away\n";
+            }
+        }
+    }
 
     // Start an infinite loop to accept and handle incoming client connections
     while (true) {
         // Accept a new client connection
         int client_socket = accept(server_socket, nullptr, nullptr);
+        if (client_socket == -1) continue;
 
-        // Create a new thread to handle the client
+        // Create a new thread to handle the client; it owns the heap copy of the socket
         pthread_t thread;
-        pthread_create(&thread, nullptr, handle_client, &client_socket);
+        pthread_create(&thread, nullptr, handle_client, new int(client_socket));
 
         // Detach the thread so that resources are automatically reclaimed when it exits
         pthread_detach(thread);
     }
 }
 
-void Server::analyzeExam(const string& examName, int sock, bool isStudent) {
-    // Construct the path to the exam analysis results file based on examName
-    string filePath = "../data/results/exam_" + examName + "_analysis.txt";
-    // Open the analysis file for reading
-    ifstream file(filePath);
-
-    // Check if file was successfully opened
-    if (!file.is_open()) {
+bool Server::analyzeExam(const string& examName, Session& session, bool isStudent) {
+    // Results are derived from the submission log; make sure they include every committed submission
+    SubmissionLog::waitForViews();
+
+    // Overall, per-question and option metrics come from the running totals, or from one
+    // pass over the analysis file in streaming mode
+    StreamingAnalysis streamed;
+    bool streaming = StreamingAnalysis::enabled();
+    shared_ptr<const ExamAggregate> aggregate;
+    if (!streaming) aggregate = ExamAggregate::get(examName);
+    else if (StreamingAnalysis::run(examName, streamed, isStudent ? session.username : "")) aggregate = streamed.totals;
+    if (!aggregate) {
         cerr << "Failed to open analysis file.\n";
         // Prepare messages to send to client socket indicating no analysis done
         string ms1 = "Analysis of this exam has not been done yet.";
         string ms2 = "The possible cause may be that no student has attempted this exam.";
-        send(sock, ms1.c_str(), ms1.size(), 0);
-        sleep(1);
-        send(sock, ms2.c_str(), ms2.size(), 0);
+        session.send(ms1);
+        session.send(ms2);
         // Exit function early as no data to analyze
-        return;
+        return false;
     }
-
-    // Read the first line which contains correct answers for each question
-    string line;
-    getline(file, line);
-    vector<string> correctAnswers;
-    stringstream ss(line);
-    char ans;
-    // Extract each answer character and store as string in correctAnswers vector
-    while (ss >> ans) {
-        correctAnswers.push_back(string(1, ans));
+    // The metrics block is the same for every viewer until the next submission
+    if (streaming) {
+        session.sendParts(aggregate->metricsReport());
+    } else {
+        auto metrics = ReportCache::metrics(examName, aggregate->version(), [&]() { return aggregate->metricsReport(); });
+        session.sendParts(*metrics);
     }
 
-    // Store the total number of questions in the exam
-    int numQuestions = correctAnswers.size();
+    auto analysis = make_shared<ExamAnalysis>();
+    analysis->examName = examName;
 
-    // Vector to hold student data: studentID and their answers with time spent per question
-    vector<pair<string, vector<pair<string, int>>>> studentDataVector;
+    // Students get the top of the leaderboard, their own neighbourhood and rank, then page from there
+    if (isStudent) {
+        analysis->view = streaming ? streamed.view(examName) : Leaderboard::studentView(examName, session.username);
+        session.sendParts(analysis->view->summary());
+        session.analysis = analysis;
+        return true;
+    }
 
-    // Read the rest of the file line by line containing each student's responses
-    while (getline(file, line)) {
-        if (line.empty()) continue; // Skip empty lines
-        stringstream ls(line);
-        string studentID;
-        // Read student ID from the line
-        ls >> studentID;
-
-        vector<pair<string, int>> answers; // Vector to store answers and time for each question
-        for (int i = 0; i < numQuestions; ++i) {
-            string answer;
-            int time;
-            // Extract the answer and time spent from the line
-            ls >> answer >> time;
-            // Replace "-" with "NA" to indicate not attempted
-            if (answer == "-") {
-                answers.push_back({"NA", time});
-            } else {
-                answers.push_back({answer, time});
-            }
-        }
-        // Store student ID and their answers in the main vector
-        studentDataVector.push_back({studentID, answers});
+    // Instructors page through the whole leaderboard and can drill into any student's responses
+    int numQuestions = aggregate->questionCount();
+    if (streaming) {
+        // Only the best attempts are kept; the drill-down re-reads the chosen line
+        analysis->view = streamed.view(examName);
+        analysis->rows = LeaderboardView::rowsOf(make_shared<const vector<RankEntry>>(streamed.top));
+        analysis->rowCount = streamed.top.size();
+        analysis->lineOffsets = streamed.topOffsets;
+    } else {
+        // The rank index pinned at its current version; the columns (taken after it) cover every ranked row
+        DataVersion version;
+        shared_ptr<const PinnedRanking> pinned = Leaderboard::pinned(examName, version);
+        analysis->columns = AnalysisColumns::snapshot(examName);
+        if (!analysis->columns) return false;
+        analysis->rows = LeaderboardView::rowsOf(pinned);
+        analysis->rowCount = pinned->size();
+        analysis->view = make_shared<LeaderboardView>(analysis->rows, analysis->rowCount, analysis->rowCount, numQuestions,
+                                                      aggregate->scheme.maxMarks(numQuestions));
     }
 
-    // Close the file after reading all data
-    file.close();
-    // Total number of students who attempted the exam
-    int totalStudents = studentDataVector.size();
-
-    // Initialize vectors to store metrics for each question
-    vector<int> questionAttempts(numQuestions, 0);      // Number of attempts per question
-    vector<int> questionCorrects(numQuestions, 0);      // Number of correct answers per question
-    vector<int> questionSkipped(numQuestions, 0);       // Number of skips per question
-    vector<double> questionTotalTime(numQuestions, 0.0);// Total time spent per question
-    vector<int> studentScores;                           // Score per student
-    vector<double> studentTimes;                         // Total time per student
-    // Count of options selected per question (A, B, C, D, NA)
-    vector<vector<int>> optionCount(numQuestions, vector<int>(5, 0));
-
-    // Iterate over each student's data to compute scores and statistics
-    for (const auto& [studentID, answers] : studentDataVector) {
-        int score = 0;            // Initialize student's score
-        double totalTime = 0.0;   // Initialize total time spent by student
-
-        // Iterate over each question for the current student
-        for (int i = 0; i < numQuestions; ++i) {
-            string ans = answers[i].first;      // Student's answer
-            int timeSpent = answers[i].second;  // Time spent on question
-            totalTime += timeSpent;              // Accumulate total time
-
-            // Check if question was skipped (marked as "NA")
-            if (ans == "NA") {
-                questionSkipped[i]++;            // Increment skipped count for question
-                optionCount[i][4]++;             // Increment NA option count
-            } else {
-                int idx = ans[0] - 'A';          // Convert answer character to index (0-based)
-                optionCount[i][idx]++;           // Increment count of selected option
-                questionAttempts[i]++;            // Increment attempt count for question
-                // Check correctness and update score and correct count
-                if (ans == correctAnswers[i]) {
-                    score += 4;                   // Add 4 points for correct answer
-                    questionCorrects[i]++;        // Increment correct count for question
-                } else {
-                    score -= 1;                   // Subtract 1 point for wrong answer
-                }
-            }
-            // Accumulate total time for the question (all students)
-            questionTotalTime[i] += timeSpent;
-        }
+    // First page of the leaderboard
+    session.sendParts(analysis->view->page());
+    session.analysis = analysis;
+    return true;
+}
 
-        // Save computed score and total time for the current student
-        studentScores.push_back(score);
-        studentTimes.push_back(totalTime);
+// Sends one student's attempt details (selected by leaderboard sr no.) followed by the current leaderboard page;
+// false when the instructor leaves the drill-down
+bool Server::sendStudentAttemptDetails(Session& session, int opt) {
+    if (!session.analysis) return false;
+    const ExamAnalysis& analysis = *session.analysis;
+
+    // 0 (or anything below) ends the drill-down; a sr no. past the leaderboard is reported
+    if (opt < 1) return false;
+    vector<RankEntry> picked = (size_t)opt <= analysis.rowCount ? analysis.rows(opt - 1, 1) : vector<RankEntry>();
+    if (picked.empty()) {
+        session.send("[!] Invalid sr no. Please pick a student from the leaderboard.");
+        return true;
     }
 
-    // Prepare a stringstream to build the report output
-    stringstream report;
-
-    // Calculate average score and average time spent across all students
-    double avgScore = accumulate(studentScores.begin(), studentScores.end(), 0.0) / totalStudents;
-    double avgTime = accumulate(studentTimes.begin(), studentTimes.end(), 0.0) / totalStudents;
-
-    // Create a copy of scores and sort to compute median
-    vector<int> sortedScores = studentScores;
-    sort(sortedScores.begin(), sortedScores.end());
-    // Calculate median score (handle even/odd number of students)
-    double medianScore = (totalStudents % 2 == 0)
-        ? (sortedScores[totalStudents / 2 - 1] + sortedScores[totalStudents / 2]) / 2.0
-        : sortedScores[totalStudents / 2];
-
-    // Write overall exam metrics header and summary
-    report << "\n-------------------------------Overall Exam Metrics--------------------------------\n";
-    report << "Total Students: " << totalStudents << "\n";
-    report << "Average Score: " << fixed << setprecision(1) << avgScore << " / " << (numQuestions * 4) << "\n";
-    report << "Median Score: " << medianScore << " / " << (numQuestions * 4) << "\n";
-    report << "Average Time Spent: " << fixed << setprecision(1) << avgTime << " s\n";
-    report << "-----------------------------------------------------------------------------------\n\n";
-
-    // Write per-question performance header and column titles
-    report << "------------------------------------Per-Question Performance------------------------------------------\n\n";
-    report << "| Question | # Attempted | # Correct  | # Wrong | # Skipped | % Correct | Avg Time (s) | Difficulty  |\n";
-    report << "------------------------------------------------------------------------------------------------------\n";
-
-    // Loop through each question and write detailed stats
-    for (int i = 0; i < numQuestions; ++i) {
-        int attempted = questionAttempts[i];              // Number attempted
-        int correct = questionCorrects[i];                // Number correct
-        int skipped = questionSkipped[i];                 // Number skipped
-        int wrong = attempted - correct;                   // Number wrong
-
-        // Calculate percentage correct and average time per question
-        double percentCorrect = (totalStudents > 0) ? (100.0 * correct / totalStudents) : 0.0;
-        double avgQTime = (totalStudents > 0) ? (questionTotalTime[i] / totalStudents) : 0.0;
-
-        // Determine difficulty label based on percentage correct
-        string difficulty;
-        if (percentCorrect >= 70.0) difficulty = "Easy";
-        else if (percentCorrect >= 30.0) difficulty = "Medium";
-        else difficulty = "Hard";
-
-        // Format and write question stats row in the report
-        report << "|    Q" << setw(2) << (i + 1) << "   | ";
-        report << setw(11) << attempted << " | ";
-        report << setw(9) << correct << " | ";
-        report << setw(7) << wrong << " | ";
-        report << setw(9) << skipped << " | ";
-        report << setw(9) << fixed << setprecision(1) << percentCorrect << "% | ";
-        report << setw(12) << fixed << setprecision(1) << avgQTime << " | ";
-        report << setw(11) << difficulty << " |\n";
-        report << "------------------------------------------------------------------------------------------------------\n";
-    }
-    report << "\n";
-
-    // Write header for answer-option distribution per question
-    report << "-------------------Answer-Option Distribution----------------------\n\n";
-    report << "| Question |  A  |  B  |  C  |  D  | NA  |\n";
-    report << "------------------------------------------\n";
-
-    // Write counts of each option chosen for every question
-    for (int i = 0; i < numQuestions; ++i) {
-        report << "|   Q" << setw(2) << (i + 1) << "    |";
-        for (int j = 0; j < 5; ++j) {
-            report << " " << setw(3) << optionCount[i][j] << " |";
+    // Retrieve the selected student's data from leaderboard
+    const RankEntry& selectedStudent = picked[0];
+    shared_ptr<const ColumnSnapshot> attempt = analysis.columns;
+    int row = selectedStudent.originalIndex;
+    if (!attempt) {
+        // Streaming mode keeps no columns: read the student's line back
+        attempt = StreamingAnalysis::readRow(analysis.examName, analysis.lineOffsets[opt - 1]);
+        if (!attempt) {
+            session.send("[!] Unable to read this attempt.");
+            return true;
         }
-        report << "\n";
-        report << "------------------------------------------\n";
+        row = 0;
     }
-    report << "\n";
-
-    // Send the accumulated report string to the client socket
-    send(sock, report.str().c_str(), report.str().size(), 0);
-    // Clear the stringstream buffer after sending
-    report.str("");
-    report.clear();
-
-    // Define a struct to hold ranking data for students
-    struct StudentRankData {
-        string id;         
-        int score;        
-        double time;       
-        int attempted;     
-        int wrong;         
-        int originalIndex;
-    };
-
-    // Vector to hold all students' rank data for leaderboard
-    vector<StudentRankData> leaderboard;
-    for (int i = 0; i < studentDataVector.size(); ++i) {
-        const auto& [id, responses] = studentDataVector[i];
-        int score = studentScores[i];
-        double totalTime = studentTimes[i];
-
-        int attempted = 0, wrong = 0;
-        // Count attempted and wrong answers for the student
-        for (int j = 0; j < responses.size(); ++j) {
-            string ans = responses[j].first;
-            if (ans != "NA") {
-                attempted++;
-                if (ans != correctAnswers[j]) wrong++;
+    const ColumnSnapshot& columns = *attempt;
+
+    // Prepare output stream to build detailed attempt report
+    ostringstream out;
+    int totalQuestions = columns.questionCount();
+    const MarkingScheme& scheme = columns.scheme;
+    int totalMarks = scheme.maxMarks(totalQuestions);
+    int score = 0, attempted = 0, wrong = 0, totalTime = 0;
+
+    // Write header for selected student's attempt details
+    out << "\n========== Attempt Details for Student ID: " << selectedStudent.id << " ==========\n\n";
+    out << "Qno. |     Status     | Marks | Selected | Correct | Time\n";
+    out << "--------------------------------------------------------\n";
+
+    // Loop through each question for detailed status and marks
+    for (int i = 0; i < totalQuestions; ++i) {
+        char answer = columns.answer(row, i);
+        string selected = (answer == '-') ? "NA" : string(1, answer);   // Student's selected answer
+        string correctAnswer(1, columns.correctAnswers[i]);
+        int timeSpent = columns.time(row, i);                            // Time spent on question
+
+        string status = "not attempted";
+        int marks = scheme.skipped;
+
+        // Determine status and marks based on student's answer correctness
+        if (selected != "NA") {
+            attempted++;
+            if (selected == correctAnswer) {
+                status = "correct";
+                marks = scheme.correct;
+            } else {
+                status = "wrong";
+                marks = scheme.wrong;
+                wrong++;
             }
         }
-
-        // Add student's ranking data to leaderboard vector
-        leaderboard.push_back({id, score, totalTime, attempted, wrong, i});
+        score += marks;
+        string mark = signedMark(marks);
+
+        totalTime += timeSpent;
+
+        // Format and write the details for each question
+        out << setw(4) << right << i + 1 << " | ";
+        out << setw(14) << left << status << " | ";
+        out << setw(5) << right << mark << " | ";
+        out << setw(8) << left << (selected == "NA" ? "-" : selected) << " | ";
+        out << setw(7) << left << correctAnswer << " | ";
+        out << timeSpent << "s\n";
     }
+    out << "----------------------------------------------------------\n";
+    // Write summary of student's overall performance
+    out << "\nTotal Marks Obtained   : " << score << " / " << totalMarks << "\n";
+    out << "Total Questions        : " << totalQuestions << "\n";
+    out << "Attempted Questions    : " << attempted << "\n";
+    out << "Wrong Answers          : " << wrong << "\n";
+    out << "Total Time Spent       : " << totalTime << "s\n";
+    out << "----------------------------------------------------------\n";
+
+    // Combine detailed attempt report with the main leaderboard report
+    string res = out.str() + analysis.view->page();
+    // Send the combined report to the client
+    session.sendParts(res);
+    return true;
+}
 
-    // Sort leaderboard by score descending, and if tie, by time ascending
-    sort(leaderboard.begin(), leaderboard.end(), [](const StudentRankData& a, const StudentRankData& b) {
-        if (a.score != b.score) return a.score > b.score;
-        return a.time < b.time;
-    });
+// Runs the answer-similarity check on an exam and sends its report
+void Server::sendCollusionReport(Session& session, const string& examName) {
+    SubmissionLog::waitForViews();
+    shared_ptr<const string> report = CollusionDetector::report(examName);
+    if (!report) {
+        session.send("[!] No student has attempted this exam yet.");
+        return;
+    }
+    session.sendParts(*report);
+}
 
-    // Write leaderboard header and column titles
-    report << "----------------------------------Leaderboard------------------------------------------\n\n";
-    report << "|Sr No.| Student ID | Total Marks | Rank |  % Marks  | Avg Time/Q | Attempted | Wrong |\n";
-    report << "---------------------------------------------------------------------------------------\n";
-
-    int rank = 1, srno = 1;
-    int totalMarks = correctAnswers.size() * 4;
-
-    // Iterate over each student in leaderboard and write their ranking info
-    for (const auto& s : leaderboard) {
-        double percentMarks = (100.0 * s.score) / totalMarks;
-        double avgTimePerQ = s.time / correctAnswers.size();
-
-        report << "| " << setw(5) << left << srno++ << "|";
-        report << setw(11) << left << s.id << " | ";
-        report << setw(6) << right << s.score << " / " << totalMarks << " | ";
-        report << setw(4) << right << rank++ << " | ";
-        report << setw(8) << fixed << setprecision(1) << percentMarks << "% | ";
-        report << setw(8) << fixed << setprecision(1) << avgTimePerQ << " s | ";
-        report << setw(9) << right << s.attempted << " | ";
-        report << setw(5) << right << s.wrong << " |\n";
-        report << "---------------------------------------------------------------------------------------\n";
+// Shows an instructor the current answer key of an exam, ten questions per line
+bool Server::sendAnswerKey(Session& session, const string& examName) {
+    vector<char> key;
+    if (!Regrader::loadKey(examName, key)) {
+        session.send("[!] The answer key of this exam could not be read.");
+        return false;
     }
+    ostringstream out;
+    out << "Current answer key of '" << examName << "' (" << key.size() << " questions):\n";
+    for (size_t q = 0; q < key.size(); q += 10) {
+        string range = "Q" + to_string(q + 1) + "-" + to_string(min(key.size(), q + 10));
+        out << "  " << setw(9) << left << range << ": ";
+        for (size_t i = q; i < min(key.size(), q + 10); ++i) out << key[i] << " ";
+        out << "\n";
+    }
+    session.send(out.str());
+    return true;
+}
 
-    report << "\n";
-    sleep(1); // Pause for 1 second before sending leaderboard
-    // Send leaderboard report to client socket
-    send(sock, report.str().c_str(), report.str().size(), 0);
+/**
+ * Replaces an exam's answer key with the one the instructor typed and re-scores
+ * every stored attempt with it.
+ *
+ * @param session The instructor's session.
+ * @param examName The name of the exam.
+ * @param keyText The corrected key, one letter per question.
+ */
+void Server::regradeExam(Session& session, const string& examName, const string& keyText) {
+    vector<char> current, key;
+    string error;
+    if (!Regrader::loadKey(examName, current)) {
+        session.send("[!] The answer key of this exam could not be read.");
+        return;
+    }
+    RegradeResult result;
+    if (!Regrader::parseKey(keyText, current.size(), key, error) || !Regrader::run(examName, key, result, error)) {
+        session.send(error);
+        return;
+    }
 
-    // If this is a student client, return after sending report
-    if(isStudent) return;
+    ostringstream out;
+    out << "[✔] Re-graded '" << examName << "': " << result.attempts << " attempts of " << result.students
+        << " students in " << fixed << setprecision(1) << result.millis << " ms (" << result.filesRewritten << " files rewritten).\n";
+    out << "Corrected answers:";
+    for (int q : result.changedQuestions) out << " Q" << q + 1 << " " << result.oldKey[q] << " -> " << key[q] << ";";
+    out << "\n";
+    session.send(out.str());
+    cout << "[✔] Answer key of '" << examName << "' corrected by " << session.username << "; "
+         << result.attempts << " attempts re-graded.\n";
+}
 
-    // Server-side loop to allow querying individual student's attempt details
-    while (true) {
-        char buffer[10];
-        // Receive input option from client (index to view student details)
-        int recvBytes = recv(sock, buffer, sizeof(buffer), 0);
-        if (recvBytes <= 0) return; // If connection closed or error, exit
-
-        // Convert received buffer to integer option
-        int opt = atoi(buffer);
-        // Validate option; if invalid or out of range, exit loop
-        if (opt == 0 || opt < 1 || opt > leaderboard.size()) return;
-
-        // Retrieve the selected student's data from leaderboard
-        const auto& selectedStudent = leaderboard[opt - 1];
-        int idxInVector = selectedStudent.originalIndex;
-        const auto& selectedResponses = studentDataVector[idxInVector].second;
-
-        // Prepare output stream to build detailed attempt report
-        ostringstream out;
-        int totalQuestions = correctAnswers.size();
-        int score = 0, attempted = 0, wrong = 0, totalTime = 0;
-
-        // Write header for selected student's attempt details
-        out << "\n========== Attempt Details for Student ID: " << selectedStudent.id << " ==========\n\n";
-        out << "Qno. |     Status     | Marks | Selected | Correct | Time\n";
-        out << "--------------------------------------------------------\n";
-
-        // Loop through each question for detailed status and marks
-        for (int i = 0; i < totalQuestions; ++i) {
-            string selected = selectedResponses[i].first;   // Student's selected answer
-            int timeSpent = selectedResponses[i].second;    // Time spent on question
-
-            string status = "not attempted";
-            string mark = "0";
-
-            // Determine status and marks based on student's answer correctness
-            if (selected != "NA") {
-                attempted++;
-                if (selected == correctAnswers[i]) {
-                    status = "correct";
-                    mark = "+4";
-                    score += 4;
-                } else {
-                    status = "wrong";
-                    mark = "-1";
-                    score -= 1;
-                    wrong++;
-                }
-            }
+// Parses one integer of an answer sheet record and the separator after it
+static bool parseField(const char*& pos, const char* end, int& value, char separator) {
+    from_chars_result result = from_chars(pos, end, value);
+    if (result.ec != errc() || result.ptr == end || *result.ptr != separator) return false;
+    pos = result.ptr + 1;
+    return true;
+}
 
-            totalTime += timeSpent;
+/**
+ * Parses a submitted answer sheet, "ANSWERS\n" followed by one "<question>,<option>,<seconds>"
+ * line per question, into a submission whose answers and times are already sized to the
+ * exam's key. A single pass with from_chars, allocating nothing.
+ *
+ * @param data The sheet as received.
+ * @param submission Receives the chosen option (-1 if skipped) and time of each question.
+ * @param error Receives why the sheet was rejected.
+ * @param line Receives the 1-based line of the sheet at fault.
+ * @return False if a line is malformed or out of range for the exam.
+ */
+static bool parseAnswerSheet(const string& data, Submission& submission, const char*& error, int& line) {
+    const char* pos = data.data() + 7;         // past "ANSWERS"
+    const char* end = data.data() + data.size();
+    int questions = submission.answers.size();
+    line = 1;
+    while (pos < end) {
+        if (*pos == '\r') ++pos;
+        if (pos == end || *pos != '\n') {
+            error = "expected a line break";
+            return false;
+        }
+        ++pos;
+        ++line;
+        if (pos == end) break;
 
-            // Format and write the details for each question
-            out << setw(4) << right << i + 1 << " | ";
-            out << setw(14) << left << status << " | ";
-            out << setw(5) << right << mark << " | ";
-            out << setw(8) << left << (selected == "NA" ? "-" : selected) << " | ";
-            out << setw(7) << left << correctAnswers[i] << " | ";
-            out << timeSpent << "s\n";
+        int question, option, seconds;
+        if (!parseField(pos, end, question, ',') || !parseField(pos, end, option, ',')) {
+            error = "expected <question>,<option>,<seconds>";
+            return false;
+        }
+        from_chars_result result = from_chars(pos, end, seconds);
+        if (result.ec != errc()) {
+            error = "expected <question>,<option>,<seconds>";
+            return false;
+        }
+        pos = result.ptr;
+        if (question < 0 || question >= questions) {
+            error = "question number out of range";
+            return false;
+        }
+        if (option < -1 || option > 3 || seconds < 0) {
+            error = "option or time out of range";
+            return false;
         }
-        out << "----------------------------------------------------------\n";
-        // Write summary of student's overall performance
-        out << "\nTotal Marks Obtained   : " << score << " / " << totalMarks << "\n";
-        out << "Total Questions        : " << totalQuestions << "\n";
-        out << "Attempted Questions    : " << attempted << "\n";
-        out << "Wrong Answers          : " << wrong << "\n";
-        out << "Total Time Spent       : " << totalTime << "s\n";
-        out << "----------------------------------------------------------\n";
-
-        // Combine detailed attempt report with the main leaderboard report
-        string res = out.str() + report.str();
-        // Send the combined report to the client
-        send(sock, res.c_str(), res.size(), 0);
+        submission.answers[question] = option;
+        submission.times[question] = seconds;
     }
+    return true;
 }
 
-void Server::receiveStudentAnswers(int sock, const string& examName) {
-    char buffer[256] = {0};
-
-    // Receive raw answer data from the client
-    int bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
-    if (bytesReceived <= 0) {
-        cerr << "Error: Failed to receive answers from client.\n";
+void Server::receiveStudentAnswers(Session& session, const string& examName, const string& data) {
+    // Verify the received data starts with "ANSWERS"
+    if (data.compare(0, 7, "ANSWERS") != 0) {
+        session.send("y");
+        cerr << "Invalid data received format.\n";
         return;
     }
 
-    // Send acknowledgment to client
-    char ack = 'y';
-    send(sock, &ack, 1, 0);
+    Submission submission;
+    submission.studentId = session.username;
+    submission.examName = examName;
 
-    string data(buffer);
+    // Held until the submission is logged, so a re-grade never misses one scored with the old key
+    pthread_rwlock_rdlock(&Regrader::keyLock);
 
-    // Verify the received data starts with "ANSWERS"
-    if (data.substr(0, 7) != "ANSWERS") {
-        cerr << "Invalid data received format.\n";
+    // The answer key comes from memory: grading does no file I/O
+    shared_ptr<const PackedKey> key = AnswerKeyCache::get(examName);
+    if (!key) {
+        // No acknowledgement: the client keeps its answer sheet and resubmits on next login
+        pthread_rwlock_unlock(&Regrader::keyLock);
+        cerr << "[✖] No answer key to grade " << submission.studentId << " on '" << examName << "'.\n";
+        session.close();
+        return;
+    }
+    submission.correct = key->indices();
+
+    int totalQuestions = submission.correct.size();
+    submission.marks.assign(totalQuestions, 0);
+    submission.times.assign(totalQuestions, 0);
+    submission.answers.assign(totalQuestions, -1);
+    const char* error;
+    int line;
+    if (!parseAnswerSheet(data, submission, error, line)) {
+        pthread_rwlock_unlock(&Regrader::keyLock);
+        cerr << "[✖] Rejected answer sheet of " << submission.studentId << " on '" << examName << "': " << error
+             << " at line " << line << ".\n";
+        session.send("y");
         return;
     }
 
-    // Get student ID associated with this socket
-    string studentId = socketToUsername[sock];
-
-    // Load correct answers from the answer key file
-    string answerFile = "../data/exams/answers_" + examName + ".txt";
-    vector<int> correctAnswers;
-    ifstream answerIn(answerFile);
-    string line;
-    while (getline(answerIn, line)) {
-        line.erase(remove_if(line.begin(), line.end(), ::isspace), line.end());
-        if (!line.empty()) 
-            correctAnswers.push_back(line[0] - 'A'); // Convert char to index
+    // Mark the whole sheet with the exam's scheme, using the kernel picked for it
+    shared_ptr<const ExamCatalog> catalog = ExamCatalog::snapshot();
+    const ExamMeta* exam = catalog->find(examName);
+    MarkingScheme scheme = exam ? exam->scheme : MarkingScheme();
+    scheme.grader()(scheme, submission.answers.data(), submission.correct.data(), submission.marks.data(), totalQuestions);
+    submission.timestamp = getCurrentDateTime();
+
+    // Claim the attempt atomically: a scheduled exam accepts one submission per student,
+    // even if two sessions of the same student submit at the same moment
+    bool firstAttempt = AttemptIndex::insert(submission.studentId, examName);
+    if (!firstAttempt && exam && exam->isScheduled()) {
+        pthread_rwlock_unlock(&Regrader::keyLock);
+        cerr << "[✖] Duplicate submission of " << submission.studentId << " on scheduled exam '" << examName << "' ignored.\n";
+        session.send("y");
+        return;
     }
-    answerIn.close();
-
-    // Prepare to parse submitted answers
-    istringstream dataStream(data.substr(8));  // Skip "ANSWERS "
-    string entry;
-    int totalQuestions = correctAnswers.size();
-    vector<int> perQuestionMarks(totalQuestions, 0);
-    vector<int> perQuestionTime(totalQuestions, 0);
-    vector<int> perQuestionAnswer(totalQuestions, -1);
-    int totalMarks = 0, totalTimeSpent = 0;
-    int attemptedCount = 0, wrongCount = 0;
-
-    const int positiveMark = 4, negativeMark = -1;
-
-    // Parse each answer line and compute marks
-    while (getline(dataStream, entry)) {
-        int qIdx, answer, timeSpent;
-        char delim;
-        istringstream entryStream(entry);
-        entryStream >> qIdx >> delim >> answer >> delim >> timeSpent;
-
-        int marks = 0;
-        if (answer != -1) {
-            attemptedCount++;
-            if (answer == correctAnswers[qIdx]) {
-                marks = positiveMark;
-            } else {
-                marks = negativeMark;
-                wrongCount++;
-            }
-        }
 
-        perQuestionMarks[qIdx] = marks;
-        perQuestionTime[qIdx] = timeSpent;
-        perQuestionAnswer[qIdx] = answer;
-        totalMarks += marks;
-        totalTimeSpent += timeSpent;
+    // Make the submission durable before acknowledging it; the text files are derived later
+    bool logged = SubmissionLog::append(submission);
+    pthread_rwlock_unlock(&Regrader::keyLock);
+    if (!logged) {
+        // No acknowledgement: the client keeps its answer sheet and resubmits on next login
+        cerr << "[✖] Could not store submission of " << submission.studentId << " on '" << examName << "'.\n";
+        if (firstAttempt) AttemptIndex::erase(submission.studentId, examName);
+        session.close();
+        return;
     }
+    session.send("y");
+
+    // Log completion in server console
+    cout << "[✔] Evaluation complete for " << submission.studentId << " on '" << examName << "'.\n";
+}
+
+/**
+ * Writes the per-student and per-exam files derived from one logged submission:
+ * the attempts list, the performance file, exam_log.txt and the exam analysis file.
+ * Runs on the submission log's view thread (or during replay at startup).
+ *
+ * @param submission The committed submission.
+ * @param writer Batches the appends and makes them durable together.
+ */
+void Server::writeSubmissionViews(const Submission& submission, ViewWriter& writer) {
+    const string& studentId = submission.studentId;
+    const string& examName = submission.examName;
+    const string& currDateTime = submission.timestamp;
+    int totalQuestions = submission.answers.size();
+    int totalMarks = submission.totalMarks();
+    int maxMarks = ExamCatalog::schemeOf(examName).maxMarks(totalQuestions);
+    string scoreFile = "../data/results/student_" + studentId + "_" + examName + "_performance.txt";
 
     // Store basic metadata about this attempt
-    string currDateTime = getCurrentDateTime();
-    string perfFile = "../data/results/student_" + studentId + "_attempts.txt";
-    ofstream perfOut(perfFile, ios::app);
+    ostringstream perfOut;
     perfOut << examName << "|";
     perfOut << currDateTime << "|";
     perfOut << totalMarks << "|";
-    perfOut << totalQuestions*4 << "|";
-    perfOut << "../data/results/student_" + studentId + "_" + examName + "_performance.txt\n";
-    perfOut.close();
+    perfOut << maxMarks << "|";
+    perfOut << scoreFile << "\n";
+    writer.append("../data/results/student_" + studentId + "_attempts.txt", perfOut.str());
 
     // Store detailed performance info
-    string scoreFile = "../data/results/student_" + studentId + "_" + examName + "_performance.txt";
-    ofstream scoreOut(scoreFile, ios::app);
+    ostringstream scoreOut;
     scoreOut << "START\n";
     scoreOut << currDateTime << "|";
     scoreOut << examName + "|";
-    scoreOut << totalMarks << "|" << totalQuestions*4 << "|";
-    scoreOut << totalQuestions << "|" << attemptedCount << "|" << wrongCount << "|";
-    scoreOut << totalTimeSpent << "\nEND\n";
+    scoreOut << totalMarks << "|" << maxMarks << "|";
+    scoreOut << totalQuestions << "|" << submission.attemptedCount() << "|" << submission.wrongCount() << "|";
+    scoreOut << submission.totalTime() << "\nEND\n";
 
     // Store per-question details
-    for (size_t i = 0; i < perQuestionMarks.size(); ++i) {
+    for (int i = 0; i < totalQuestions; ++i) {
         scoreOut << "Q" << (i + 1) << "|";
-        scoreOut << perQuestionMarks[i] << "|";
-        if (perQuestionAnswer[i] != -1) {
-            scoreOut  << static_cast<char>('A' + perQuestionAnswer[i]) << "|";
+        scoreOut << (int)submission.marks[i] << "|";
+        if (submission.answers[i] != -1) {
+            scoreOut  << static_cast<char>('A' + submission.answers[i]) << "|";
         }
         else {
             scoreOut << "NA|";
         }
-        scoreOut << perQuestionTime[i] << "s\n";
+        scoreOut << submission.times[i] << "s\n";
+    }
+    string record = scoreOut.str();
+    off_t recordOffset = writer.append(scoreFile, record);
+    if (recordOffset != -1) {
+        writer.append(PerformanceIndex::indexPathOf(scoreFile), PerformanceIndex::encode(currDateTime, recordOffset, record.size()));
     }
-    scoreOut.close();
 
-    // Log the attempt in a global attempt file (thread-safe)
-    pthread_mutex_lock(&file_mutex2);
-    string attemptFile = "../data/results/exam_log.txt";
-    ofstream attemptOut(attemptFile, ios::app);
-    attemptOut << studentId << ": " << examName << ": " << getCurrentDateTime() << "\n";
-    attemptOut.close();
-    pthread_mutex_unlock(&file_mutex2);
+    // Log the attempt in the global attempt file
+    writer.append("../data/results/exam_log.txt", studentId + ": " + examName + ": " + currDateTime + "\n");
 
     // Append to the exam analysis file (or create if not exists)
     string analysisFile = "../data/results/exam_" + examName + "_analysis.txt";
-    pthread_mutex_lock(&file_mutex3);
-    ifstream infile(analysisFile);
-    bool fileExists = infile.good();
-    infile.close();
-
-    ofstream analysisOut;
-    if (!fileExists) {
+    ostringstream analysisOut;
+    if (!writer.exists(analysisFile)) {
         // Write the answer key on the first line
-        analysisOut.open(analysisFile, ios::out);
-        for (size_t i = 0; i < correctAnswers.size(); ++i) {
-            analysisOut << static_cast<char>('A' + correctAnswers[i]) << " ";
+        for (size_t i = 0; i < submission.correct.size(); ++i) {
+            analysisOut << static_cast<char>('A' + submission.correct[i]) << " ";
         }
         analysisOut << "\n";
-    } else {
-        analysisOut.open(analysisFile, ios::app);
     }
 
     // Append the student's answers and time spent
     analysisOut << studentId;
-    for (size_t i = 0; i < perQuestionAnswer.size(); ++i) {
-        if (perQuestionAnswer[i] == -1) {
-            analysisOut << " - " << perQuestionTime[i];
+    for (int i = 0; i < totalQuestions; ++i) {
+        if (submission.answers[i] == -1) {
+            analysisOut << " - " << submission.times[i];
             continue;
         }
-        analysisOut << " " << static_cast<char>('A' + perQuestionAnswer[i]) << " " << perQuestionTime[i];
+        analysisOut << " " << static_cast<char>('A' + submission.answers[i]) << " " << submission.times[i];
     }
     analysisOut << "\n";
-    analysisOut.close();
-    pthread_mutex_unlock(&file_mutex3);
+    writer.append(analysisFile, analysisOut.str());
+}
 
-    // Log completion in server console
-    cout << "[✔] Evaluation complete for " << studentId << " on '" << examName << "'.\n";
+// Runs once a batch of submissions is on disk: folds the new analysis lines into each exam's running totals and rank index
+void Server::onViewsWritten(const deque<Submission>& batch) {
+    set<string> examNames;
+    for (const Submission& submission : batch) examNames.insert(submission.examName);
+    // Streaming analysis reads the analysis files when asked; there is nothing to keep up to date
+    if (StreamingAnalysis::enabled()) return;
+    for (const string& examName : examNames) {
+        AnalysisColumns::refresh(examName);
+        ExamAggregate::refresh(examName);
+        Leaderboard::refresh(examName);
+    }
+    ExamAggregate::persistDirty();
 }
 
 string Server::getCurrentDateTime() {
@@ -564,116 +606,46 @@ string Server::getCurrentDateTime() {
     return oss.str();
 }
 
-void Server::handleStudentExamRequest(int sock, ExamManager exam) {
-    char buffer[1024] = {0};
-
-    // Receive the exam number selected by the student
-    int bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
-    if (bytesReceived <= 0) {
-        cerr << "Error: Failed to receive exam selection from client.\n";
-        return;
-    }
-
-    int examNumber = atoi(buffer);
-    if (examNumber == 0) return;  // Invalid selection
+bool Server::handleStudentExamRequest(Session& session, int examNumber) {
+    if (examNumber == 0) return false;  // Invalid selection
+    shared_ptr<const ExamCatalog> exams = ExamCatalog::snapshot();
+    if (abs(examNumber) > (int)exams->size()) return false;
 
     // Check if exam file already exists on the client side
     bool fileExist = false;
     if (examNumber < 0) fileExist = true;
 
-    string selectedExamName;
-    istringstream iss(exams[abs(examNumber) - 1]);
-    string line;
-
-    // Extract the selected exam's name
-    while (getline(iss, line)) {
-        if (line.find("Exam Name:") != string::npos) {
-            selectedExamName = line.substr(line.find(":") + 2);
-            break;
-        }
-    }
+    string selectedExamName = exams->all()[abs(examNumber) - 1]->name;
+    session.selectedExam = selectedExamName;
 
     // Send the exam questions if not already present on client
     if (!fileExist) {
-        exam.sendExamQuestions(sock, selectedExamName);
+        ExamManager exam;
+        exam.sendExamQuestions(session, selectedExamName);
         cout << "[+] question paper send successfully !\n";
     } else {
         cout << "[+] file already exist on client side !\n";
     }
+    return true;
+}
 
-    memset(buffer, 0, sizeof(buffer));
-
-    // Wait for student to confirm whether they want to proceed
-    sleep(2);
-    recv(sock, buffer, sizeof(buffer), 0);
-    string response(buffer);
-
-    if (response == "y" || response == "Y") {
-        string studentId = socketToUsername[sock];
-
-        // Receive exam type: 's' for scheduled, 'p' for practice
-        char typeBuf[32] = {0};
-        recv(sock, typeBuf, sizeof(typeBuf), 0);
-        string examTypeBuffer(typeBuf);
-        string examName = selectedExamName;
-        bool alreadyAttempted = false;
-
-        // For scheduled exams, check if the student has already attempted it
-        if (examTypeBuffer == "s") {
-            string perfFile = "../data/results/student_" + studentId + "_attempts.txt";
-            ifstream infile(perfFile);
-            if (infile.is_open()) {
-                string line;
-                while (getline(infile, line)) {
-                    size_t pos = line.find('|');
-                    if (pos != string::npos) {
-                        string attemptedExam = line.substr(0, pos);
-                        // Trim whitespace
-                        attemptedExam.erase(0, attemptedExam.find_first_not_of(" \t\n\r"));
-                        attemptedExam.erase(attemptedExam.find_last_not_of(" \t\n\r") + 1);
-
-                        if (attemptedExam == examName) {
-                            alreadyAttempted = true;
-                            break;
-                        }
-                    }
-                }
-                infile.close();
-            }
-
-            // Notify client if already attempted
-            if (alreadyAttempted) {
-                char message = 'y';
-                send(sock, &message, 1, 0);
-                sleep(1);
-                return;
-            } else {
-                char message = 'n';
-                send(sock, &message, 1, 0);
-                sleep(1);
-            }
-        }
-
-        // Allow some time before receiving answers
-        sleep(3);
-
-        // Receive and evaluate student's answers
-        receiveStudentAnswers(sock, examName);
-    }
+// For scheduled exams, check if the student has already attempted it
+bool Server::hasAttempted(const string& studentId, const string& examName) {
+    return AttemptIndex::contains(studentId, examName);
 }
 
-bool Server::handle_authentication(int sock, const string& command, const string& user_type, const string& username, const string& password) {
+bool Server::handle_authentication(Session& session, const string& command, const string& user_type, const string& username, const string& password) {
     // Handle login request
     if (command == "LOGIN") {
         // Verify user credentials
         if (AuthManager::authenticate_user(username, password, user_type)) {
             // Inform client of successful login
-            send(sock, "AUTHENTICATION_SUCCESS", strlen("AUTHENTICATION_SUCCESS"), 0);
+            session.send("AUTHENTICATION_SUCCESS");
             cout << username << " logged in successfully as " << user_type << endl;
             return true;
         } else {
             // Inform client of failed login
-            send(sock, "AUTHENTICATION_FAILED", strlen("AUTHENTICATION_FAILED"), 0);
+            session.send("AUTHENTICATION_FAILED");
             cerr << "Authentication failed for " << username << endl;
             return false;
         }
@@ -684,12 +656,12 @@ bool Server::handle_authentication(int sock, const string& command, const string
         // Attempt to register the new user
         if (AuthManager::register_user(username, password, user_type)) {
             // Inform client of successful registration
-            send(sock, "REGISTER_SUCCESS", strlen("REGISTER_SUCCESS"), 0);
+            session.send("REGISTER_SUCCESS");
             cout << username << " registered successfully as " << user_type << endl;
             return true;
         } else {
             // Inform client of failed registration
-            send(sock, "REGISTER_FAILED", strlen("REGISTER_FAILED"), 0);
+            session.send("REGISTER_FAILED");
             cerr << "Registration failed for " << username << endl;
             return false;
         }
@@ -699,19 +671,23 @@ bool Server::handle_authentication(int sock, const string& command, const string
     return false;
 }
 
-void Server::handleViewPerformance(int clientSock, const string& studentId) {
+bool Server::loadAttempts(Session& session) {
+    // Results are derived from the submission log; make sure they include every committed submission
+    SubmissionLog::waitForViews();
+
     // Build the filename storing student's exam attempts
-    string filename = "../data/results/student_" + studentId + "_attempts.txt";
+    string filename = "../data/results/student_" + session.username + "_attempts.txt";
     ifstream file(filename);
 
     if (!file.is_open()) {
         string err = "[!] No exam data found for student.";
-        send(clientSock, err.c_str(), err.size() + 1, 0);
-        return;
+        session.send(err);
+        return false;
     }
 
     // Map exam name to vector of attempts (timestamp, marks, performance file path)
-    map<string, vector<tuple<string, string, string>>> examMap;
+    auto& examMap = session.examMap;
+    examMap.clear();
     string line;
 
     // Parse each line in attempts file to fill examMap
@@ -728,505 +704,498 @@ void Server::handleViewPerformance(int clientSock, const string& studentId) {
         examMap[examName].emplace_back(timestamp, marksObtained, totalMarks + "|" + perfPath);
     }
     file.close();
+    return true;
+}
 
-    while (true) {
-        // Build dashboard with list of attempted exams and number of attempts
-        string dashboard = "\n========== Attempted Exams ==========\n\n";
-        vector<string> examNames;
-        int index = 1;
-        for (auto& pair : examMap) {
-            dashboard += "[" + to_string(index++) + "] " + pair.first + " (" + to_string(pair.second.size()) + " attempts)\n";
-            examNames.push_back(pair.first);
-        }
-        dashboard += "\n[0] Back to Main Menu\n--------------------------------------\n";
-        dashboard += "select from above: ";
+// Sends the list of attempted exams
+void Server::sendDashboard(Session& session) {
+    // Build dashboard with list of attempted exams and number of attempts
+    string dashboard = "\n========== Attempted Exams ==========\n\n";
+    session.examNames.clear();
+    int index = 1;
+    for (auto& pair : session.examMap) {
+        dashboard += "[" + to_string(index++) + "] " + pair.first + " (" + to_string(pair.second.size()) + " attempts)\n";
+        session.examNames.push_back(pair.first);
+    }
+    dashboard += "\n[0] Back to Main Menu\n--------------------------------------\n";
+    dashboard += "select from above: ";
 
-        send(clientSock, dashboard.c_str(), dashboard.size() + 1, 0);
+    session.send(dashboard);
+}
 
-        // Receive exam selection from client
-        char examChoiceBuf[10] = {0};
-        int bytesReceived = recv(clientSock, examChoiceBuf, sizeof(examChoiceBuf), 0);
-        if (bytesReceived <= 0) {
-            cerr << "Error: Failed to receive exam selection from client.\n";
-            return;
-        }
-        int examChoice = atoi(examChoiceBuf);
-        if (examChoice == 0) break;
-        if (examChoice < 1 || examChoice > examNames.size()){
-            string mesg = "[!] Invalid option! please select a valid exam.";
-            send(clientSock, mesg.c_str(), mesg.size(), 0);
-            usleep(1200000);
-            continue;
-        }
+// Sends the list of attempts for the exam selected on the dashboard
+void Server::sendAttemptList(Session& session) {
+    const string& selectedExam = session.selectedExam;
+    auto& attempts = session.examMap[selectedExam];
 
-        string selectedExam = examNames[examChoice - 1];
-        auto& attempts = examMap[selectedExam];
+    // Build list of attempts for selected exam
+    string attemptList = "\n=============="+selectedExam+" attempts==============\n\n";
+    for (int i = 0; i < attempts.size(); ++i) {
+        string timestamp = get<0>(attempts[i]);
+        string marksObtained = get<1>(attempts[i]);
+        string totalMarks = get<2>(attempts[i]).substr(0, get<2>(attempts[i]).find('|'));
 
-        // Build list of attempts for selected exam
-        string attemptList = "\n=============="+selectedExam+" attempts==============\n\n";
-        for (int i = 0; i < attempts.size(); ++i) {
-            string timestamp = get<0>(attempts[i]);
-            string marksObtained = get<1>(attempts[i]);
-            string totalMarks = get<2>(attempts[i]).substr(0, get<2>(attempts[i]).find('|'));
+        attemptList += "[" + to_string(i + 1) + "] Attempt on: " + timestamp +
+                        " Marks Obtained: " + marksObtained + " / " + totalMarks + "\n";
+    }
+    attemptList += "\n[0] Back to Exam List\n";
+    attemptList += "--------------------------------------------------------\n";
+    attemptList += "Select an attempt to view details: ";
 
-            attemptList += "[" + to_string(i + 1) + "] Attempt on: " + timestamp +
-                            " Marks Obtained: " + marksObtained + " / " + totalMarks + "\n";
-        }
-        attemptList += "\n[0] Back to Exam List\n";
-        attemptList += "--------------------------------------------------------\n";
-        attemptList += "Select an attempt to view details: ";
-
-        send(clientSock, attemptList.c_str(), attemptList.size() + 1, 0);
-        
-        // Receive attempt selection
-        char attemptChoiceBuf[10] = {0};
-        recv(clientSock, attemptChoiceBuf, sizeof(attemptChoiceBuf), 0);
-        int attemptChoice = atoi(attemptChoiceBuf);
-
-        if (attemptChoice == 0) continue;
-        if (attemptChoice < 1 || attemptChoice > attempts.size()){
-            string mesg = "[!] Invalid option! please select a valid attempt.";
-            send(clientSock, mesg.c_str(), mesg.size(), 0);
-            usleep(1200000);
-            continue;
-        } 
-
-        string selectedTimestamp = get<0>(attempts[attemptChoice - 1]);
-        string perfFilePath = get<2>(attempts[attemptChoice - 1]);
-        perfFilePath = perfFilePath.substr(perfFilePath.find('|') + 1);
-
-        ifstream perfFile(perfFilePath);
-        if (!perfFile.is_open()) {
-            string error = "Error: Performance file not found.\n";
-            attemptList += "\n[0] Back to Exam List\n";
-            error += "--------------------------------------------------------\n";
-            error += "select from above: ";
-            send(clientSock, error.c_str(), error.size() + 1, 0);
-            continue;
+    session.send(attemptList);
+}
+
+AttemptView Server::sendAttemptDetails(Session& session, int attemptChoice) {
+    auto& attempts = session.examMap[session.selectedExam];
+
+    string selectedTimestamp = get<0>(attempts[attemptChoice - 1]);
+    string perfFilePath = get<2>(attempts[attemptChoice - 1]);
+    perfFilePath = perfFilePath.substr(perfFilePath.find('|') + 1);
+
+    if (access(perfFilePath.c_str(), F_OK) != 0) {
+        string error = "Error: Performance file not found.\n";
+        error += "--------------------------------------------------------\n";
+        error += "select from above: ";
+        session.send(error);
+        return AttemptView::FILE_MISSING;
+    }
+
+    // Fetch just this attempt's record through the performance file's offset index
+    string record;
+    if (!PerformanceIndex::readAttempt(perfFilePath, attemptChoice - 1, selectedTimestamp, record)) {
+        // No record of this attempt in the file
+        session.send("");
+        return AttemptView::SHOWN;
+    }
+
+    istringstream perfFile(record);
+    string line, summaryLine;
+    getline(perfFile, line);    // START
+    getline(perfFile, summaryLine);
+
+    stringstream ss(summaryLine);
+    string timestamp, examName, marksObtained, totalMarks, totalQuestions, attempted, wrong, totalTime;
+    getline(ss, timestamp, '|');
+
+    // Parse summary line details
+    getline(ss, examName, '|');
+    getline(ss, marksObtained, '|');
+    getline(ss, totalMarks, '|');
+    getline(ss, totalQuestions, '|');
+    getline(ss, attempted, '|');
+    getline(ss, wrong, '|');
+    getline(ss, totalTime, '|');
+
+    // Check if exam is ongoing (for scheduled exams) and block viewing if so
+    shared_ptr<const ExamCatalog> exams = ExamCatalog::snapshot();
+    const ExamMeta* exam = exams->find(examName);
+    if (exam && exam->isRunning(time(nullptr))) {
+        string msg = "Exam is still going on.";
+        session.send(msg);
+        return AttemptView::EXAM_RUNNING;
+    }
+    
+    string formatted = "\n========== Attempt Details ==========\n\n";
+    formatted += "Exam: " + examName + "\n";
+    formatted += "Attempt Date: " + timestamp + "\n\n";
+    formatted += "Total Marks Obtained   : " + marksObtained + " / " + totalMarks + "\n";
+    formatted += "Total Questions        : " + totalQuestions + "\n";
+    formatted += "Attempted Questions    : " + attempted + "\n";
+    formatted += "Wrong Answers          : " + wrong + "\n";
+    formatted += "Total Time Spent       : " + totalTime + "s\n\n";
+
+    shared_ptr<const PackedKey> key = AnswerKeyCache::get(examName);
+
+    // Prepare question-wise summary table
+    formatted += "Qno.  | Status  | Marks | Selected | Correct | Time\n";
+    formatted += "--------------------------------------------------------\n";
+    // Skip lines until the performance answers section
+    while (getline(perfFile, line) && line != "END");
+    int qNum = 1;
+    while (getline(perfFile, line)) {
+        if (line == "START") break;
+
+        stringstream qss(line);
+        string markStr, optStr, timeStr;
+        qss.ignore(numeric_limits<streamsize>::max(), '|');    // question number
+        getline(qss, markStr, '|');
+        getline(qss, optStr, '|');
+        getline(qss, timeStr, 's');
+
+        string status, markDisplay, selected, correct;
+        int mark = stoi(markStr);
+        selected = (optStr == "NA") ? "-" : optStr;
+        correct = (key && (size_t)qNum <= key->questions) ? string(1, key->letter(qNum - 1)) : "?";
+
+        if (optStr == "NA") {
+            status = "NA";
+            markDisplay = mark != 0 ? signedMark(mark) : "-";
+        } else {
+            // Marks depend on the exam's scheme, so compare with the key instead
+            status = (optStr == correct) ? "correct" : "wrong";
+            markDisplay = signedMark(mark);
         }
 
-        string formatted, line, examName;
-        // Read performance file to find matching attempt's detailed record
-        while (getline(perfFile, line)) {
-            if (line == "START") {
-                string summaryLine;
-                if (!getline(perfFile, summaryLine)) break;
-
-                stringstream ss(summaryLine);
-                string timestamp, marksObtained, totalMarks, totalQuestions, attempted, wrong, totalTime;
-                getline(ss, timestamp, '|');
-                if (timestamp != selectedTimestamp) {
-                    // Skip to next START if timestamp does not match
-                    while (getline(perfFile, line) && line != "START");
-                    if (line == "START") {
-                        perfFile.seekg(-line.length()-1, ios::cur); 
-                    }
-                    continue;
-                }
-
-                // Parse summary line details
-                getline(ss, examName, '|');
-                getline(ss, marksObtained, '|');
-                getline(ss, totalMarks, '|');
-                getline(ss, totalQuestions, '|');
-                getline(ss, attempted, '|');
-                getline(ss, wrong, '|');
-                getline(ss, totalTime, '|');
-
-                // Check if exam is ongoing (for scheduled exams) and block viewing if so
-                for (const auto& exam : exams) {
-                    istringstream iss(exam);
-                    string exam_name, exam_type, start_time, duration, line;
-                    bool include_exam = false;
-                    while (getline(iss, line)) {
-                        if (line.find("Exam Name:") != string::npos) {
-                            exam_name = line.substr(line.find(":") + 2);
-                            if (exam_name == examName) 
-                                include_exam = true;
-                        }
-                        if (line.find("Duration (minutes):") != string::npos)
-                            duration = line.substr(line.find(":") + 2);
-                        if (line.find("Exam type:") != string::npos) 
-                            exam_type = line.substr(line.find(":") + 2);
-                        if (line.find("Start Time:") != string::npos) 
-                            start_time = line.substr(line.find(":") + 2);
-                    }
-                    if (include_exam) {
-                        if(exam_type == "q") break;
-                        tm tm = {};
-                        istringstream ss(start_time);
-                        int dur = stoi(duration);
-                    
-                        ss >> get_time(&tm, "%Y-%m-%d %H:%M:%S");
-                        if (ss.fail()) {
-                            std::cerr << "Parse failed\n";
-                            break;
-                        }
-                        time_t time_value = std::mktime(&tm);
-                        time_t later = time_value + dur*60;
-                        time_t current_time = std::time(nullptr);
-                        if(current_time < later){
-                            string msg = "Exam is still going on.";
-                            send(clientSock, msg.c_str(), msg.size(), 0);
-                            sleep(1);
-                            return;
-                        }
-                        break;
-                    }
-                }
-                
-                formatted = "\n========== Attempt Details ==========\n\n";
-                formatted += "Exam: " + examName + "\n";
-                formatted += "Attempt Date: " + timestamp + "\n\n";
-                formatted += "Total Marks Obtained   : " + marksObtained + " / " + totalMarks + "\n";
-                formatted += "Total Questions        : " + totalQuestions + "\n";
-                formatted += "Attempted Questions    : " + attempted + "\n";
-                formatted += "Wrong Answers          : " + wrong + "\n";
-                formatted += "Total Time Spent       : " + totalTime + "s\n\n";
-
-                string ansFilePath = "../data/exams/answers_" + examName + ".txt";
-                ifstream ansFile(ansFilePath);
-                vector<string> answers;
-                if (ansFile.is_open()) {
-                    string ansLine;
-                    while (getline(ansFile, ansLine)) {
-                        answers.push_back(ansLine);
-                    }
-                    ansFile.close();
-                }
-
-                // Prepare question-wise summary table
-                formatted += "Qno.  | Status  | Marks | Selected | Correct | Time\n";
-                formatted += "--------------------------------------------------------\n";
-                // Skip lines until the performance answers section
-                while (getline(perfFile, line) && line != "END");
-                int qNum = 1;
-                while (getline(perfFile, line)) {
-                    if (line == "START") break;
-
-                    stringstream qss(line);
-                    string questionStr, markStr, optStr, timeStr;
-                    getline(qss, questionStr, '|');
-                    getline(qss, markStr, '|');
-                    getline(qss, optStr, '|');
-                    getline(qss, timeStr, 's');
-
-                    string status, markDisplay, selected, correct;
-                    int mark = stoi(markStr);
-                    selected = (optStr == "NA") ? "-" : optStr;
-                    correct = (qNum - 1 < answers.size()) ? answers[qNum - 1] : "?";
-
-                    if (optStr == "NA") {
-                        status = "NA";
-                        markDisplay = "-";
-                    } else {
-                        status = (mark == -1) ? "wrong" : "correct";
-                        markDisplay = (mark > 0 ? "+" : "") + markStr;
-                    }
-
-                    stringstream row;
-                    row << setw(5)  << qNum << " | "
-                        << setw(7) << status << " | "
-                        << setw(5)  << markDisplay << " | "
-                        << setw(8)  << selected << " | "
-                        << setw(7)  << correct << " | "
-                        << timeStr << "s\n";
-                    formatted += row.str();
-
-                    qNum++;
-                }
-                formatted += "\n--------------------------------------------------------\n";
-                perfFile.close();
-                send(clientSock, formatted.c_str(), formatted.size() + 1, 0);
-
-                // Send full question paper for this exam
-                string examFilePath = "../data/exams/questions_" + examName + ".txt";
-                ifstream examFile(examFilePath);
-                if (examFile.is_open()) {
-                    formatted = examName +"\n";
-                    string qLine;
-                    int qNum = 1;
-                    while (getline(examFile, qLine)) {
-                        if (qLine.empty()) {
-                            formatted += "\n";
-                            continue;
-                        }
-                        if (qLine[0] == ' ') {
-                            formatted += "Q" + to_string(qNum++) + "." + qLine + "\n";
-                        } else {
-                            formatted += qLine + "\n";
-                        }
-                    }
-                    formatted += "--------------------------END OF QUESTION PAPER------------------------------\n";
-                    examFile.close();
-                }
-                break;
+        stringstream row;
+        row << setw(5)  << qNum << " | "
+            << setw(7) << status << " | "
+            << setw(5)  << markDisplay << " | "
+            << setw(8)  << selected << " | "
+            << setw(7)  << correct << " | "
+            << timeStr << "s\n";
+        formatted += row.str();
+
+        qNum++;
+    }
+    formatted += "\n--------------------------------------------------------\n";
+    session.send(formatted);
+
+    // Send full question paper for this exam
+    string examFilePath = "../data/exams/questions_" + examName + ".txt";
+    ifstream examFile(examFilePath);
+    if (examFile.is_open()) {
+        formatted = examName +"\n";
+        string qLine;
+        int qNum = 1;
+        while (getline(examFile, qLine)) {
+            if (qLine.empty()) {
+                formatted += "\n";
+                continue;
+            }
+            if (qLine[0] == ' ') {
+                formatted += "Q" + to_string(qNum++) + "." + qLine + "\n";
+            } else {
+                formatted += qLine + "\n";
             }
         }
-        sleep(1);
-        send(clientSock, formatted.c_str(), formatted.size() + 1, 0);
-       
-        char leaderboardbuf[10] = {0};
-        bytesReceived = recv(clientSock, leaderboardbuf, sizeof(leaderboardbuf), 0);
-        if (bytesReceived <= 0) {
-            cerr << "Error: Failed to receive exam selection from client.\n";
-            return;
-        }
-        int leaderboard = atoi(leaderboardbuf);
-        if(leaderboard==0 || leaderboard!=1) continue;
-
-        analyzeExam(selectedExam, clientSock, true);
-        break;
+        formatted += "--------------------------END OF QUESTION PAPER------------------------------\n";
+        examFile.close();
     }
+    session.send(formatted);
+    return AttemptView::SHOWN;
 }
 
-void Server::sendAvailableExams(int sock, const string& username, vector<string>& examNames) {
+void Server::sendAvailableExams(Session& session, const string& username, vector<string>& examNames) {
     string all_exams;
     int qno = 1;
     examNames.clear();
 
-    for (const auto& exam : exams) {
-        istringstream iss(exam);
-        ostringstream filteredExam;
-        string line;
-        string instructor_name;
-        string exam_name, exam_type;
-        bool include_exam = false;
-
-        while (getline(iss, line)) {
-            if (line.find("Instructor:") != string::npos) {
-                instructor_name = line.substr(line.find(":") + 2);
-                if (instructor_name == username) {
-                    include_exam = true;
-                }
-            }
-
-            if (line.find("Exam Name:") != string::npos)
-                exam_name = line.substr(line.find(":") + 2);
-            if (line.find("Exam type:") != string::npos){
-                exam_type = line.substr(line.find(":") + 2);
-                if(exam_type == "g") exam_type = "Exam type: Scheduled Test";
-                else exam_type = "Exam type: Practice Test";
-                filteredExam << exam_type << " | ";
-                continue;
-            }
-            if (line.find("Instructor:") != std::string::npos) continue;
-            filteredExam << line << " | ";
-        }
-        if (include_exam) {
-            examNames.push_back(exam_name);
-            all_exams += to_string(qno++) + ". " + filteredExam.str() + "\n";
-        }
+    shared_ptr<const ExamCatalog> exams = ExamCatalog::snapshot();
+    for (const ExamMeta* exam : exams->byInstructor(username)) {
+        examNames.push_back(exam->name);
+        all_exams += to_string(qno++) + ". " + exam->instructorListing() + "\n";
     }
 
     if (all_exams.empty()) {
         all_exams = "[!] You have not uploaded any exam.";
     }
 
-    all_exams += "\0";
-    send(sock, all_exams.c_str(), all_exams.size(), 0);
+    session.send(all_exams);
 }
 
-void* Server::handle_client(void* client_socket) {
-    
-    int sock = *(int*)client_socket;
-    char buffer[1024] = {0};
-    string command, user_type, username, password;
-    int attempts=0;
+// Sends the list of available exams to a student; returns false if there are none
+bool Server::sendExamList(Session& session) {
+    // Build a formatted list of available exams
+    string all_exams;
+    int qno = 1;
+    shared_ptr<const ExamCatalog> exams = ExamCatalog::snapshot();
+    for (const auto& exam : exams->all()) {
+        all_exams += to_string(qno++) + ". " + exam->studentListing() + "\n";
+    }
 
-    // --- Authentication loop ---
-    while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        recv(sock, buffer, sizeof(buffer), 0);
-        string request(buffer);
-        if (request == "exit") break;
-    
-        istringstream iss(request);
-        iss >> command >> user_type >> username >> password;
+    // Send available exams to student
+    if (all_exams.empty())
+        all_exams = "No exams available.";
     
-        // Ensure thread-safe access to shared resources during authentication
-        pthread_mutex_lock(&file_mutex1);
-        bool authenticated = handle_authentication(sock, command, user_type, username, password);
-        if (authenticated) {
-            Server::socketToUsername[sock] = username;
+    session.send(all_exams);
+    return all_exams != "No exams available.";
+}
+
+/**
+ * Splits an upload request "name|type|duration|file|start[|scheme]" and checks its fields.
+ * The file is relative to ../data/exams; the start time is only read for scheduled exams.
+ *
+ * @param request The request as sent by the client, or one line of an import manifest.
+ * @param upload Receives the fields.
+ * @param error Receives the message for the instructor.
+ * @return False if a field is invalid.
+ */
+bool Server::parseUpload(const string& request, ExamUpload& upload, string& error) {
+    size_t pos1 = request.find("|");
+    upload.name = request.substr(0, pos1);
+
+    size_t pos2 = request.find("|", pos1 + 1);
+    upload.type = request.substr(pos1+1, pos2-pos1-1);
+
+    size_t pos3 = request.find("|", pos2 + 1);
+    upload.duration = atoi(request.substr(pos2 + 1, pos3 - pos2 - 1).c_str());
+
+    size_t pos4 = request.find("|", pos3 + 1);
+    upload.file = "../data/exams/" + request.substr(pos3 + 1, pos4 - pos3 - 1);
+
+    // The marking scheme is the optional last field; older clients leave it out
+    size_t pos5 = request.find("|", pos4 + 1);
+    string schemeText = pos5 == string::npos ? "" : request.substr(pos5 + 1);
+    upload.scheme = MarkingScheme();
+    if (!schemeText.empty() && !MarkingScheme::parse(schemeText, upload.scheme)) {
+        error = "Error: Invalid marking scheme. Use correct/wrong marks, e.g. +4/-1, or +2/0/+1 to also mark unanswered questions.";
+        return false;
+    }
+
+    upload.startTime = "";
+    if(upload.type=="g" || upload.type=="G"){
+        upload.startTime = request.substr(pos4+1, pos5 == string::npos ? string::npos : pos5 - pos4 - 1);
+
+        // Validate date format
+        tm tm_input = {};
+        istringstream ss(upload.startTime);
+        ss >> get_time(&tm_input, "%Y-%m-%d %H:%M:%S");
+        if (ss.fail()) {
+            error = "Invalid format. Please use YYYY-MM-DD HH:MM:SS";
+            return false;
         }
-        pthread_mutex_unlock(&file_mutex1);
-    
-        if (authenticated) break;
     }
-    
+    return true;
+}
+
+// Handles the instructor's "upload exam" request with the given exam details
+void Server::handleExamUpload(Session& session, const string& examData) {
     ExamManager exam_manager;
+    string response = "";
 
-    // === Student-specific logic ===
-    if (user_type == "student") {
-        char mesg[32]={0};
+    ExamUpload upload;
+    if (!parseUpload(examData, upload, response)) {
+        cerr << response << "\n";
+        session.send(response);
+        return;
+    }
 
-        // Receive exam name (if submitting pending answers)
-        int bytes_received = recv(sock, mesg, sizeof(mesg), 0);
-        if (bytes_received <= 0) return nullptr;
+    // Check for existing exam with the same name, and hold the name while the files are written
+    bool found = !ExamCatalog::reserve(upload.name);
 
-        string examName(mesg);
-        examName.erase(0, examName.find_first_not_of(" \t\n\r")); 
-        examName.erase(examName.find_last_not_of(" \t\n\r") + 1); 
+    if (found) {
+        response = "Exam '" + upload.name + "' already exists.\n";
+    } else {
+        // Upload exam or show error
+        string error;
+        if (exam_manager.parse_exam(upload.type, upload.file, upload.name, session.username, upload.duration, upload.startTime, upload.scheme, error)) {
+            // Publish a new catalog version with just this exam added
+            ExamMeta meta;
+            if (exam_manager.load_exam_meta(upload.name, meta)) ExamCatalog::publishExam(meta);
+            response = "Exam successfully uploaded!"; 
+        } else response = "Error: Invalid exam format! (" + error + ")";      
+        ExamCatalog::release({upload.name});
+    }
+    session.send(response);
+}
 
-        if(examName!="n"){
-            receiveStudentAnswers(sock, examName);
+/**
+ * Imports many exams in one operation. The request is "path|duration|scheme", where the
+ * path (relative to ../data/exams) is either a directory, whose ".txt" files become
+ * practice exams named after the files with the given duration and scheme, or a manifest
+ * with one upload request "name|type|duration|file|start[|scheme]" per line.
+ *
+ * The files are parsed and stored in parallel on the analysis pool. The exams that pass
+ * are then added to exam_list.txt and published in the catalog together, in one commit;
+ * the reply lists the outcome of every file.
+ *
+ * @param session The instructor's session.
+ * @param request The import request.
+ */
+void Server::importExams(Session& session, const string& request) {
+    auto start = chrono::steady_clock::now();
+    size_t pos1 = request.find('|');
+    size_t pos2 = pos1 == string::npos ? string::npos : request.find('|', pos1 + 1);
+    string path = "../data/exams/" + request.substr(0, pos1);
+    string duration = pos1 == string::npos ? "" : request.substr(pos1 + 1, pos2 - pos1 - 1);
+    string scheme = pos2 == string::npos ? "" : request.substr(pos2 + 1);
+
+    // What to import, and why anything is left out
+    vector<ExamUpload> uploads;
+    vector<string> sources;          // file or manifest line of each upload, for the report
+    vector<int> order;               // position of each upload in the folder or manifest
+    vector<pair<int, string>> report;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        session.send("[✖] " + request.substr(0, pos1) + " was not found.");
+        return;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        // The exams directory holds the stored exams themselves; import from a folder inside it
+        char* resolved = realpath(path.c_str(), nullptr);
+        char* exams = realpath("../data/exams", nullptr);
+        bool examsDir = resolved && exams && strcmp(resolved, exams) == 0;
+        free(resolved);
+        free(exams);
+        if (examsDir) {
+            session.send("[✖] Put the exam files in a folder of their own to import them.");
+            return;
         }
-
-        // Main loop for student interaction
-        while (true){
-            memset(buffer, 0, sizeof(buffer));
-            int bytes_received = recv(sock, buffer, sizeof(buffer), 0);
-            if (bytes_received <= 0) break;
-            buffer[bytes_received] = '\0';
-            string request(buffer);
-            
-            if (request == "1") {
-                // Build a formatted list of available exams
-                string all_exams;
-                int qno = 1;
-                for (auto& exam : exams) {
-                    string formattedExam;
-                    istringstream iss(exam);
-                    string line;
-                    
-                    while (getline(iss, line)) 
-                        formattedExam += line + " | ";
-        
-                    if (!formattedExam.empty() && formattedExam.back() == ' ')
-                        formattedExam.pop_back();
-
-                    all_exams += to_string(qno) + ". " + formattedExam + "\n";
-                    qno++;
-                }
-            
-                // Send available exams to student
-                if (all_exams.empty())
-                    all_exams = "No exams available.";
-                
-                send(sock, all_exams.c_str(), all_exams.size(), 0);
-                // If exams are available, handle request
-                if(all_exams!="No exams available.")
-                    handleStudentExamRequest(sock, exam_manager);
-            }
-            
-            else if (request == "2") {
-                handleViewPerformance(sock, username);
+        vector<string> files;
+        if (DIR* dir = opendir(path.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                string file = entry->d_name;
+                if (file.size() > 4 && file.compare(file.size() - 4, 4, ".txt") == 0) files.push_back(file);
             }
-            else if(request == "3") break;
+            closedir(dir);
         }
-    }
-    // === Instructor-specific logic ===
-    else if (user_type == "instructor") {
-        while (true){
-            memset(buffer, 0, sizeof(buffer));
-            int bytes_received = recv(sock, buffer, sizeof(buffer), 0);
-            buffer[bytes_received] = '\0';
-            string request(buffer);
-            string response = "";
-
-            // === Upload new exam ===
-            if (request == "1") {
-                memset(buffer, 0, sizeof(buffer));
-                recv(sock, buffer, sizeof(buffer), 0);
-                string examData(buffer);
-            
-                // Parse exam details
-                size_t pos1 = examData.find("|");
-                string examName = examData.substr(0, pos1);
-
-                size_t pos2 = examData.find("|", pos1 + 1);
-                string exam_type = examData.substr(pos1+1, pos2-pos1-1);  
-
-                size_t pos3 = examData.find("|", pos2 + 1);
-                int examDuration = atoi(examData.substr(pos2 + 1, pos3 - pos2 - 1).c_str());
-
-                size_t pos4 = examData.find("|", pos3 + 1);
-                string examFileName = "../data/exams/" + examData.substr(pos3 + 1, pos4 - pos3 - 1);
-
-                string start_time = "";
-                if(exam_type=="g" || exam_type=="G"){
-                    start_time = examData.substr(pos4+1);
-
-                    // Validate date format
-                    tm tm_input = {};
-                    istringstream ss(start_time);
-                    ss >> get_time(&tm_input, "%Y-%m-%d %H:%M:%S");
-                    if (ss.fail()) {
-                        std::cerr << "Invalid format. Please use YYYY-MM-DD HH:MM:SS\n";
-                        response = "Invalid format. Please use YYYY-MM-DD HH:MM:SS";
-                        send(sock,response.c_str(),response.size(),0);
-                        continue;
-                    }
-                }
-
-                // Check for existing exam with the same name
-                ifstream file("../data/exams/exam_list.txt");
-                bool found = false;
-                if (file.is_open()) {
-                    string line;
-                    while (getline(file, line)) {
-                        size_t pos = line.find('|');
-                        if (pos != string::npos) {
-                            string name = line.substr(0, pos);
-                            if (name == examName) {
-                                found = true;
-                                break;
-                            }
-                        }
-                    }
-                    file.close();
-                } else {
-                    cerr << "Failed to open exam list file.\n";
-                }
-
-                if (found) {
-                    response = "Exam '" + examName + "' already exists.\n";
-                } else {
-                    // Upload exam or show error
-                    if (exam_manager.parse_exam(exam_type ,examFileName, examName, username, examDuration, start_time)) {
-                        pthread_mutex_lock(&file_mutex1);
-                        exams = exam_manager.load_exam_metadata("../data/exams/exam_list.txt");
-                        pthread_mutex_unlock(&file_mutex1);
-                        response = "Exam successfully uploaded!"; 
-                    } else response = "Error: Invalid exam format!";      
-                }
-                send(sock,response.c_str(),response.size(),0);
+        sort(files.begin(), files.end());
+        string relative = request.substr(0, pos1);
+        for (int fileNo = 0; fileNo < (int)files.size(); ++fileNo) {
+            const string& file = files[fileNo];
+            string line = file.substr(0, file.size() - 4) + "|q|" + duration + "|" + relative + "/" + file + "|";
+            if (!scheme.empty()) line += "|" + scheme;
+            ExamUpload upload;
+            string error;
+            if (parseUpload(line, upload, error)) {
+                uploads.push_back(upload);
+                sources.push_back(file);
+                order.push_back(fileNo);
+            } else {
+                report.push_back({fileNo, "[✖] " + file + ": " + error});
             }
-            // === View exam analysis ===
-            else if (request == "3"){
-                vector<string> examNames;
-                sendAvailableExams(sock, username, examNames);
-                if (examNames.empty()) continue;
-
-                char buffer[10];
-                int len = recv(sock, buffer, sizeof(buffer), 0);
-                if (len <= 0) {
-                    cerr << "Failed to receive selection.\n";
-                    break;
-                }
-            
-                buffer[len] = '\0';
-                int selection = atoi(buffer);
-                            if (selection <= 0 || selection > (int)examNames.size()) {
-                    string err = "[!] Invalid exam selection.";
-                    send(sock, err.c_str(), err.size(), 0);
-                    continue;
-                }
-                string selectedExamName = examNames[selection - 1];
-                analyzeExam(selectedExamName, sock, false);
+        }
+    } else {
+        ifstream manifest(path);
+        string line;
+        for (int lineNo = 1; getline(manifest, line); ++lineNo) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            ExamUpload upload;
+            string error;
+            string source = "line " + to_string(lineNo);
+            if (parseUpload(line, upload, error)) {
+                uploads.push_back(upload);
+                sources.push_back(source + " (" + upload.name + ")");
+                order.push_back(lineNo);
+            } else {
+                report.push_back({lineNo, "[✖] " + source + ": " + error});
             }
-            // === View uploaded exams ===
-            else if (request == "4") {
-                vector<string> all_exams;
-                sendAvailableExams(sock, username, all_exams);
+        }
+    }
+
+    // Names must be new, both within the batch and to the catalog (and to uploads in progress)
+    unordered_set<string> names;
+    vector<string> reserved;
+    vector<char> accepted(uploads.size(), 0);
+    for (size_t i = 0; i < uploads.size(); ++i) {
+        const string& name = uploads[i].name;
+        if (name.empty()) report.push_back({order[i], "[✖] " + sources[i] + ": the exam has no name"});
+        else if (!names.insert(name).second) report.push_back({order[i], "[✖] " + sources[i] + ": exam '" + name + "' is imported twice"});
+        else if (!ExamCatalog::reserve(name)) report.push_back({order[i], "[✖] " + sources[i] + ": exam '" + name + "' already exists"});
+        else {
+            accepted[i] = 1;
+            reserved.push_back(name);
+        }
+    }
+
+    // Parse and store every file at once; nothing is listed yet
+    vector<string> errors(uploads.size());
+    vector<char> stored(uploads.size(), 0);
+    AnalysisPool::parallelFor(uploads.size(), [&](size_t i) {
+        if (!accepted[i]) return;
+        const ExamUpload& upload = uploads[i];
+        ExamManager exam_manager;
+        stored[i] = exam_manager.store_exam(upload.type, upload.file, upload.name, session.username, upload.duration,
+                                            upload.startTime, upload.scheme, errors[i]);
+    });
+
+    // One commit for the whole batch
+    ExamManager exam_manager;
+    vector<string> committed;
+    for (size_t i = 0; i < uploads.size(); ++i) {
+        if (stored[i]) committed.push_back(uploads[i].name);
+        else if (accepted[i]) report.push_back({order[i], "[✖] " + sources[i] + ": " + errors[i]});
+    }
+    if (!committed.empty() && !exam_manager.commit_exams(committed)) {
+        for (const string& name : committed) exam_manager.discard_exam(name);
+        ExamCatalog::release(reserved);
+        session.send("[✖] Unable to update exam_list.txt; no exam was imported.");
+        return;
+    }
+    vector<ExamMeta> metas;
+    for (const string& name : committed) {
+        ExamMeta meta;
+        if (exam_manager.load_exam_meta(name, meta)) metas.push_back(meta);
+    }
+    ExamCatalog::publishExams(metas);
+    ExamCatalog::release(reserved);
+
+    double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    ostringstream out;
+    out << "[✔] Imported " << committed.size() << " of " << committed.size() + report.size() << " exam file(s) in "
+        << fixed << setprecision(1) << millis << " ms.\n";
+    for (const string& name : committed) out << "    " << name << "\n";
+    // List the failures in folder or manifest order
+    stable_sort(report.begin(), report.end(),
+                [](const pair<int, string>& a, const pair<int, string>& b) { return a.first < b.first; });
+    if (!report.empty()) out << "[!] Not imported:\n";
+    for (const auto& entry : report) out << "    " << entry.second << "\n";
+    cout << "[+] Bulk import by " << session.username << ": " << committed.size() << " exam(s) added, "
+         << report.size() << " rejected.\n";
+    session.sendParts(out.str());
+}
+
+// Writes all queued replies of a session to its (blocking) socket
+static bool flushSession(Session& session) {
+    while (!session.outbox.empty()) {
+        const Session::Outgoing& item = session.outbox.front();
+        if (item.file) {
+            // sendfile() may stop short, so keep going from where it left off
+            off_t offset = 0;
+            while (offset < item.file->length) {
+                ssize_t n = sendfile(session.sock, item.file->fd, &offset, item.file->length - offset);
+                if (n == -1 && errno == EINTR) continue;
+                if (n <= 0) return false;
             }
-            else if (response=="5") break;
+        } else if (!sendAll(session.sock, item.bytes().data(), item.bytes().size())) {
+            return false;
         }
+        session.outbox.pop_front();
+    }
+    return true;
+}
+
+// Prints the worker pool and paper cache counters every few seconds so both can be sized for an exam hall
+void* Server::reportPoolStats(void* arg) {
+    auto* statsArg = static_cast<pair<WorkerPool*, int>*>(arg);
+    while (true) {
+        sleep(statsArg->second);
+        WorkerPool::Stats stats = statsArg->first->stats();
+        cout << "[pool] queued=" << stats.queued << " (max " << stats.maxQueued << ")"
+             << " active=" << stats.active
+             << " accepted=" << stats.accepted
+             << " rejected=" << stats.rejected << endl;
+        PaperCache::Stats papers = PaperCache::stats();
+        cout << "[papers] cached=" << papers.entries << " (" << papers.bytes << " bytes)"
+             << " hits=" << papers.hits
+             << " misses=" << papers.misses
+             << " evictions=" << papers.evictions << endl;
+    }
+    return nullptr;
+}
+
+// Thread-per-connection mode: each client gets its own detached thread
+void* Server::handle_client(void* client_socket) {
+    int sock = *(int*)client_socket;
+    delete (int*)client_socket;
+    serveClient(sock);
+    return nullptr;
+}
+
+// Blocks on the client socket and drives its session until the client disconnects
+void Server::serveClient(int sock) {
+    Session session(sock);
+    string message;
+
+    while (!session.isClosed()) {
+        if (!recvFrame(sock, message)) break;
+
+        session.onMessage(message);
+        if (!flushSession(session)) break;
     }
 
     // === Final cleanup ===
     close(sock);
-    cout << "[-] client[ "<<username<<" ] disconnected!"<<endl;
-    return nullptr;
-}
\ No newline at end of file
+    cout << "[-] client[ "<<session.username<<" ] disconnected!"<<endl;
+}
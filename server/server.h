@@ -5,6 +5,7 @@
 #include <pthread.h>
 #include <unordered_map>
 #include <map>
+#include <set>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
@@ -22,25 +23,80 @@
 
 #include "auth.h"
 #include "exam_manager.h"
+#include "session.h"
+#include "submission_log.h"
+#include "leaderboard.h"
+#include "report_cache.h"
 
 using namespace std;
 
+// Runtime options for the server, filled from the command line in main.cpp
+struct ServerConfig {
+    int port = 8080;
+    string mode = "thread";   // "thread": one thread per client, "reactor": epoll event loops,
+                              // "pool": bounded queue served by a fixed set of workers
+    int eventLoops = 4;       // number of event-loop threads in reactor mode
+    int workers = 64;         // worker threads in pool mode (one per concurrently served client);
+                              // in reactor mode, threads running requests that may block
+    int queueCapacity = 256;  // accepted clients allowed to wait for a worker in pool mode
+    int retryAfter = 5;       // seconds a rejected client is told to wait before retrying
+    int statsInterval = 0;    // seconds between pool counter reports (0 = off)
+    int paperCacheMB = 64;    // memory cap of the question paper cache (0 = off)
+    string analysis = "memory";  // "memory": every attempt kept in columns, running totals and a rank index,
+                                 // "streaming": one bounded-memory pass over the analysis file per report
+    int topK = 100;           // leaderboard rows kept in streaming analysis mode
+    int analysisThreads = 0;  // threads splitting up analysis work (0 = one per CPU core, 1 = serial)
+    int collusionPairs = 20;  // most similar pairs of answer sheets listed by the collusion check
+};
+
+// Data behind an exam analysis report, kept while the client pages through it or drills into a student
+struct ExamAnalysis {
+    string examName;
+    shared_ptr<LeaderboardView> view;                 // the page being shown
+    LeaderboardView::RowSource rows;                  // instructors: rows by sr no. (rank order)
+    size_t rowCount = 0;
+    shared_ptr<const ColumnSnapshot> columns;         // every attempt, with answers and times per question
+    vector<off_t> lineOffsets;                        // streaming mode: analysis file offset per leaderboard row
+};
+
+// Outcome of looking up one attempt from the student dashboard
+enum class AttemptView { SHOWN, FILE_MISSING, EXAM_RUNNING };
+
 class Server {
 public:
-    Server(int port);
+    Server(const ServerConfig& config);
     void start();
-    static map<int, string> socketToUsername;
     
 private:
+    friend class Session;
+
     int server_socket;
-    static void receiveStudentAnswers(int sock, const string& examName);
-    static bool handle_authentication(int sock, const string& command, const string& user_type, const string& username, const string& password);    
+    ServerConfig config;
+    void listenOn(int port);
+    static void receiveStudentAnswers(Session& session, const string& examName, const string& data);
+    static void writeSubmissionViews(const Submission& submission, ViewWriter& writer);
+    static void onViewsWritten(const deque<Submission>& batch);
+    static bool handle_authentication(Session& session, const string& command, const string& user_type, const string& username, const string& password);    
     static void* handle_client(void* client_socket);
-    static void handleStudentExamRequest(int sock, ExamManager exam);
+    static void serveClient(int sock);
+    static void* reportPoolStats(void* arg);
+    static bool sendExamList(Session& session);
+    static bool handleStudentExamRequest(Session& session, int examNumber);
+    static bool hasAttempted(const string& studentId, const string& examName);
     static string getCurrentDateTime();
-    static void handleViewPerformance(int sock, const string& username);
-    static void sendAvailableExams(int sock, const string& username, vector<string>& examNames);
-    static void analyzeExam(const string& examName, int sock, bool isStudenet);
+    static bool loadAttempts(Session& session);
+    static void sendDashboard(Session& session);
+    static void sendAttemptList(Session& session);
+    static AttemptView sendAttemptDetails(Session& session, int attemptChoice);
+    static void sendAvailableExams(Session& session, const string& username, vector<string>& examNames);
+    static bool parseUpload(const string& request, ExamUpload& upload, string& error);
+    static void handleExamUpload(Session& session, const string& examData);
+    static void importExams(Session& session, const string& request);
+    static bool analyzeExam(const string& examName, Session& session, bool isStudent);
+    static bool sendStudentAttemptDetails(Session& session, int opt);
+    static void sendCollusionReport(Session& session, const string& examName);
+    static bool sendAnswerKey(Session& session, const string& examName);
+    static void regradeExam(Session& session, const string& examName, const string& keyText);
 };
 
 #endif
@@ -0,0 +1,376 @@
+#include "session.h"
+#include "server.h"
+
+#include <unistd.h>
+#include <cctype>
+
+extern pthread_mutex_t file_mutex1;
+
+// Trims leading and trailing whitespace from a client message
+static string trim(const string& str) {
+    string result = str;
+    result.erase(0, result.find_first_not_of(" \t\n\r"));
+    result.erase(result.find_last_not_of(" \t\n\r") + 1);
+    return result;
+}
+
+Session::Session(int sock) : sock(sock), state(State::AUTH) {}
+
+void Session::send(const string& data, uint8_t type) {
+    outbox.push_back({encodeFrame(data, type), nullptr, nullptr});
+}
+
+void Session::sendParts(const string& text) {
+    for (string& frame : encodeTextParts(text)) outbox.push_back({move(frame), nullptr, nullptr});
+}
+
+void Session::sendShared(const shared_ptr<const string>& frame) {
+    outbox.push_back({"", frame, nullptr});
+}
+
+void Session::sendFile(const shared_ptr<FileBody>& file) {
+    outbox.push_back({"", nullptr, file});
+}
+
+Session::FileBody::~FileBody() {
+    ::close(fd);
+}
+
+/**
+ * Advances the state machine by one client message.
+ *
+ * @param msg The payload of one frame received from the client.
+ */
+void Session::onMessage(const string& msg) {
+    switch (state) {
+        case State::AUTH:
+            onAuth(msg);
+            break;
+
+        // --- Pending answer sheet backed up by the client during a disconnect ---
+        case State::STUDENT_PENDING_SHEET: {
+            string examName = trim(msg);
+            if (examName != "n") {
+                selectedExam = examName;
+                state = State::STUDENT_PENDING_ANSWERS;
+            } else {
+                state = State::STUDENT_MENU;
+            }
+            break;
+        }
+        case State::STUDENT_PENDING_ANSWERS:
+            Server::receiveStudentAnswers(*this, selectedExam, msg);
+            state = State::STUDENT_MENU;
+            break;
+
+        // --- Student menu and exam flow ---
+        case State::STUDENT_MENU:
+            onStudentMenu(msg);
+            break;
+        case State::STUDENT_EXAM_SELECT:
+            onStudentExamSelect(msg);
+            break;
+        case State::STUDENT_EXAM_CONFIRM:
+            // Wait for student to confirm whether they want to proceed
+            if (msg == "y" || msg == "Y") state = State::STUDENT_EXAM_TYPE;
+            else state = State::STUDENT_MENU;
+            break;
+        case State::STUDENT_EXAM_TYPE:
+            onStudentExamType(msg);
+            break;
+        case State::STUDENT_EXAM_ANSWERS:
+            // Receive and evaluate student's answers
+            Server::receiveStudentAnswers(*this, selectedExam, msg);
+            state = State::STUDENT_MENU;
+            break;
+
+        // --- Student dashboard ---
+        case State::PERF_EXAM_SELECT:
+            onPerfExamSelect(msg);
+            break;
+        case State::PERF_ATTEMPT_SELECT:
+            onPerfAttemptSelect(msg);
+            break;
+        case State::PERF_LEADERBOARD_PROMPT:
+            if (atoi(msg.c_str()) != 1) {
+                Server::sendDashboard(*this);
+                state = State::PERF_EXAM_SELECT;
+                break;
+            }
+            if (Server::analyzeExam(selectedExam, *this, true)) state = State::STUDENT_LEADERBOARD;
+            else state = State::STUDENT_MENU;
+            break;
+        case State::STUDENT_LEADERBOARD:
+            if (msg == "0") {
+                analysis.reset();
+                state = State::STUDENT_MENU;
+                break;
+            }
+            onLeaderboardCommand(msg);
+            break;
+
+        // --- Instructor menu ---
+        case State::INSTRUCTOR_MENU:
+            onInstructorMenu(msg);
+            break;
+        case State::INSTRUCTOR_UPLOAD:
+            Server::handleExamUpload(*this, msg);
+            state = State::INSTRUCTOR_MENU;
+            break;
+        case State::INSTRUCTOR_ANALYSIS_SELECT:
+            onInstructorAnalysisSelect(msg);
+            break;
+        case State::INSTRUCTOR_STUDENT_DETAIL:
+            // Paging commands move through the leaderboard; a number is a sr no. to drill into
+            if (!msg.empty() && isalpha((unsigned char)msg[0])) {
+                onLeaderboardCommand(msg);
+                break;
+            }
+            if (!Server::sendStudentAttemptDetails(*this, atoi(msg.c_str()))) {
+                analysis.reset();
+                state = State::INSTRUCTOR_MENU;
+            }
+            break;
+        case State::INSTRUCTOR_COLLUSION_SELECT:
+            onInstructorCollusionSelect(msg);
+            break;
+        case State::INSTRUCTOR_REGRADE_SELECT:
+            onInstructorRegradeSelect(msg);
+            break;
+        case State::INSTRUCTOR_REGRADE_KEY:
+            state = State::INSTRUCTOR_MENU;
+            if (msg == "0") send("[!] Re-grade cancelled.");
+            else Server::regradeExam(*this, selectedExam, msg);
+            break;
+        case State::INSTRUCTOR_IMPORT:
+            state = State::INSTRUCTOR_MENU;
+            if (msg == "0") send("[!] Import cancelled.");
+            else Server::importExams(*this, msg);
+            break;
+
+        case State::CLOSED:
+            break;
+    }
+}
+
+/**
+ * Whether handling a message in the current state may wait on the disk or run for
+ * long: logging in (the credential files), submitting answers (group commit), opening
+ * a paper or a past attempt, reports that wait for the derived files, a sr no. drill-down,
+ * the answer-similarity check, uploads, imports and re-grades.
+ *
+ * @param msg The payload of the next frame.
+ */
+bool Session::mayBlock(const string& msg) const {
+    switch (state) {
+        case State::AUTH:                     // credential files, read under file_mutex1
+        case State::STUDENT_PENDING_ANSWERS:
+        case State::STUDENT_EXAM_SELECT:      // the paper is parsed and rendered if not cached
+        case State::STUDENT_EXAM_ANSWERS:
+        case State::PERF_ATTEMPT_SELECT:      // the attempt's row and the questions file
+        case State::INSTRUCTOR_UPLOAD:
+        case State::INSTRUCTOR_ANALYSIS_SELECT:
+        case State::INSTRUCTOR_COLLUSION_SELECT:
+        case State::INSTRUCTOR_REGRADE_KEY:
+        case State::INSTRUCTOR_IMPORT:
+            return true;
+        case State::STUDENT_MENU:
+            return msg == "2";                // the dashboard waits for the derived files
+        case State::PERF_LEADERBOARD_PROMPT:
+            return atoi(msg.c_str()) == 1;    // so does the exam analysis
+        case State::INSTRUCTOR_STUDENT_DETAIL:
+            // A sr no. may read the attempt's row from disk; paging stays in memory
+            return msg.empty() || !isalpha((unsigned char)msg[0]);
+        default:
+            return false;
+    }
+}
+
+// --- Authentication loop ---
+void Session::onAuth(const string& msg) {
+    if (msg == "exit") {
+        close();
+        return;
+    }
+
+    string name;
+    istringstream iss(msg);
+    iss >> command >> user_type >> name >> password;
+
+    // Ensure thread-safe access to shared resources during authentication
+    pthread_mutex_lock(&file_mutex1);
+    bool authenticated = Server::handle_authentication(*this, command, user_type, name, password);
+    pthread_mutex_unlock(&file_mutex1);
+
+    if (!authenticated) return;
+    username = name;
+
+    if (user_type == "student") state = State::STUDENT_PENDING_SHEET;
+    else if (user_type == "instructor") state = State::INSTRUCTOR_MENU;
+    else close();
+}
+
+void Session::onStudentMenu(const string& msg) {
+    if (msg == "1") {
+        // If exams are available, wait for the student's selection
+        if (Server::sendExamList(*this))
+            state = State::STUDENT_EXAM_SELECT;
+    }
+    else if (msg == "2") {
+        if (Server::loadAttempts(*this)) {
+            Server::sendDashboard(*this);
+            state = State::PERF_EXAM_SELECT;
+        }
+    }
+    else if (msg == "3") close();
+}
+
+void Session::onStudentExamSelect(const string& msg) {
+    // Receive the exam number selected by the student
+    int examNumber = atoi(msg.c_str());
+    if (Server::handleStudentExamRequest(*this, examNumber))
+        state = State::STUDENT_EXAM_CONFIRM;
+    else
+        state = State::STUDENT_MENU;
+}
+
+void Session::onStudentExamType(const string& msg) {
+    // Exam type: 's' for scheduled, 'm' for practice
+    if (msg == "s") {
+        // Notify client if already attempted
+        if (Server::hasAttempted(username, selectedExam)) {
+            send("y");
+            state = State::STUDENT_MENU;
+            return;
+        }
+        send("n");
+    }
+    state = State::STUDENT_EXAM_ANSWERS;
+}
+
+void Session::onPerfExamSelect(const string& msg) {
+    // Receive exam selection from client
+    int examChoice = atoi(msg.c_str());
+    if (examChoice == 0) {
+        state = State::STUDENT_MENU;
+        return;
+    }
+    if (examChoice < 1 || examChoice > examNames.size()) {
+        send("[!] Invalid option! please select a valid exam.");
+        Server::sendDashboard(*this);
+        return;
+    }
+
+    selectedExam = examNames[examChoice - 1];
+    Server::sendAttemptList(*this);
+    state = State::PERF_ATTEMPT_SELECT;
+}
+
+void Session::onPerfAttemptSelect(const string& msg) {
+    // Receive attempt selection
+    int attemptChoice = atoi(msg.c_str());
+    int attemptCount = examMap[selectedExam].size();
+
+    if (attemptChoice == 0) {
+        Server::sendDashboard(*this);
+        state = State::PERF_EXAM_SELECT;
+        return;
+    }
+    if (attemptChoice < 1 || attemptChoice > attemptCount) {
+        send("[!] Invalid option! please select a valid attempt.");
+        Server::sendDashboard(*this);
+        state = State::PERF_EXAM_SELECT;
+        return;
+    }
+
+    switch (Server::sendAttemptDetails(*this, attemptChoice)) {
+        case AttemptView::SHOWN:
+            state = State::PERF_LEADERBOARD_PROMPT;
+            break;
+        case AttemptView::FILE_MISSING:
+            Server::sendDashboard(*this);
+            state = State::PERF_EXAM_SELECT;
+            break;
+        case AttemptView::EXAM_RUNNING:
+            state = State::STUDENT_MENU;
+            break;
+    }
+}
+
+void Session::onInstructorMenu(const string& msg) {
+    // === Upload new exam ===
+    if (msg == "1") {
+        state = State::INSTRUCTOR_UPLOAD;
+    }
+    // === View exam analysis ===
+    else if (msg == "3") {
+        Server::sendAvailableExams(*this, username, examNames);
+        if (!examNames.empty()) state = State::INSTRUCTOR_ANALYSIS_SELECT;
+    }
+    // === View uploaded exams ===
+    else if (msg == "4") {
+        vector<string> all_exams;
+        Server::sendAvailableExams(*this, username, all_exams);
+    }
+    // === Check answer sheets for collusion ===
+    else if (msg == "5") {
+        Server::sendAvailableExams(*this, username, examNames);
+        if (!examNames.empty()) state = State::INSTRUCTOR_COLLUSION_SELECT;
+    }
+    // === Correct an answer key and re-grade ===
+    else if (msg == "6") {
+        Server::sendAvailableExams(*this, username, examNames);
+        if (!examNames.empty()) state = State::INSTRUCTOR_REGRADE_SELECT;
+    }
+    // === Import many exams at once ===
+    else if (msg == "7") {
+        state = State::INSTRUCTOR_IMPORT;
+    }
+    else if (msg == "8") close();
+}
+
+void Session::onInstructorAnalysisSelect(const string& msg) {
+    int selection = atoi(msg.c_str());
+    if (selection <= 0 || selection > (int)examNames.size()) {
+        send("[!] Invalid exam selection.");
+        state = State::INSTRUCTOR_MENU;
+        return;
+    }
+
+    string selectedExamName = examNames[selection - 1];
+    if (Server::analyzeExam(selectedExamName, *this, false))
+        state = State::INSTRUCTOR_STUDENT_DETAIL;
+    else
+        state = State::INSTRUCTOR_MENU;
+}
+
+void Session::onInstructorCollusionSelect(const string& msg) {
+    int selection = atoi(msg.c_str());
+    state = State::INSTRUCTOR_MENU;
+    if (selection <= 0 || selection > (int)examNames.size()) {
+        send("[!] Invalid exam selection.");
+        return;
+    }
+    Server::sendCollusionReport(*this, examNames[selection - 1]);
+}
+
+void Session::onInstructorRegradeSelect(const string& msg) {
+    int selection = atoi(msg.c_str());
+    state = State::INSTRUCTOR_MENU;
+    if (selection <= 0 || selection > (int)examNames.size()) {
+        send("[!] Invalid exam selection.");
+        return;
+    }
+    selectedExam = examNames[selection - 1];
+    if (Server::sendAnswerKey(*this, selectedExam)) state = State::INSTRUCTOR_REGRADE_KEY;
+}
+
+// A paging command (NEXT, PREV, TOP, PAGE n, SIZE n, AROUND) on the leaderboard being viewed
+void Session::onLeaderboardCommand(const string& msg) {
+    string reply;
+    if (!analysis || !analysis->view || !analysis->view->handle(trim(msg), reply)) {
+        send("[!] Unknown leaderboard command.");
+        return;
+    }
+    sendParts(reply);
+}
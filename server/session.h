@@ -0,0 +1,119 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <sys/types.h>
+
+#include "protocol.h"
+
+using namespace std;
+
+struct ExamAnalysis;
+
+/**
+ * Per-connection protocol state machine.
+ *
+ * A session never blocks on the socket: the transport (a dedicated thread or
+ * an event loop) feeds it one client frame at a time through onMessage(),
+ * and the session queues its framed replies in the outbox for the transport to write.
+ * Some requests do wait on the disk or run long (a submission waits for its group
+ * commit, reports wait for the derived files, logins read the credential files);
+ * mayBlock() tells an event loop to hand those to another thread.
+ * Every step of the authentication loop, the student menu and the instructor
+ * menu is one state below.
+ */
+class Session {
+public:
+    // An open pre-rendered frame on disk, streamed to sockets with sendfile()
+    struct FileBody {
+        int fd;
+        off_t length;
+        FileBody(int fd, off_t length) : fd(fd), length(length) {}
+        ~FileBody();
+    };
+
+    // A framed reply waiting to be written: in memory (owned or shared) or a whole file on disk
+    struct Outgoing {
+        string data;
+        shared_ptr<const string> shared;   // pre-encoded frame shared with other sessions
+        shared_ptr<FileBody> file;
+
+        const string& bytes() const { return shared ? *shared : data; }
+    };
+
+    enum class State {
+        AUTH,                        // waiting for LOGIN / REGISTER / exit
+        STUDENT_PENDING_SHEET,       // waiting for the name of a backed-up answer sheet (or "n")
+        STUDENT_PENDING_ANSWERS,     // waiting for the backed-up answers themselves
+        STUDENT_MENU,
+        STUDENT_EXAM_SELECT,         // waiting for the exam number after the exam list
+        STUDENT_EXAM_CONFIRM,        // waiting for y/n to start the exam
+        STUDENT_EXAM_TYPE,           // waiting for 's' (scheduled) or 'm' (practice)
+        STUDENT_EXAM_ANSWERS,        // waiting for the submitted answer sheet
+        PERF_EXAM_SELECT,            // dashboard: waiting for an exam choice
+        PERF_ATTEMPT_SELECT,         // dashboard: waiting for an attempt choice
+        PERF_LEADERBOARD_PROMPT,     // dashboard: waiting for "view analysis" choice
+        STUDENT_LEADERBOARD,         // waiting for a leaderboard paging command (or "0")
+        INSTRUCTOR_MENU,
+        INSTRUCTOR_UPLOAD,           // waiting for the exam details string
+        INSTRUCTOR_ANALYSIS_SELECT,  // waiting for the exam to analyze
+        INSTRUCTOR_STUDENT_DETAIL,   // waiting for a leaderboard sr no. to drill into, or a paging command
+        INSTRUCTOR_COLLUSION_SELECT, // waiting for the exam to check for similar answer sheets
+        INSTRUCTOR_REGRADE_SELECT,   // waiting for the exam whose answer key is corrected
+        INSTRUCTOR_REGRADE_KEY,      // waiting for the corrected key (or "0")
+        INSTRUCTOR_IMPORT,           // waiting for the directory or manifest to import
+        CLOSED
+    };
+
+    explicit Session(int sock);
+
+    void onMessage(const string& msg);
+    bool mayBlock(const string& msg) const;
+    bool isClosed() const { return state == State::CLOSED; }
+
+    // Queue a reply as one framed message
+    void send(const string& data, uint8_t type = MSG_TEXT);
+    // Queue a long text reply in MSG_PART pieces the client can show as they arrive
+    void sendParts(const string& text);
+    // Queue an already encoded frame without copying it
+    void sendShared(const shared_ptr<const string>& frame);
+    // Queue a file that already holds a complete frame (header + payload)
+    void sendFile(const shared_ptr<FileBody>& file);
+    void close() { state = State::CLOSED; }
+
+    int sock;
+    string username;
+    string user_type;
+    deque<Outgoing> outbox;
+
+    // Dashboard state: exam name -> (timestamp, marks obtained, "total|performance file")
+    map<string, vector<tuple<string, string, string>>> examMap;
+    vector<string> examNames;
+    string selectedExam;
+
+    // Analysis being viewed: the leaderboard page and, for instructors, the per-student drill-down
+    shared_ptr<ExamAnalysis> analysis;
+
+private:
+    State state;
+    string command, password;
+
+    void onAuth(const string& msg);
+    void onStudentMenu(const string& msg);
+    void onStudentExamSelect(const string& msg);
+    void onStudentExamType(const string& msg);
+    void onPerfExamSelect(const string& msg);
+    void onPerfAttemptSelect(const string& msg);
+    void onInstructorMenu(const string& msg);
+    void onInstructorAnalysisSelect(const string& msg);
+    void onInstructorCollusionSelect(const string& msg);
+    void onInstructorRegradeSelect(const string& msg);
+    void onLeaderboardCommand(const string& msg);
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "streaming_analysis.h"
+#include "analysis_pool.h"
+#include "exam_catalog.h"
+
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include <algorithm>
+#include <unordered_map>
+
+size_t StreamingAnalysis::topK = 0;
+
+void StreamingAnalysis::enable(size_t k) {
+    topK = k;
+}
+
+StreamingAnalysis::RankKey StreamingAnalysis::keyOf(const RankEntry& entry) {
+    return RankKey(-entry.score, entry.time, entry.originalIndex);
+}
+
+// A ranked attempt together with where its line starts; heaps order these by key
+struct RankedLine {
+    tuple<int, double, int> key;
+    RankEntry entry;
+    off_t offset;
+
+    bool operator<(const RankedLine& other) const { return key < other.key; }
+    bool operator>(const RankedLine& other) const { return key > other.key; }
+};
+
+/**
+ * Reads an exam's analysis file once, ROWS_PER_GROUP student lines at a time, and hands
+ * each chunk (with its kernel totals) to `visit` in file order. Chunks are parsed and
+ * aggregated a batch at a time on the analysis pool, so at most one chunk per pool
+ * thread is in memory.
+ *
+ * @param examName The name of the exam.
+ * @param correctAnswers Receives the answer key (the file's first line).
+ * @param visit Called per chunk with its rows, their totals and the byte offset of each line.
+ * @param maxRows Stop after this many student lines.
+ * @return False if the exam has no analysis file.
+ */
+bool StreamingAnalysis::scan(const string& examName, vector<char>& correctAnswers, const ChunkVisitor& visit,
+                             size_t maxRows) {
+    ifstream file(analysisPathOf(examName), ios::binary);
+    if (!file.is_open()) return false;
+
+    string line;
+    off_t position = 0;
+    MarkingScheme scheme = ExamCatalog::schemeOf(examName);
+    correctAnswers.clear();
+    if (getline(file, line)) {
+        stringstream ss(line);
+        char ans;
+        while (ss >> ans) correctAnswers.push_back(ans);
+        position += line.size() + 1;
+    }
+
+    struct Chunk {
+        vector<string> lines;
+        vector<off_t> offsets;
+    };
+    vector<Chunk> batch(AnalysisPool::threads());
+    size_t filled = 0;
+    auto flush = [&]() {
+        vector<ColumnSnapshot> snapshots(filled);
+        vector<ColumnTotals> totals(filled);
+        AnalysisPool::parallelFor(filled, [&](size_t c) {
+            auto group = make_shared<RowGroup>();
+            group->answers.assign(correctAnswers.size(), vector<uint8_t>());
+            group->times.assign(correctAnswers.size(), vector<uint16_t>());
+            unordered_map<string, uint32_t> dictionary;
+            for (const string& text : batch[c].lines) group->addRow(text, dictionary);
+
+            snapshots[c].correctAnswers = correctAnswers;
+            snapshots[c].scheme = scheme;
+            snapshots[c].groups.push_back(group);
+            snapshots[c].rows = group->rows;
+            snapshots[c].aggregate(0, group->rows, totals[c]);
+        });
+        for (size_t c = 0; c < filled; ++c) {
+            visit(snapshots[c], totals[c], batch[c].offsets);
+            batch[c].lines.clear();
+            batch[c].offsets.clear();
+        }
+        filled = 0;
+    };
+
+    size_t rows = 0;
+    while (rows < maxRows && getline(file, line)) {
+        // A last line without its newline is still being written; leave it out like the in-memory path does
+        if (file.eof()) break;
+        off_t start = position;
+        position += line.size() + 1;
+        if (line.empty()) continue;
+        rows++;
+        Chunk& chunk = batch[filled];
+        chunk.lines.push_back(line);
+        chunk.offsets.push_back(start);
+        if (chunk.lines.size() == AnalysisColumns::ROWS_PER_GROUP && ++filled == batch.size()) flush();
+    }
+    if (filled < batch.size() && !batch[filled].lines.empty()) filled++;
+    flush();
+    return true;
+}
+
+/**
+ * Computes the analysis of an exam in one pass: metrics into `totals`, the best topK
+ * attempts into `top` and, if `studentId` is given, that student's best attempt.
+ *
+ * @param examName The name of the exam.
+ * @param result Receives the analysis.
+ * @param studentId Student whose best attempt to find, or "".
+ * @return False if the exam has no analysis file.
+ */
+bool StreamingAnalysis::run(const string& examName, StreamingAnalysis& result, const string& studentId) {
+    priority_queue<RankedLine> best;     // max-heap: the worst of the kept attempts on top
+    vector<char> correctAnswers;
+    int row = 0;
+
+    bool found = scan(examName, correctAnswers, [&](const ColumnSnapshot& chunk, const ColumnTotals& totals,
+                                                    const vector<off_t>& offsets) {
+        result.totals->add(correctAnswers, totals);
+        for (size_t r = 0; r < totals.rows(); ++r, ++row) {
+            RankEntry entry{chunk.studentId(r), totals.score(r), (double)totals.rowTime[r],
+                            totals.attempted(r), totals.wrong(r), row};
+            RankedLine ranked{keyOf(entry), entry, offsets[r]};
+            if (best.size() < topK) {
+                best.push(ranked);
+            } else if (ranked < best.top()) {
+                best.pop();
+                best.push(ranked);
+            }
+            if (!studentId.empty() && entry.id == studentId &&
+                (!result.hasStudentBest || keyOf(entry) < keyOf(result.studentBest))) {
+                result.studentBest = entry;
+                result.hasStudentBest = true;
+            }
+        }
+    });
+    if (!found) return false;
+
+    // An exam nobody has attempted yet still reports its (empty) metrics
+    if (result.totals->correctAnswers.empty()) {
+        result.totals->correctAnswers = correctAnswers;
+        result.totals->scheme = ExamCatalog::schemeOf(examName);
+        result.totals->questions.assign(correctAnswers.size(), ExamAggregate::QuestionStats());
+    }
+
+    result.top.resize(best.size());
+    result.topOffsets.resize(best.size());
+    for (size_t i = best.size(); i-- > 0; best.pop()) {
+        result.top[i] = best.top().entry;
+        result.topOffsets[i] = best.top().offset;
+    }
+    return true;
+}
+
+/**
+ * The leaderboard to page through: the top K rows and, if run() was given a student with
+ * an attempt, that student's rank and neighbourhood. If the neighbourhood is not inside
+ * the top K, a second pass over the analysis file counts the attempts ranked above the
+ * student's best and keeps the WINDOW_ROWS on either side.
+ *
+ * @param examName The name of the exam.
+ */
+shared_ptr<LeaderboardView> StreamingAnalysis::view(const string& examName) const {
+    const size_t window = Leaderboard::WINDOW_ROWS;
+    size_t total = totals->totalStudents;
+    size_t position = Leaderboard::NO_RANK;
+    vector<RankEntry> around;            // rows ranked [aroundStart, aroundStart + around.size())
+    size_t aroundStart = 0;
+
+    if (hasStudentBest) {
+        RankKey own = keyOf(studentBest);
+        auto inTop = find_if(top.begin(), top.end(), [&](const RankEntry& e) { return keyOf(e) == own; });
+        if (inTop != top.end() && (top.size() == total || (size_t)(inTop - top.begin()) + window < top.size())) {
+            position = inTop - top.begin();
+        } else {
+            // Rank = attempts ahead of the student's best; keep the closest ones on either side
+            priority_queue<RankedLine, vector<RankedLine>, greater<RankedLine>> above; // largest keys below own
+            priority_queue<RankedLine> below;                                          // smallest keys above own
+            size_t ahead = 0;
+            int row = 0;
+            vector<char> correctAnswers;
+            // Only the rows the metrics were computed from; later attempts are left for the next report
+            scan(examName, correctAnswers, [&](const ColumnSnapshot& chunk, const ColumnTotals& chunkTotals,
+                                               const vector<off_t>&) {
+                for (size_t r = 0; r < chunkTotals.rows(); ++r, ++row) {
+                    RankEntry entry{chunk.studentId(r), chunkTotals.score(r), (double)chunkTotals.rowTime[r],
+                                    chunkTotals.attempted(r), chunkTotals.wrong(r), row};
+                    RankedLine ranked{keyOf(entry), entry, 0};
+                    if (ranked.key < own) {
+                        ahead++;
+                        above.push(ranked);
+                        if (above.size() > window) above.pop();
+                    } else if (ranked.key > own) {
+                        below.push(ranked);
+                        if (below.size() > window) below.pop();
+                    }
+                }
+            }, total);
+            position = ahead;
+            aroundStart = ahead - above.size();
+            for (; !above.empty(); above.pop()) around.push_back(above.top().entry);
+            around.push_back(studentBest);
+            size_t firstBelow = around.size();
+            for (; !below.empty(); below.pop()) around.push_back(below.top().entry);
+            reverse(around.begin() + firstBelow, around.end());
+        }
+    }
+
+    auto rows = LeaderboardView::rowsOf(make_shared<const vector<RankEntry>>(top));
+    auto result = make_shared<LeaderboardView>(rows, top.size(), total, totals->questionCount(),
+                                               totals->scheme.maxMarks(totals->questionCount()), position);
+    if (!around.empty()) result->setNeighbourhood(aroundStart, around);
+    return result;
+}
+
+/**
+ * Re-reads one attempt for the instructor drill-down.
+ *
+ * @param examName The name of the exam.
+ * @param offset Byte offset of the attempt's line in the analysis file.
+ * @return A one-row snapshot, or nullptr if the line cannot be read.
+ */
+shared_ptr<const ColumnSnapshot> StreamingAnalysis::readRow(const string& examName, off_t offset) {
+    ifstream file(analysisPathOf(examName), ios::binary);
+    string keyLine, line;
+    if (!getline(file, keyLine)) return nullptr;
+    file.seekg(offset);
+    if (!getline(file, line) || line.empty()) return nullptr;
+
+    auto columns = make_shared<ColumnSnapshot>();
+    stringstream ss(keyLine);
+    char ans;
+    while (ss >> ans) columns->correctAnswers.push_back(ans);
+    columns->scheme = ExamCatalog::schemeOf(examName);
+
+    auto group = make_shared<RowGroup>();
+    group->answers.assign(columns->correctAnswers.size(), vector<uint8_t>());
+    group->times.assign(columns->correctAnswers.size(), vector<uint16_t>());
+    unordered_map<string, uint32_t> dictionary;
+    group->addRow(line, dictionary);
+    columns->groups.push_back(group);
+    columns->rows = 1;
+    return columns;
+}
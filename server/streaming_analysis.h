@@ -0,0 +1,64 @@
+#ifndef STREAMING_ANALYSIS_H
+#define STREAMING_ANALYSIS_H
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <functional>
+#include <sys/types.h>
+
+#include "analysis_columns.h"
+#include "exam_aggregate.h"
+#include "leaderboard.h"
+
+using namespace std;
+
+/**
+ * Bounded-memory analysis of an exam ("--analysis=streaming").
+ *
+ * Instead of keeping every attempt of every exam in memory (analysis columns,
+ * running totals, rank index), each report makes one pass over the exam's analysis
+ * file, ROWS_PER_GROUP lines at a time (one chunk per analysis pool thread in flight).
+ * Every chunk goes through the same column kernels and is then dropped, so memory
+ * stays O(questions + top-K) whatever the size of the cohort:
+ *   - per-question, option and time totals are plain counters;
+ *   - the median comes from the score histogram, with one bucket per possible score
+ *     (at most (correct - lowest mark) * questions + 1 under the exam's scheme);
+ *   - the leaderboard keeps only the best K attempts, in a bounded heap.
+ *
+ * A student's rank and neighbourhood take a second pass when they fall outside the
+ * top K; it stops at the rows the first pass read, so attempts submitted in between
+ * do not skew the rank against the metrics. The instructor drill-down re-reads the
+ * selected line from its byte offset.
+ */
+class StreamingAnalysis {
+public:
+    shared_ptr<ExamAggregate> totals = make_shared<ExamAggregate>();
+    vector<RankEntry> top;               // best attempts in leaderboard order, at most topK
+    vector<off_t> topOffsets;            // where each of them starts in the analysis file
+    bool hasStudentBest = false;         // set if the student passed to run() has an attempt
+    RankEntry studentBest;
+
+    static void enable(size_t topK);
+    static bool enabled() { return topK > 0; }
+    static bool run(const string& examName, StreamingAnalysis& result, const string& studentId = "");
+    static shared_ptr<const ColumnSnapshot> readRow(const string& examName, off_t offset);
+    shared_ptr<LeaderboardView> view(const string& examName) const;
+
+    // One bounded-memory pass over an analysis file, also used by the collusion check
+    typedef function<void(const ColumnSnapshot& chunk, const ColumnTotals& totals,
+                          const vector<off_t>& offsets)> ChunkVisitor;
+    static bool scan(const string& examName, vector<char>& correctAnswers, const ChunkVisitor& visit,
+                     size_t maxRows = (size_t)-1);
+
+private:
+    // (-score, time, originalIndex): ascending order is leaderboard order
+    typedef tuple<int, double, int> RankKey;
+
+    static size_t topK;                  // 0 while the in-memory analysis is used
+
+    static RankKey keyOf(const RankEntry& entry);
+};
+
+#endif
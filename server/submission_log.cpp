@@ -0,0 +1,542 @@
+#include "submission_log.h"
+#include "exam_catalog.h"
+#include "record_io.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+int Submission::totalMarks() const {
+    int total = 0;
+    for (int8_t m : marks) total += m;
+    return total;
+}
+
+int Submission::attemptedCount() const {
+    int count = 0;
+    for (int8_t a : answers) if (a != -1) count++;
+    return count;
+}
+
+int Submission::wrongCount() const {
+    int count = 0;
+    for (size_t i = 0; i < answers.size(); ++i)
+        if (answers[i] != -1 && answers[i] != correct[i]) count++;
+    return count;
+}
+
+int Submission::totalTime() const {
+    int total = 0;
+    for (int32_t t : times) total += t;
+    return total;
+}
+
+// True if the file exists on disk or was created earlier in this batch
+bool ViewWriter::exists(const string& path) {
+    return files.count(path) || access(path.c_str(), F_OK) == 0;
+}
+
+/**
+ * Queues data to be appended to a file when the batch commits.
+ *
+ * @return The offset the data will be written at.
+ */
+off_t ViewWriter::append(const string& path, const string& data) {
+    auto it = files.find(path);
+    if (it == files.end()) {
+        struct stat st;
+        Pending pending;
+        pending.baseSize = (stat(path.c_str(), &st) == 0) ? st.st_size : -1;
+        it = files.emplace(path, pending).first;
+    }
+    Pending& pending = it->second;
+    off_t offset = max(pending.baseSize, (off_t)0) + pending.data.size();
+    pending.data += data;
+    return offset;
+}
+
+/**
+ * Writes the batch and makes it durable. The size every file had before the batch is
+ * saved in the journal first, so a batch cut short by a crash can be undone on restart
+ * and its submissions replayed exactly once.
+ *
+ * @param journalPath Where to record the pre-batch sizes.
+ * @param seq Sequence number of the last submission in the batch.
+ */
+bool ViewWriter::commit(const string& journalPath, uint64_t seq) {
+    if (files.empty()) return true;
+
+    string payload;
+    put<uint64_t>(payload, seq);
+    put<uint32_t>(payload, files.size());
+    for (const auto& [path, pending] : files) {
+        putString(payload, path);
+        put<int64_t>(payload, pending.baseSize);
+    }
+    string journal;
+    put<uint32_t>(journal, payload.size());
+    put<uint32_t>(journal, checksum(payload));
+    journal += payload;
+
+    // Without the journal a half-written batch could not be rolled back: touch no view
+    int jfd = open(journalPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = jfd != -1 && writeAll(jfd, journal.data(), journal.size()) && fdatasync(jfd) == 0;
+    if (!ok) cerr << "Error: Unable to write " << journalPath << "\n";
+    if (jfd != -1) close(jfd);
+
+    for (const auto& [path, pending] : files) {
+        if (!ok) break;
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd == -1 || !writeAll(fd, pending.data.data(), pending.data.size()) || fdatasync(fd) != 0) {
+            cerr << "Error: Unable to write " << path << "\n";
+            ok = false;
+        }
+        if (fd != -1) close(fd);
+    }
+    files.clear();
+    return ok;
+}
+
+/**
+ * Undoes the appends of a batch that was being written when the server stopped:
+ * files are cut back to their pre-batch size (or removed if the batch created them).
+ *
+ * @param journalPath Journal written by commit().
+ * @param appliedSeq Last submission whose views are known to be complete.
+ */
+void ViewWriter::rollBack(const string& journalPath, uint64_t appliedSeq) {
+    ifstream in(journalPath, ios::binary);
+    if (!in.is_open()) return;
+    string journal((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    // A torn journal means the crash came before any view was touched
+    size_t pos = 0;
+    uint32_t length, sum;
+    if (!get(journal, pos, length) || !get(journal, pos, sum) || journal.size() - pos != length) return;
+    string payload = journal.substr(pos);
+    if (checksum(payload) != sum) return;
+
+    pos = 0;
+    uint64_t seq;
+    uint32_t count;
+    if (!get(payload, pos, seq) || !get(payload, pos, count) || seq <= appliedSeq) return;
+    for (uint32_t i = 0; i < count; ++i) {
+        string path;
+        int64_t baseSize;
+        if (!getString(payload, pos, path) || !get(payload, pos, baseSize)) return;
+
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) continue;
+        if (baseSize < 0) unlink(path.c_str());
+        else if (st.st_size > baseSize && truncate(path.c_str(), baseSize) != 0)
+            cerr << "Error: Unable to roll back " << path << "\n";
+    }
+    cout << "[!] Rolled back views of an unfinished batch (up to submission " << seq << ")" << endl;
+}
+
+int SubmissionLog::fd = -1;
+string SubmissionLog::logPath;
+SubmissionLog::ViewApplier SubmissionLog::apply = nullptr;
+SubmissionLog::BatchDone SubmissionLog::batchDone = nullptr;
+
+pthread_mutex_t SubmissionLog::lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t SubmissionLog::pendingReady = PTHREAD_COND_INITIALIZER;
+pthread_cond_t SubmissionLog::committed = PTHREAD_COND_INITIALIZER;
+pthread_cond_t SubmissionLog::viewsReady = PTHREAD_COND_INITIALIZER;
+pthread_cond_t SubmissionLog::viewsApplied = PTHREAD_COND_INITIALIZER;
+
+string SubmissionLog::pendingBytes;
+vector<Submission> SubmissionLog::pendingRecords;
+deque<Submission> SubmissionLog::viewQueue;
+uint64_t SubmissionLog::nextSeq = 1;
+uint64_t SubmissionLog::durableSeq = 0;
+uint64_t SubmissionLog::appliedSeq = 0;
+bool SubmissionLog::viewsPaused = false;
+uint64_t SubmissionLog::pausedAt = 0;
+uint64_t SubmissionLog::groupsTaken = 0;
+uint64_t SubmissionLog::groupsWritten = 0;
+bool SubmissionLog::failed = false;
+bool SubmissionLog::viewsFailed = false;
+int (*SubmissionLog::syncLog)(int fd) = fdatasync;
+
+static const size_t RECORD_HEADER_SIZE = 8;
+static const uint32_t MAX_RECORD_SIZE = 16 * 1024 * 1024;
+
+// Serializes a submission as one complete log record (header + payload)
+string SubmissionLog::encode(const Submission& submission) {
+    string payload;
+    put<uint64_t>(payload, submission.seq);
+    putString(payload, submission.studentId);
+    putString(payload, submission.examName);
+    putString(payload, submission.timestamp);
+    put<uint32_t>(payload, submission.answers.size());
+    for (size_t i = 0; i < submission.answers.size(); ++i) {
+        put<int8_t>(payload, submission.correct[i]);
+        put<int8_t>(payload, submission.answers[i]);
+        put<int8_t>(payload, submission.marks[i]);
+        put<int32_t>(payload, submission.times[i]);
+    }
+
+    string record;
+    put<uint32_t>(record, payload.size());
+    put<uint32_t>(record, checksum(payload));
+    return record + payload;
+}
+
+bool SubmissionLog::decode(const string& payload, Submission& submission) {
+    size_t pos = 0;
+    uint32_t count;
+    if (!get(payload, pos, submission.seq) ||
+        !getString(payload, pos, submission.studentId) ||
+        !getString(payload, pos, submission.examName) ||
+        !getString(payload, pos, submission.timestamp) ||
+        !get(payload, pos, count))
+        return false;
+    if (count > payload.size()) return false;
+
+    submission.correct.resize(count);
+    submission.answers.resize(count);
+    submission.marks.resize(count);
+    submission.times.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!get(payload, pos, submission.correct[i]) ||
+            !get(payload, pos, submission.answers[i]) ||
+            !get(payload, pos, submission.marks[i]) ||
+            !get(payload, pos, submission.times[i]))
+            return false;
+    }
+    return pos == payload.size();
+}
+
+// Serializes a re-grade as one complete log record; sequence number 0 tells it from a submission
+string SubmissionLog::encodeRegrade(const string& examName, const vector<int8_t>& correct) {
+    string payload;
+    put<uint64_t>(payload, 0);
+    putString(payload, examName);
+    put<uint32_t>(payload, correct.size());
+    for (int8_t answer : correct) put<int8_t>(payload, answer);
+
+    string record;
+    put<uint32_t>(record, payload.size());
+    put<uint32_t>(record, checksum(payload));
+    return record + payload;
+}
+
+bool SubmissionLog::decodeRegrade(const string& payload, string& examName, vector<int8_t>& correct) {
+    size_t pos = 0;
+    uint64_t seq;
+    uint32_t count;
+    if (!get(payload, pos, seq) || seq != 0 || !getString(payload, pos, examName) || !get(payload, pos, count) ||
+        payload.size() - pos != count)
+        return false;
+    correct.assign(payload.begin() + pos, payload.end());
+    return true;
+}
+
+// Marks a replayed submission again with the key a later re-grade put in place
+static void rescore(Submission& submission, const vector<int8_t>& correct) {
+    if (correct.size() != submission.answers.size()) return;
+    submission.correct = correct;
+    MarkingScheme scheme = ExamCatalog::schemeOf(submission.examName);
+    scheme.grader()(scheme, submission.answers.data(), submission.correct.data(), submission.marks.data(), correct.size());
+}
+
+/**
+ * Opens (or creates) the log, replays submissions whose views were not written
+ * before the last shutdown, and starts the flusher and view threads.
+ *
+ * @param path Path of the log file.
+ * @param applier Writes the derived files for one submission.
+ * @param onBatchDone Optional hook run with each batch once its views are on disk.
+ * @return False if the log cannot be opened.
+ */
+bool SubmissionLog::open(const string& path, ViewApplier applier, BatchDone onBatchDone) {
+    logPath = path;
+    apply = applier;
+    batchDone = onBatchDone;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd == -1) {
+        cerr << "Error: Unable to open submission log " << path << "\n";
+        return false;
+    }
+    if (!replay()) return false;
+
+    pthread_t flusher, viewWriter;
+    pthread_create(&flusher, nullptr, runFlusher, nullptr);
+    pthread_detach(flusher);
+    pthread_create(&viewWriter, nullptr, runViewWriter, nullptr);
+    pthread_detach(viewWriter);
+    return true;
+}
+
+// Scans the log, drops a torn tail and re-derives views for unapplied records
+bool SubmissionLog::replay() {
+    uint64_t applied = 0;
+    ifstream appliedIn(logPath + ".applied");
+    appliedIn >> applied;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) return false;
+    string log(st.st_size, '\0');
+    size_t done = 0;
+    while (done < log.size()) {
+        ssize_t n = pread(fd, &log[done], log.size() - done, done);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+
+    ViewWriter::rollBack(logPath + ".journal", applied);
+
+    // Reads the record at `at` and moves past it; false at the end of the log or at a torn record
+    auto nextRecord = [&](size_t& at, string& payload) {
+        if (log.size() - at < RECORD_HEADER_SIZE) return false;
+        uint32_t length, sum;
+        memcpy(&length, log.data() + at, sizeof(length));
+        memcpy(&sum, log.data() + at + 4, sizeof(sum));
+        if (length > MAX_RECORD_SIZE || log.size() - at - RECORD_HEADER_SIZE < length) return false;
+        payload = log.substr(at + RECORD_HEADER_SIZE, length);
+        if (checksum(payload) != sum) return false;
+        at += RECORD_HEADER_SIZE + length;
+        return true;
+    };
+
+    // Newest re-grade of each exam and where it starts: submissions logged before it get its key
+    map<string, pair<size_t, vector<int8_t>>> regrades;
+    string payload, examName;
+    vector<int8_t> correct;
+    for (size_t at = 0, start = 0; nextRecord(at, payload); start = at) {
+        if (decodeRegrade(payload, examName, correct)) regrades[examName] = {start, correct};
+    }
+
+    ViewWriter writer;
+    deque<Submission> batch;
+    size_t pos = 0, replayed = 0, rescored = 0;
+    uint64_t lastSeq = 0;
+    for (size_t at = 0; nextRecord(at, payload); pos = at) {
+        if (decodeRegrade(payload, examName, correct)) continue;
+        Submission submission;
+        if (!decode(payload, submission)) break;
+
+        if (submission.seq > applied) {
+            auto regrade = regrades.find(submission.examName);
+            if (regrade != regrades.end() && regrade->second.first > pos) {
+                rescore(submission, regrade->second.second);
+                rescored++;
+            }
+            apply(submission, writer);
+            batch.push_back(submission);
+            replayed++;
+        }
+        lastSeq = submission.seq;
+    }
+
+    if (pos < log.size()) {
+        cerr << "[!] Submission log: discarding " << (log.size() - pos) << " bytes of a torn record\n";
+        if (ftruncate(fd, pos) == -1) return false;
+    }
+    if (!writer.commit(logPath + ".journal", lastSeq)) return false;
+    if (batchDone && !batch.empty()) batchDone(batch);
+    if (replayed > 0) {
+        saveApplied(lastSeq);
+        cout << "[+] Replayed " << replayed << " submissions from the log";
+        if (rescored > 0) cout << " (" << rescored << " marked with a corrected key)";
+        cout << endl;
+    }
+
+    nextSeq = lastSeq + 1;
+    durableSeq = appliedSeq = lastSeq;
+    return true;
+}
+
+// Records how far the derived views are complete (written via rename so it is never torn)
+void SubmissionLog::saveApplied(uint64_t seq) {
+    string tempPath = logPath + ".applied.tmp";
+    int tmp = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (tmp == -1) return;
+    string text = to_string(seq) + "\n";
+    writeAll(tmp, text.data(), text.size());
+    fdatasync(tmp);
+    close(tmp);
+    rename(tempPath.c_str(), (logPath + ".applied").c_str());
+}
+
+/**
+ * Adds a submission to the log and waits until it is on disk.
+ * Many concurrent callers share one write and one fdatasync.
+ *
+ * @param submission The evaluated submission; its seq is assigned here.
+ * @return False if the log could not be written (the submission is not stored).
+ */
+bool SubmissionLog::append(Submission& submission) {
+    pthread_mutex_lock(&lock);
+    if (failed || viewsFailed || fd == -1) {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    submission.seq = nextSeq++;
+    pendingBytes += encode(submission);
+    pendingRecords.push_back(submission);
+    pthread_cond_signal(&pendingReady);
+
+    while (durableSeq < submission.seq && !failed) {
+        pthread_cond_wait(&committed, &lock);
+    }
+    bool stored = durableSeq >= submission.seq;
+    pthread_mutex_unlock(&lock);
+    return stored;
+}
+
+/**
+ * Logs an exam's corrected answer key and waits until it is on disk. It goes through the
+ * same group commit as submissions, so it lands after every submission already logged.
+ *
+ * @param examName The re-graded exam.
+ * @param correct The new answer key index per question.
+ * @return False if the log could not be written.
+ */
+bool SubmissionLog::appendRegrade(const string& examName, const vector<int8_t>& correct) {
+    pthread_mutex_lock(&lock);
+    if (failed || viewsFailed || fd == -1) {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    pendingBytes += encodeRegrade(examName, correct);
+    uint64_t group = groupsTaken + 1;
+    pthread_cond_signal(&pendingReady);
+
+    while (groupsWritten < group && !failed) {
+        pthread_cond_wait(&committed, &lock);
+    }
+    bool stored = groupsWritten >= group;
+    pthread_mutex_unlock(&lock);
+    return stored;
+}
+
+// Blocks until every submission committed so far is reflected in the derived files
+void SubmissionLog::waitForViews() {
+    pthread_mutex_lock(&lock);
+    uint64_t target = durableSeq;
+    while (appliedSeq < target) {
+        pthread_cond_wait(&viewsApplied, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Brings the derived files up to date with every submission committed so far and
+ * keeps later submissions out of them until resumeViews(), so the caller can rewrite
+ * the files. Later submissions are still logged (and acknowledged) meanwhile.
+ */
+void SubmissionLog::pauseViews() {
+    pthread_mutex_lock(&lock);
+    viewsPaused = true;
+    pausedAt = durableSeq;
+    while (appliedSeq < pausedAt) {
+        pthread_cond_wait(&viewsApplied, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void SubmissionLog::resumeViews() {
+    pthread_mutex_lock(&lock);
+    viewsPaused = false;
+    pthread_cond_signal(&viewsReady);
+    pthread_mutex_unlock(&lock);
+}
+
+void* SubmissionLog::runFlusher(void* arg) {
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (pendingBytes.empty()) {
+            pthread_cond_wait(&pendingReady, &lock);
+        }
+
+        // Take everything buffered so far; later arrivals form the next group
+        string bytes;
+        vector<Submission> records;
+        bytes.swap(pendingBytes);
+        records.swap(pendingRecords);
+        uint64_t group = ++groupsTaken;
+        pthread_mutex_unlock(&lock);
+
+        // The log is only appended to here, so its end is where this group starts
+        off_t groupStart = lseek(fd, 0, SEEK_END);
+        bool ok = groupStart != -1 && writeAll(fd, bytes.data(), bytes.size()) && syncLog(fd) == 0;
+        int error = errno;
+        if (!ok && groupStart != -1) {
+            // Its submitters are told to resubmit, so the group must not be replayed on the next start
+            if (ftruncate(fd, groupStart) != 0 || fdatasync(fd) != 0)
+                cerr << "[✖] Unable to cut a failed group out of the submission log: " << strerror(errno) << "\n";
+        }
+
+        pthread_mutex_lock(&lock);
+        if (!ok) {
+            // Stop accepting: an unacknowledged client keeps its answer sheet and resubmits later
+            cerr << "[✖] Submission log write failed: " << strerror(error) << "\n";
+            failed = true;
+            // Records queued meanwhile are rejected too (their submitters see `failed`): never write them
+            pendingBytes.clear();
+            pendingRecords.clear();
+            pthread_cond_broadcast(&committed);
+            break;
+        }
+        groupsWritten = group;
+        // A group may hold nothing but a re-grade record
+        if (!records.empty()) {
+            durableSeq = records.back().seq;
+            for (Submission& record : records) viewQueue.push_back(move(record));
+            pthread_cond_signal(&viewsReady);
+        }
+        pthread_cond_broadcast(&committed);
+    }
+    pthread_mutex_unlock(&lock);
+    return nullptr;
+}
+
+void* SubmissionLog::runViewWriter(void* arg) {
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (viewQueue.empty() || (viewsPaused && viewQueue.front().seq > pausedAt)) {
+            pthread_cond_wait(&viewsReady, &lock);
+        }
+        deque<Submission> batch;
+        if (!viewsPaused) {
+            batch.swap(viewQueue);
+        } else {
+            while (!viewQueue.empty() && viewQueue.front().seq <= pausedAt) {
+                batch.push_back(move(viewQueue.front()));
+                viewQueue.pop_front();
+            }
+        }
+        bool skip = viewsFailed;
+        pthread_mutex_unlock(&lock);
+
+        // After a failed batch nothing more is written: the next start replays it all from the log
+        bool written = false;
+        if (!skip) {
+            ViewWriter writer;
+            for (const Submission& submission : batch) apply(submission, writer);
+            written = writer.commit(logPath + ".journal", batch.back().seq);
+            if (written) {
+                if (batchDone) batchDone(batch);
+                saveApplied(batch.back().seq);
+            }
+        }
+
+        pthread_mutex_lock(&lock);
+        if (!skip && !written) {
+            cerr << "[✖] Submission views could not be written; no new submissions until the server restarts\n";
+            viewsFailed = true;
+        }
+        // Waiters are released either way; the views stay as they are until the restart
+        appliedSeq = batch.back().seq;
+        pthread_cond_broadcast(&viewsApplied);
+    }
+    return nullptr;
+}
@@ -0,0 +1,124 @@
+#ifndef SUBMISSION_LOG_H
+#define SUBMISSION_LOG_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstdint>
+#include <pthread.h>
+#include <sys/types.h>
+
+using namespace std;
+
+// One evaluated answer sheet, as recorded in the submission log
+struct Submission {
+    uint64_t seq = 0;              // position in the log, assigned by SubmissionLog::append
+    string studentId;
+    string examName;
+    string timestamp;              // "YYYY-MM-DD HH:MM:SS"
+    vector<int8_t> correct;        // answer key index per question
+    vector<int8_t> answers;        // chosen option per question, -1 if skipped
+    vector<int8_t> marks;          // marks awarded per question
+    vector<int32_t> times;         // seconds spent per question
+
+    int totalMarks() const;
+    int attemptedCount() const;
+    int wrongCount() const;
+    int totalTime() const;
+};
+
+/**
+ * Appends to the files derived from the log and makes them durable together.
+ * Appends are buffered until commit(), so each file is written once per batch
+ * however many submissions touch it.
+ */
+class ViewWriter {
+public:
+    bool exists(const string& path);
+    off_t append(const string& path, const string& data);
+    bool commit(const string& journalPath, uint64_t seq);
+
+    static void rollBack(const string& journalPath, uint64_t appliedSeq);
+
+private:
+    struct Pending {
+        off_t baseSize;      // file size before this batch, -1 if the file did not exist
+        string data;
+    };
+    map<string, Pending> files;
+};
+
+/**
+ * Append-only, binary submission write-ahead log with group commit.
+ *
+ * Submitting threads serialize their record into a shared buffer and wait; a single
+ * flusher thread writes everything buffered so far with one write() and one fdatasync(),
+ * so a burst of submissions at the end of an exam costs a handful of syncs instead of one
+ * per student. Committed submissions are then handed to a view thread, which derives the
+ * per-student and per-exam text files from them off the request path.
+ *
+ * Record layout: [payload length : u32][checksum : u32][payload]. A torn record at the
+ * tail (crash during write) is cut off on startup, a batch of views cut short is rolled
+ * back from "<log>.journal", and every record past the last applied one (kept in
+ * "<log>.applied") is replayed into the views. A group whose write or sync fails is cut
+ * back out of the log before its submitters are told to resubmit, so it is never replayed;
+ * the flusher then stops, dropping whatever was queued behind the failed group. A batch
+ * of views that fails to commit leaves "<log>.applied" behind it, so the next start rolls
+ * it back and replays it; no new submissions are accepted until then.
+ *
+ * A re-grade is logged too, as a record with sequence number 0 holding the exam and its
+ * corrected key. Replay marks every earlier submission of that exam with the newest such
+ * key, so replaying the log never brings back marks of a key that was corrected.
+ */
+class SubmissionLog {
+public:
+    typedef void (*ViewApplier)(const Submission& submission, ViewWriter& writer);
+    typedef void (*BatchDone)(const deque<Submission>& batch);
+
+    static bool open(const string& path, ViewApplier applier, BatchDone batchDone = nullptr);
+    static bool append(Submission& submission);
+    static bool appendRegrade(const string& examName, const vector<int8_t>& correct);
+    static void waitForViews();
+    static void pauseViews();
+    static void resumeViews();
+
+    // Makes a written group durable; tests swap in a failing one to simulate a bad disk
+    static int (*syncLog)(int fd);
+
+private:
+    static int fd;
+    static string logPath;
+    static ViewApplier apply;
+    static BatchDone batchDone;
+
+    static pthread_mutex_t lock;
+    static pthread_cond_t pendingReady;    // flusher: records are waiting
+    static pthread_cond_t committed;       // submitters: durableSeq advanced
+    static pthread_cond_t viewsReady;      // view thread: committed submissions waiting
+    static pthread_cond_t viewsApplied;    // readers: appliedSeq advanced
+
+    static string pendingBytes;
+    static vector<Submission> pendingRecords;
+    static deque<Submission> viewQueue;
+    static uint64_t nextSeq;
+    static uint64_t durableSeq;
+    static uint64_t appliedSeq;
+    static bool viewsPaused;               // views past pausedAt wait (a re-grade is rewriting them)
+    static uint64_t pausedAt;
+    static uint64_t groupsTaken;           // groups the flusher has started writing
+    static uint64_t groupsWritten;         // groups on disk
+    static bool failed;                    // the log could not be written: nothing more is logged
+    static bool viewsFailed;               // a batch of views could not be written: no new submissions
+
+    static string encode(const Submission& submission);
+    static bool decode(const string& payload, Submission& submission);
+    static string encodeRegrade(const string& examName, const vector<int8_t>& correct);
+    static bool decodeRegrade(const string& payload, string& examName, vector<int8_t>& correct);
+    static bool replay();
+    static void saveApplied(uint64_t seq);
+    static void* runFlusher(void* arg);
+    static void* runViewWriter(void* arg);
+};
+
+#endif
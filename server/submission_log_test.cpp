@@ -0,0 +1,129 @@
+// submission_log_test.cpp
+// Checks that a group the submission log fails to make durable is taken back out of the
+// log: a child process logs one submission, then has the sync of the next group fail
+// while a third submission queues behind it. Neither may reach the log. Reopening the
+// log must replay nothing (the first submission's views are already applied, the other
+// submitters were told to resubmit), and the resubmission must be logged once. The exam is then re-graded; replaying the whole log must mark both
+// submissions with the corrected key.
+//
+// Usage: ./submission_log_test   (run by make test)
+
+#include "submission_log.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+static int applied = 0;
+static vector<vector<int8_t>> appliedMarks;
+
+static void countApplied(const Submission& submission, ViewWriter&) {
+    applied++;
+    appliedMarks.push_back(submission.marks);
+}
+
+// Fails the first sync, slowly enough for another submission to queue behind it
+static int failingSync(int fd) {
+    static bool failedOnce = false;
+    if (failedOnce) return fdatasync(fd);
+    failedOnce = true;
+    usleep(200000);
+    errno = EIO;
+    return -1;
+}
+
+
+static Submission makeSubmission(const string& studentId) {
+    Submission submission;
+    submission.studentId = studentId;
+    submission.examName = "math";
+    submission.timestamp = "2026-01-01 10:00:00";
+    submission.correct = {0, 1, 2, 3};
+    submission.answers = {0, 1, -1, 2};
+    submission.marks = {4, 4, 0, -1};
+    submission.times = {5, 7, 0, 9};
+    return submission;
+}
+
+static void* submitBehind(void* result) {
+    usleep(50000);
+    Submission queued = makeSubmission("carol");
+    *static_cast<bool*>(result) = SubmissionLog::append(queued);
+    return nullptr;
+}
+
+static off_t fileSize(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+static bool check(bool ok, const string& what) {
+    cout << (ok ? "[✔] " : "[✖] ") << what << endl;
+    return ok;
+}
+
+int main() {
+    char dir[] = "/tmp/submission_log_test.XXXXXX";
+    if (!mkdtemp(dir)) {
+        cerr << "Error: Unable to create a temporary directory" << endl;
+        return 1;
+    }
+    string logPath = string(dir) + "/submissions.wal";
+
+    // The log's threads and state live for the whole process, so the failing run gets its own
+    pid_t child = fork();
+    if (child == 0) {
+        bool ok = SubmissionLog::open(logPath, countApplied);
+        Submission first = makeSubmission("alice");
+        ok = check(ok && SubmissionLog::append(first), "first submission logged") && ok;
+        SubmissionLog::waitForViews();
+        off_t committedSize = fileSize(logPath);
+
+        SubmissionLog::syncLog = failingSync;
+        bool queuedStored = true;
+        pthread_t behind;
+        pthread_create(&behind, nullptr, submitBehind, &queuedStored);
+        Submission second = makeSubmission("bob");
+        ok = check(!SubmissionLog::append(second), "submission rejected when the sync fails") && ok;
+        pthread_join(behind, nullptr);
+        ok = check(!queuedStored, "submission queued behind the failed group rejected") && ok;
+        usleep(100000);
+        ok = check(fileSize(logPath) == committedSize, "failed group and the one queued behind it kept out of the log") && ok;
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    child = fork();
+    if (child == 0) {
+        bool ok = check(SubmissionLog::open(logPath, countApplied), "log reopened");
+        ok = check(applied == 0, "replay applied nothing (" + to_string(applied) + " submissions)") && ok;
+
+        Submission resubmitted = makeSubmission("bob");
+        ok = check(SubmissionLog::append(resubmitted) && resubmitted.seq == 2, "resubmission logged as submission 2") && ok;
+        SubmissionLog::waitForViews();
+        ok = check(applied == 1, "resubmission applied once") && ok;
+        ok = check(SubmissionLog::appendRegrade("math", {0, 1, 2, 2}), "re-grade logged") && ok;
+        _exit(ok ? 0 : 1);
+    }
+    waitpid(child, &status, 0);
+    ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+
+    // Losing the applied marker replays everything: both submissions were graded with the old key
+    unlink((logPath + ".applied").c_str());
+    ok = check(SubmissionLog::open(logPath, countApplied), "log reopened after the re-grade") && ok;
+    bool regraded = appliedMarks.size() == 2;
+    for (const vector<int8_t>& marks : appliedMarks) regraded = regraded && marks == vector<int8_t>{4, 4, 0, 4};
+    ok = check(regraded, "replayed submissions marked with the corrected key") && ok;
+
+    for (const char* suffix : {"", ".applied", ".journal"}) unlink((logPath + suffix).c_str());
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
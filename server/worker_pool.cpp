@@ -0,0 +1,89 @@
+#include "worker_pool.h"
+
+#include <iostream>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "protocol.h"
+
+/**
+ * @param workerCount Number of worker threads serving connections.
+ * @param queueCapacity Maximum number of accepted sockets waiting for a worker.
+ * @param retryAfterSeconds Retry hint sent to clients that are turned away.
+ * @param handler Function that serves one client socket until it disconnects.
+ */
+WorkerPool::WorkerPool(int workerCount, int queueCapacity, int retryAfterSeconds, void (*handler)(int))
+    : workerCount(workerCount < 1 ? 1 : workerCount),
+      queueCapacity(queueCapacity < 0 ? 0 : queueCapacity),
+      retryAfterSeconds(retryAfterSeconds),
+      handler(handler) {}
+
+// Spawns the worker threads
+void WorkerPool::start() {
+    workers.resize(workerCount);
+    for (pthread_t& worker : workers) {
+        pthread_create(&worker, nullptr, runWorker, this);
+        pthread_detach(worker);
+    }
+}
+
+/**
+ * Queues an accepted socket for the next free worker.
+ * If every worker is busy and the queue is full the client gets "SERVER_BUSY <seconds>" and is disconnected.
+ *
+ * @param sock The accepted client socket.
+ * @return True if the socket was queued, false if it was rejected.
+ */
+bool WorkerPool::submit(int sock) {
+    pthread_mutex_lock(&lock);
+    // Idle workers take a socket straight away; only the waiting line is bounded
+    size_t idleWorkers = workerCount - counters.active;
+    if (queue.size() >= queueCapacity + idleWorkers) {
+        counters.rejected++;
+        pthread_mutex_unlock(&lock);
+
+        string busy = encodeFrame("SERVER_BUSY " + to_string(retryAfterSeconds));
+        send(sock, busy.c_str(), busy.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        close(sock);
+        return false;
+    }
+
+    queue.push_back(sock);
+    counters.accepted++;
+    if (queue.size() > counters.maxQueued) counters.maxQueued = queue.size();
+    pthread_cond_signal(&notEmpty);
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+WorkerPool::Stats WorkerPool::stats() {
+    pthread_mutex_lock(&lock);
+    Stats snapshot = counters;
+    snapshot.queued = queue.size();
+    pthread_mutex_unlock(&lock);
+    return snapshot;
+}
+
+void* WorkerPool::runWorker(void* arg) {
+    WorkerPool* pool = static_cast<WorkerPool*>(arg);
+
+    while (true) {
+        // Wait for a queued socket
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queue.empty()) {
+            pthread_cond_wait(&pool->notEmpty, &pool->lock);
+        }
+        int sock = pool->queue.front();
+        pool->queue.pop_front();
+        pool->counters.active++;
+        pthread_mutex_unlock(&pool->lock);
+
+        // Serve the client until it disconnects
+        pool->handler(sock);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->counters.active--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return nullptr;
+}
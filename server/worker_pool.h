@@ -0,0 +1,49 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <pthread.h>
+
+using namespace std;
+
+/**
+ * Fixed pool of worker threads fed from a bounded queue of accepted sockets.
+ *
+ * submit() never blocks: when the queue is full the connection is answered
+ * with a "server busy" reply and closed, so a burst of clients cannot exhaust
+ * the server's threads.
+ */
+class WorkerPool {
+public:
+    // Counters for sizing the pool, read with stats()
+    struct Stats {
+        size_t queued;       // sockets waiting for a worker
+        size_t active;       // sockets being served right now
+        size_t accepted;     // total sockets admitted to the queue
+        size_t rejected;     // total sockets turned away because the queue was full
+        size_t maxQueued;    // high-water mark of the queue
+    };
+
+    WorkerPool(int workerCount, int queueCapacity, int retryAfterSeconds, void (*handler)(int));
+    void start();
+    bool submit(int sock);
+    Stats stats();
+
+private:
+    int workerCount;
+    size_t queueCapacity;
+    int retryAfterSeconds;
+    void (*handler)(int);
+
+    deque<int> queue;
+    vector<pthread_t> workers;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t notEmpty = PTHREAD_COND_INITIALIZER;
+    Stats counters{};
+
+    static void* runWorker(void* arg);
+};
+
+#endif